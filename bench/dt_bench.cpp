@@ -0,0 +1,342 @@
+// Микротесты производительности горячих участков расчёта: пересчёт координат, проекция
+// на разрез, интерполяция, ошибки интерполяции, интегрирование и расчёт ДТ разреза.
+// Поля синтетические (фиксированные зёрна), результат - JSON со временем на операцию,
+// пропускной способностью и количеством выделений памяти на операцию
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "corridor_filter.h"
+#include "dt_defs.h"
+#include "dynamic_topography.h"
+#include "field_store.h"
+#include "geometry.h"
+#include "integration.h"
+#include "interpolation.h"
+#include "text_io.h"
+
+#define BENCH_SEED 20200725
+#define BENCH_MIN_TIME 0.2		// [с] наименьшее время замера одного теста
+#define BENCH_DENSITY 10.		// векторов коридора на километр разреза
+#define BENCH_WIDTH 10.			// [км] ширина коридора (радиус)
+#define BENCH_ITP_DIAMETER 5.	// [км]
+
+////////////////////////////////////////////////////////////////////////////////
+// ------------------------- подсчёт выделений памяти ------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+static std::atomic <size_t> alloc_count(0);
+
+void *operator new(size_t size)
+{
+	alloc_count.fetch_add(1, std::memory_order_relaxed);
+	void *p = malloc(size == 0 ? 1 : size);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	free(p);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ------------------------------- замеры ------------------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+struct bench_result
+{
+	std::string name;
+	size_t n;			// размер задачи (количество векторов или точек)
+	size_t ops;			// операций за повторение
+	size_t repetitions;
+	double seconds;
+	size_t allocs;
+};
+
+// Повторяет run, пока суммарное время не превысит min_time. prepare вызывается перед каждым
+// повторением вне замера (сброс кэшей), run возвращает количество выполненных операций
+static bench_result measure(const std::string &name, size_t n, double min_time,
+							const std::function <void()> &prepare, const std::function <size_t()> &run)
+{
+	bench_result r = {name, n, 0, 0, 0.0, 0};
+	while (r.seconds < min_time || r.repetitions == 0)
+	{
+		prepare();
+		size_t allocs = alloc_count.load(std::memory_order_relaxed);
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		r.ops = run();
+		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+		r.allocs += alloc_count.load(std::memory_order_relaxed) - allocs;
+		r.seconds += std::chrono::duration <double>(t1 - t0).count();
+		++r.repetitions;
+	}
+	return r;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ---------------------------- синтетические данные -------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+// Разрез вдоль оси x длиной n / BENCH_DENSITY с серединой в начале локальной СК и n векторов
+// в его коридоре: струйное течение поперёк разреза с шумом
+struct corridor_data
+{
+	scut cut;
+	point origin;	// географическое начало локальной СК
+	std::vector <movement> mvn;
+};
+
+static corridor_data make_corridor(size_t n)
+{
+	corridor_data d;
+	d.origin = point(140., 40.);
+
+	double half = 0.5 * n / BENCH_DENSITY;
+	d.cut = scut(vec(point(-half, 0.), point(half, 0.)), BENCH_WIDTH, BENCH_ITP_DIAMETER, -1);
+
+	std::mt19937 rng(BENCH_SEED + n);
+	std::uniform_real_distribution <double> ux(-half, half), uy(-BENCH_WIDTH, BENCH_WIDTH), noise(-0.1, 0.1);
+	d.mvn.reserve(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		point start(ux(rng), uy(rng));
+		double vy = 0.5 * sin(start.x / 7.) + noise(rng), vx = 0.2 + noise(rng);
+		point end(start.x + vx, start.y + vy);
+		d.mvn.push_back(movement(vec(start, end), sqrt(vx * vx + vy * vy), 0.01));
+	}
+	return d;
+}
+
+// векторы коридора в форме wvector, как их строит DynamicTopography::take
+static void make_wvectors(const scut &cut, const FieldStore &field, std::vector <wvector> &wv)
+{
+	Line cut_line(cut.v());
+	wv.clear();
+	for (size_t i = 0; i < field.size(); ++i)
+	{
+		movement m = field.at(i);
+		point prj = cut_line.projection_of(m.mv.start);
+		point norm = cut_line.parallel(m.mv.end).projection_of(m.mv.start);
+		wv.push_back(wvector((int)i, norm, prj));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ---------------------------------- тесты ----------------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+static void bench_sizes(size_t n, double min_time, std::vector <bench_result> &res)
+{
+	volatile double sink = 0.0;
+
+	// пересчёт координат
+	std::mt19937 rng(BENCH_SEED + n);
+	std::uniform_real_distribution <double> lon(135., 145.), lat(35., 45.);
+	point origin(140., 40.);
+	std::vector <point> geo(n), pts(n);
+	for (size_t i = 0; i < n; ++i)
+		geo[i] = point(lon(rng), lat(rng));
+
+	res.push_back(measure("point::to_dec_cs", n, min_time, [&] { pts = geo; }, [&]
+	{
+		for (size_t i = 0; i < n; ++i)
+			pts[i].to_dec_cs(origin);
+		return n;
+	}));
+	std::vector <point> dec(pts);
+	res.push_back(measure("point::to_geo_cs", n, min_time, [&] { pts = dec; }, [&]
+	{
+		for (size_t i = 0; i < n; ++i)
+			pts[i].to_geo_cs(origin);
+		return n;
+	}));
+
+	// проекция на разрез
+	corridor_data d = make_corridor(n);
+	Line cut_line(d.cut.v());
+	res.push_back(measure("Line::projection_of", n, min_time, [] {}, [&]
+	{
+		double s = 0.0;
+		for (size_t i = 0; i < n; ++i)
+			s += cut_line.projection_of(d.mvn[i].mv.start).x;
+		sink = sink + s;
+		return n;
+	}));
+
+	std::vector <movement> mvn(d.mvn);
+	FieldStore field(mvn);
+	std::vector <wvector> wv;
+	make_wvectors(d.cut, field, wv);
+
+	// пакетная интерполяция в узлах прохода интегрирования (5 интервалов на вектор)
+	{
+		Interpolation itp(d.cut.v(), wv, field);
+		itp.set_radius(BENCH_ITP_DIAMETER / 2);
+		size_t nodes = 5 * n + 1;
+		std::vector <point> q(nodes);
+		for (size_t j = 0; j < nodes; ++j)
+		{
+			double t = (double)j / (nodes - 1);
+			q[j] = point(d.cut.start.x + t * (d.cut.end.x - d.cut.start.x), d.cut.start.y + t * (d.cut.end.y - d.cut.start.y));
+		}
+		std::vector <double> vals;
+		vals.reserve(nodes);
+		res.push_back(measure("Interpolation::take_for", n, min_time, [] {}, [&]
+		{
+			itp.take_for(q, vals);
+			return nodes;
+		}));
+	}
+
+	// ошибки интерполяции с исключением точки: новый объект на повторение, чтобы не брать кэш
+	{
+		std::unique_ptr <Interpolation> itp;
+		std::vector <double> err;
+		res.push_back(measure("Interpolation::calc_accuracy", n, min_time, [&]
+		{
+			itp.reset(new Interpolation(d.cut.v(), wv, field));
+			itp->set_radius(BENCH_ITP_DIAMETER / 2);
+			err.clear();
+		}, [&]
+		{
+			itp->calc_accuracy(err);
+			return n;
+		}));
+	}
+
+	// интегрирование (проход с 5 интервалами на вектор, с ошибками интерполяции)
+	{
+		std::unique_ptr <Integral> integral;
+		res.push_back(measure("Integral::take", n, min_time, [&]
+		{
+			integral.reset(new Integral(d.cut, wv, field));
+			integral->set_dcs_origin(d.origin);
+			integral->set_partitioning_count(5 * n);
+		}, [&]
+		{
+			itg_result itg_res;
+			integral->take(itg_res);
+			sink = sink + itg_res.lin_value;
+			return n;
+		}));
+	}
+
+	// полный расчёт разреза: коридор, два прохода интегрирования, результат
+	{
+		DynamicTopography dyn_tpg(field);
+		dyn_tpg.set_cut(d.cut);
+		dyn_tpg.set_dcs_origin(d.origin);
+		res.push_back(measure("DynamicTopography::take", n, min_time, [] {}, [&]
+		{
+			dt_result dt_res;
+			dyn_tpg.take(dt_res);
+			sink = sink + dt_res.dt;
+			return n;
+		}));
+	}
+}
+
+static void write_json(TextWriter &out, const std::vector <bench_result> &res)
+{
+	out << "{\n  \"seed\": " << BENCH_SEED << ",\n  \"simd\": \"" << simd_level_name(simd_level())
+		<< "\",\n  \"benchmarks\": [\n";
+	for (size_t i = 0; i < res.size(); ++i)
+	{
+		const bench_result &r = res[i];
+		double ops = (double)r.ops * r.repetitions;
+		out << "    {\"name\": \"" << r.name.c_str() << "\", \"n\": " << r.n << ", \"repetitions\": " << r.repetitions
+			<< ", \"ops\": " << r.ops << ", \"ns_per_op\": " << r.seconds * 1.e9 / ops
+			<< ", \"ops_per_sec\": " << ops / r.seconds << ", \"allocs_per_op\": " << r.allocs / ops << "}"
+			<< (i + 1 < res.size() ? ",\n" : "\n");
+	}
+	out << "  ]\n}\n";
+}
+
+static void print_usage()
+{
+	std::cout << "USAGE: dt_bench [-n <max vector count>] [-t <min seconds per test>] [-o <report.json>]\n"
+			  << "\tSizes are powers of ten from 100 to the max vector count (default 1000000).\n"
+			  << "\tThe JSON report goes to stdout without -o.\n";
+}
+
+int main(int argc, char **argv)
+{
+	size_t max_n = 1000000;
+	double min_time = BENCH_MIN_TIME;
+	const char *report = NULL;
+
+	for (int i = 1; i < argc; i += 2)
+	{
+		if (i + 1 < argc && strcmp(argv[i], "-n") == 0)
+			max_n = (size_t)atof(argv[i + 1]);
+		else if (i + 1 < argc && strcmp(argv[i], "-t") == 0)
+			min_time = atof(argv[i + 1]);
+		else if (i + 1 < argc && strcmp(argv[i], "-o") == 0)
+			report = argv[i + 1];
+		else
+		{
+			print_usage();
+			return 1;
+		}
+	}
+
+	std::vector <bench_result> res;
+	for (size_t n = 100; n <= max_n; n *= 10)
+	{
+		std::cerr << "n = " << n << "\n";
+		bench_sizes(n, min_time, res);
+	}
+
+	TextWriter out;
+	if (report != NULL)
+	{
+		if (!out.open(report))
+		{
+			std::cerr << "Error: can not create " << report << "\n";
+			return 1;
+		}
+	}
+	else
+		out.open_memory();
+	write_json(out, res);
+
+	if (report == NULL)
+	{
+		std::vector <char> text;
+		out.release(text);
+		std::cout.write(text.data(), text.size());
+	}
+	return 0;
+}
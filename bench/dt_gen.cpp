@@ -0,0 +1,78 @@
+// Генератор синтетических полей скоростей и списков разрезов в форматах Integral_DT
+// с известным перепадом ДТ (геострофическое течение аналитического уровня моря)
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "synthetic.h"
+#include "text_io.h"
+
+static void print_usage()
+{
+	std::cout << "USAGE: dt_gen [options] <vp_out_file> <boundary_points_list> [<expected_dt_file>]\n\n"
+			  << "Options:\n"
+			  << "\t-n <N>\t\tvector count (20000)\n"
+			  << "\t-c <N>\t\tcut count (40)\n"
+			  << "\t-e <N>\t\teddy count (3)\n"
+			  << "\t-a <m>\t\teddy amplitude (0.3)\n"
+			  << "\t-r <km>\t\teddy radius (25)\n"
+			  << "\t-l <km>\t\tcut length (60)\n"
+			  << "\t-w <km>\t\tcorridor width, -1 - the program default (-1)\n"
+			  << "\t-k <share>\tshare of cuts with the curvature centre in the nearest eddy (0.33)\n"
+			  << "\t-z <m/s>\tvelocity noise (0)\n"
+			  << "\t-x <km>\t\thalf size of the area along x, the y half size is 0.8 of it (100)\n"
+			  << "\t-s <seed>\trandom seed (1)\n\n"
+			  << "<expected_dt_file> gets the exact DT of every cut integrated over the whole cut,\n"
+			  << "one value in meters per line.\n";
+}
+
+int main(int argc, char **argv)
+{
+	synthetic_params prm;
+
+	int i = 1;
+	for (; i + 1 < argc && argv[i][0] == '-' && strlen(argv[i]) == 2; i += 2)
+	{
+		double v = atof(argv[i + 1]);
+		switch (argv[i][1])
+		{
+			case 'n': prm.vector_count = (size_t)v; break;
+			case 'c': prm.cut_count = (int)v; break;
+			case 'e': prm.eddy_count = (int)v; break;
+			case 'a': prm.eddy_amplitude = v; break;
+			case 'r': prm.eddy_radius = v; break;
+			case 'l': prm.cut_length = v; break;
+			case 'w': prm.cut_width = v; break;
+			case 'k': prm.curvature_share = v; break;
+			case 'z': prm.noise = v; break;
+			case 'x': prm.half_x = v, prm.half_y = 0.8 * v; break;
+			case 's': prm.seed = (unsigned)v; break;
+			default: print_usage(); return 1;
+		}
+	}
+	if (argc - i != 2 && argc - i != 3)
+	{
+		print_usage();
+		return 1;
+	}
+
+	SyntheticFlow flow(prm);
+	std::vector <scut> cuts;
+	if (!flow.write_field(argv[i]) || !flow.write_cuts(argv[i + 1], cuts))
+	{
+		std::cerr << "Error: can not write the output files\n";
+		return 1;
+	}
+
+	if (argc - i == 3)
+	{
+		TextWriter out(argv[i + 2]);
+		for (size_t j = 0; j < cuts.size(); ++j)
+			out << flow.expected_dt(cuts[j].start, cuts[j].end, cuts[j]) << '\n';
+	}
+
+	std::cout << prm.vector_count << " vectors and " << prm.cut_count << " cuts are written\n";
+	return 0;
+}
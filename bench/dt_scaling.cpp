@@ -0,0 +1,296 @@
+// Проверка масштабирования: Integral_DT запускается на синтетических полях растущего размера
+// с разным количеством потоков. Для каждого запуска записываются время и пиковая память,
+// результаты сверяются с точной ДТ модели, между количествами потоков и с эталонными файлами
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "dt_core.h"
+#include "synthetic.h"
+#include "text_io.h"
+
+// допустимое отклонение ДТ от точной: SC_TOLERANCE + SC_REL_TOLERANCE * |ДТ| (интерполяция
+// сглаживает поле в пределах радиуса, поэтому на крутых перепадах ошибка пропорциональна ДТ)
+#define SC_TOLERANCE 0.005		// [м]
+#define SC_REL_TOLERANCE 0.05
+#define SC_MATCH_DISTANCE 0.1	// [км] концы строки результата от отрезка разреза (округление вывода)
+
+struct run_result
+{
+	size_t n;
+	int threads;
+	int exit_code;
+	double seconds;
+	long peak_kb;			// пиковый размер резидентной памяти процесса
+	size_t rows;
+	double max_error, rms_error;	// [м] отклонение от точной ДТ
+	size_t bad_rows;		// строки с отклонением больше допустимого
+	std::string golden;		// match, differs, created или none
+	bool same_as_first;		// результат совпадает с первым количеством потоков
+};
+
+static std::vector <double> parse_list(const char *s)
+{
+	std::vector <double> v;
+	const char *p = s, *last = s + strlen(s);
+	double x;
+	while (parse_number(p, last, x))
+	{
+		v.push_back(x);
+		if (p < last && *p == ',') ++p;
+	}
+	return v;
+}
+
+static bool read_file(const std::string &name, std::string &data)
+{
+	std::ifstream f(name.c_str(), std::ios::binary);
+	if (!f) return false;
+	std::ostringstream ss;
+	ss << f.rdbuf();
+	data = ss.str();
+	return true;
+}
+
+// запуск программы с выводом в /dev/null, время и пиковая память по wait4
+static int run_program(const std::vector <std::string> &args, double &seconds, long &peak_kb)
+{
+	std::vector <char *> argv;
+	for (size_t i = 0; i < args.size(); ++i)
+		argv.push_back((char *)args[i].c_str());
+	argv.push_back(NULL);
+
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		int null_fd = open("/dev/null", O_WRONLY);
+		dup2(null_fd, 1);
+		dup2(null_fd, 2);
+		execv(argv[0], argv.data());
+		_exit(127);
+	}
+
+	int status = 0;
+	struct rusage ru;
+	memset(&ru, 0, sizeof(ru));
+	if (pid < 0 || wait4(pid, &status, 0, &ru) < 0)
+		return -1;
+	seconds = std::chrono::duration <double>(std::chrono::steady_clock::now() - t0).count();
+	peak_kb = ru.ru_maxrss;
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// расстояние от точки p до отрезка [a, b]
+static double segment_distance(const point &p, const point &a, const point &b)
+{
+	double dx = b.x - a.x, dy = b.y - a.y, len2 = dx * dx + dy * dy;
+	double t = (len2 > 0.0) ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2 : 0.0;
+	t = std::min(1.0, std::max(0.0, t));
+	return p.distance_to(point(a.x + t * dx, a.y + t * dy));
+}
+
+// Разрез строки результата с концами start и end (географические координаты): строки идут в порядке
+// разрезов, но разрезы с ошибкой пропущены, а выведенный разрез укорочен по крайним проекциям, 
+// поэтому ищется первый разрез начиная с first, на отрезке которого лежат оба конца строки.
+// cuts.size() - такого разреза нет
+static size_t match_cut(const point &start, const point &end, const std::vector <scut> &cuts, size_t first, 
+						const point &origin)
+{
+	point s = start, e = end;
+	s.to_dec_cs(origin);
+	e.to_dec_cs(origin);
+	for (size_t k = first; k < cuts.size(); ++k)
+	{
+		point a = cuts[k].start, b = cuts[k].end;
+		a.to_dec_cs(origin);
+		b.to_dec_cs(origin);
+		if (segment_distance(s, a, b) < SC_MATCH_DISTANCE && segment_distance(e, a, b) < SC_MATCH_DISTANCE)
+			return k;
+	}
+	return cuts.size();
+}
+
+// отклонения ДТ строк результата от точной ДТ модели по отрезкам этих строк; строки, не
+// найденные среди разрезов, считаются строками с недопустимым отклонением
+static void check_results(const std::string &out_file, const SyntheticFlow &flow, const std::vector <scut> &cuts,
+						  double tolerance, double rel_tolerance, run_result &r)
+{
+	TextReader in(out_file.c_str());
+	const char *p, *last;
+	double sum2 = 0.0;
+	size_t next_cut = 0;
+	r.rows = 0, r.bad_rows = 0, r.max_error = 0.0;
+	while (in.next_line(p, last) && r.rows < cuts.size())
+	{
+		double sx, sy, ex, ey, dt;
+		if (!(parse_number(p, last, sx) && parse_number(p, last, sy) && parse_number(p, last, ex) &&
+			  parse_number(p, last, ey) && parse_number(p, last, dt)))
+			continue;
+		++r.rows;
+		size_t k = match_cut(point(sx, sy), point(ex, ey), cuts, next_cut, flow.params().origin);
+		if (k == cuts.size())
+		{
+			++r.bad_rows;
+			continue;
+		}
+		next_cut = k + 1;
+
+		double expected = flow.expected_dt(point(sx, sy), point(ex, ey), cuts[k]);
+		double err = fabs(dt - expected);
+		if (err > tolerance + rel_tolerance * fabs(expected))
+			++r.bad_rows;
+		r.max_error = std::max(r.max_error, err);
+		sum2 += err * err;
+	}
+	r.rms_error = (r.rows > 0) ? sqrt(sum2 / r.rows) : 0.0;
+}
+
+static void print_usage()
+{
+	std::cout << "USAGE: dt_scaling [options] <Integral_DT executable> [<work_dir>]\n\n"
+			  << "Options:\n"
+			  << "\t-n <list>\tvector counts, comma separated (10000,100000,1000000)\n"
+			  << "\t-j <list>\tthread counts (1,2,4)\n"
+			  << "\t-c <N>\t\tcut count (40)\n"
+			  << "\t-e <m>\t\tabsolute tolerance of the deviation from the exact DT (" << SC_TOLERANCE << ")\n"
+			  << "\t-r <share>\trelative tolerance, added as share of |exact DT| (" << SC_REL_TOLERANCE << ")\n"
+			  << "\t-g <dir>\tgolden results golden_<N>.txt: compared, or created when missing\n"
+			  << "\t-o <file>\tJSON report (stdout by default)\n\n"
+			  << "Every result must have all cuts, stay within the tolerance and be the same for all\n"
+			  << "thread counts (and the golden file), otherwise the exit code is 1.\n";
+}
+
+int main(int argc, char **argv)
+{
+	std::vector <double> sizes, threads;
+	sizes.push_back(1.e4), sizes.push_back(1.e5), sizes.push_back(1.e6);
+	threads.push_back(1), threads.push_back(2), threads.push_back(4);
+	synthetic_params prm;
+	double tolerance = SC_TOLERANCE, rel_tolerance = SC_REL_TOLERANCE;
+	std::string golden_dir, report;
+
+	int i = 1;
+	for (; i + 1 < argc && argv[i][0] == '-' && strlen(argv[i]) == 2; i += 2)
+	{
+		switch (argv[i][1])
+		{
+			case 'n': sizes = parse_list(argv[i + 1]); break;
+			case 'j': threads = parse_list(argv[i + 1]); break;
+			case 'c': prm.cut_count = atoi(argv[i + 1]); break;
+			case 'e': tolerance = atof(argv[i + 1]); break;
+			case 'r': rel_tolerance = atof(argv[i + 1]); break;
+			case 'g': golden_dir = argv[i + 1]; break;
+			case 'o': report = argv[i + 1]; break;
+			default: print_usage(); return 1;
+		}
+	}
+	if (argc - i != 1 && argc - i != 2)
+	{
+		print_usage();
+		return 1;
+	}
+	std::string exe = argv[i];
+	std::string work = (argc - i == 2) ? std::string(argv[i + 1]) + "/" : std::string();
+
+	bool ok = true;
+	std::vector <run_result> results;
+	for (size_t s = 0; s < sizes.size(); ++s)
+	{
+		prm.vector_count = (size_t)sizes[s];
+		SyntheticFlow flow(prm);
+
+		std::string n_str = std::to_string(prm.vector_count);
+		std::string field_file = work + "syn_field_" + n_str + ".txt", cuts_file = work + "syn_cuts.txt";
+		std::vector <scut> cuts;
+		if (!flow.write_field(field_file.c_str()) || !flow.write_cuts(cuts_file.c_str(), cuts))
+		{
+			std::cerr << "Error: can not write the synthetic files in " << work << "\n";
+			return 1;
+		}
+
+		std::string first_out;
+		for (size_t t = 0; t < threads.size(); ++t)
+		{
+			run_result r;
+			r.n = prm.vector_count, r.threads = (int)threads[t];
+			std::string out_file = work + "syn_out_" + n_str + "_" + std::to_string(r.threads) + ".txt";
+
+			std::vector <std::string> args;
+			args.push_back(exe);
+			args.push_back("-j"), args.push_back(std::to_string(r.threads));
+			args.push_back("-d"), args.push_back("none");
+			args.push_back(field_file), args.push_back(cuts_file), args.push_back(out_file);
+			std::cerr << "n = " << r.n << ", threads = " << r.threads << "\n";
+			r.exit_code = run_program(args, r.seconds, r.peak_kb);
+
+			check_results(out_file, flow, cuts, tolerance, rel_tolerance, r);
+
+			std::string out;
+			read_file(out_file, out);
+			if (t == 0) first_out = out;
+			r.same_as_first = (out == first_out);
+
+			r.golden = "none";
+			if (!golden_dir.empty())
+			{
+				std::string golden_file = golden_dir + "/golden_" + n_str + ".txt", golden;
+				if (read_file(golden_file, golden))
+					r.golden = (golden == out) ? "match" : "differs";
+				else
+				{
+					std::ofstream(golden_file.c_str(), std::ios::binary) << out;
+					r.golden = "created";
+				}
+			}
+
+			ok = ok && r.exit_code == 0 && r.rows == cuts.size() && r.bad_rows == 0 &&
+				 r.same_as_first && r.golden != "differs";
+			results.push_back(r);
+		}
+		remove(field_file.c_str());
+	}
+
+	TextWriter out;
+	if (report.empty())
+		out.open_memory();
+	else if (!out.open(report.c_str()))
+	{
+		std::cerr << "Error: can not create " << report << "\n";
+		return 1;
+	}
+
+	out << "{\n  \"tolerance_m\": " << tolerance << ",\n  \"rel_tolerance\": " << rel_tolerance << ",\n  \"cuts\": " << prm.cut_count << ",\n  \"runs\": [\n";
+	for (size_t k = 0; k < results.size(); ++k)
+	{
+		const run_result &r = results[k];
+		out << "    {\"n\": " << r.n << ", \"threads\": " << r.threads << ", \"exit_code\": " << r.exit_code
+			<< ", \"seconds\": " << r.seconds << ", \"peak_rss_kb\": " << (size_t)r.peak_kb
+			<< ", \"rows\": " << r.rows << ", \"max_error_m\": " << r.max_error << ", \"rms_error_m\": " << r.rms_error
+			<< ", \"bad_rows\": " << r.bad_rows
+			<< ", \"same_as_first_thread_count\": " << (r.same_as_first ? "true" : "false")
+			<< ", \"golden\": \"" << r.golden.c_str() << "\"}" << (k + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "  ],\n  \"passed\": " << (ok ? "true" : "false") << "\n}\n";
+
+	if (report.empty())
+	{
+		std::vector <char> text;
+		out.release(text);
+		std::cout.write(text.data(), text.size());
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+#include "synthetic.h"
+#include "text_io.h"
+
+#include <cmath>
+#include <random>
+
+// зёрна независимых частей модели: добавление векторов не меняет вихри и разрезы
+#define SYN_SEED_EDDIES 0
+#define SYN_SEED_FIELD 1
+#define SYN_SEED_CUTS 2
+
+#define SYN_QUADRATURE_STEPS 20000
+
+synthetic_params::synthetic_params() : origin(148.5, 42.8), half_x(100.), half_y(80.), vector_count(20000),
+	eddy_count(3), eddy_amplitude(0.3), eddy_radius(25.), slope(0.05), noise(0.0), zero_share(0.03),
+	pixel_size(1.), interval(6 * 3600.), cut_count(40), cut_length(60.), cut_width(-1.), curvature_share(1. / 3),
+	seed(1)
+{}
+
+SyntheticFlow::SyntheticFlow(const synthetic_params &p) : prm(p)
+{
+	std::mt19937 rng(prm.seed * 3 + SYN_SEED_EDDIES);
+	std::uniform_real_distribution <double> ux(-prm.half_x, prm.half_x), uy(-prm.half_y, prm.half_y), 
+		ua(0.3, 1.0), ur(0.7, 1.3), us(-1., 1.);
+	for (int i = 0; i < prm.eddy_count; ++i)
+	{
+		eddy e;
+		e.centre = point(ux(rng), uy(rng));
+		e.amplitude = prm.eddy_amplitude * ua(rng) * (us(rng) < 0 ? -1 : 1);
+		e.radius = prm.eddy_radius * ur(rng);
+		eddies.push_back(e);
+	}
+}
+
+const synthetic_params &SyntheticFlow::params() const
+{
+	return prm;
+}
+
+double SyntheticFlow::eta(const point &pt) const
+{
+	double h = prm.slope / 100. * pt.y;
+	for (size_t i = 0; i < eddies.size(); ++i)
+	{
+		double dx = pt.x - eddies[i].centre.x, dy = pt.y - eddies[i].centre.y;
+		h += eddies[i].amplitude * exp(-(dx * dx + dy * dy) / (eddies[i].radius * eddies[i].radius));
+	}
+	return h;
+}
+
+void SyntheticFlow::velocity(const point &pt, double &u, double &v) const
+{
+	// градиент уровня [м/м]
+	double gx = 0.0, gy = prm.slope / 100. / 1000.;
+	for (size_t i = 0; i < eddies.size(); ++i)
+	{
+		double dx = pt.x - eddies[i].centre.x, dy = pt.y - eddies[i].centre.y, r2 = eddies[i].radius * eddies[i].radius;
+		double e = eddies[i].amplitude * exp(-(dx * dx + dy * dy) / r2);
+		gx += -2. * dx / r2 * e / 1000.;
+		gy += -2. * dy / r2 * e / 1000.;
+	}
+
+	double f = coriolis_koef(pt.at_geo_cs(prm.origin).y);
+	u = -G / f * gy;
+	v = G / f * gx;
+}
+
+bool SyntheticFlow::write_field(const char *file_name)
+{
+	TextWriter out(file_name);
+	if (!out.is_open())
+		return false;
+
+	std::mt19937 rng(prm.seed * 3 + SYN_SEED_FIELD);
+	std::uniform_real_distribution <double> ux(-prm.half_x, prm.half_x), uy(-prm.half_y, prm.half_y), u01(0., 1.);
+	std::normal_distribution <double> noise(0., prm.noise > 0 ? prm.noise : 1.);
+
+	for (size_t i = 0; i < prm.vector_count; ++i)
+	{
+		point start(ux(rng), uy(rng));
+		double u, v;
+		velocity(start, u, v);
+		double nu = noise(rng), nv = noise(rng);
+		if (prm.noise > 0)
+			u += nu, v += nv;
+		double speed = (u01(rng) < prm.zero_share) ? 0.0 : sqrt(u * u + v * v);
+
+		point end(start.x + u * prm.interval / 1000., start.y + v * prm.interval / 1000.);
+		int psx = (int)floor((start.x + prm.half_x) / prm.pixel_size), psy = (int)floor((prm.half_y - start.y) / prm.pixel_size);
+		int pex = (int)floor((end.x + prm.half_x) / prm.pixel_size), pey = (int)floor((prm.half_y - end.y) / prm.pixel_size);
+		start.to_geo_cs(prm.origin);
+		end.to_geo_cs(prm.origin);
+
+		out.put_fixed(start.x) << ' ';
+		out.put_fixed(start.y) << ' ';
+		out.put_fixed(end.x) << ' ';
+		out.put_fixed(end.y) << ' ' << psx << ' ' << psy << ' ' << pex << ' ' << pey << ' ';
+		out.put_fixed(0.8) << ' ';
+		out.put_fixed(speed) << ' ';
+		out.put_fixed(0.01) << '\n';
+	}
+	return true;
+}
+
+bool SyntheticFlow::write_cuts(const char *file_name, std::vector <scut> &geo_cuts)
+{
+	TextWriter out(file_name);
+	if (!out.is_open())
+		return false;
+
+	std::mt19937 rng(prm.seed * 3 + SYN_SEED_CUTS);
+	double margin = prm.cut_length / 2 + (prm.cut_width > 0 ? prm.cut_width : 10.);
+	std::uniform_real_distribution <double> ux(-std::max(prm.half_x - margin, 0.), std::max(prm.half_x - margin, 0.)),
+		uy(-std::max(prm.half_y - margin, 0.), std::max(prm.half_y - margin, 0.)), ua(0., M_PI), u01(0., 1.);
+
+	geo_cuts.clear();
+	for (int i = 0; i < prm.cut_count; ++i)
+	{
+		// первый разрез - через центр области: его середина задаёт локальную СК расчёта
+		point c = (i == 0) ? point(0., 0.) : point(ux(rng), uy(rng));
+		double a = ua(rng);
+		point start(c.x - prm.cut_length / 2 * cos(a), c.y - prm.cut_length / 2 * sin(a));
+		point end(c.x + prm.cut_length / 2 * cos(a), c.y + prm.cut_length / 2 * sin(a));
+
+		bool curved = u01(rng) < prm.curvature_share && !eddies.empty();
+		point cc;
+		if (curved)
+		{
+			size_t k = 0;
+			for (size_t j = 1; j < eddies.size(); ++j)
+				if (c.distance_to(eddies[j].centre) < c.distance_to(eddies[k].centre)) k = j;
+			cc = eddies[k].centre;
+			cc.to_geo_cs(prm.origin);
+		}
+		start.to_geo_cs(prm.origin);
+		end.to_geo_cs(prm.origin);
+
+		out.put_fixed(start.x) << ' ';
+		out.put_fixed(start.y) << ' ';
+		out.put_fixed(end.x) << ' ';
+		out.put_fixed(end.y) << ' ' << prm.cut_width << " -1 -1";
+		if (curved)
+		{
+			out << ' ';
+			out.put_fixed(cc.x) << ' ';
+			out.put_fixed(cc.y);
+		}
+		out << '\n';
+
+		if (curved)
+			geo_cuts.push_back(scut(vec(start, end), prm.cut_width, -1, -1, cc));
+		else
+			geo_cuts.push_back(scut(vec(start, end), prm.cut_width, -1, -1));
+	}
+	return true;
+}
+
+double SyntheticFlow::normal_velocity(const Line &cut_line, const point &pt) const
+{
+	double u, v;
+	velocity(pt, u, v);
+	double speed = sqrt(u * u + v * v);
+	if (speed == 0.0) return 0.0;
+	vec mv(pt, point(pt.x + u * prm.interval / 1000., pt.y + v * prm.interval / 1000.));
+	return speed * -sin(cut_line.angle(mv) * M_PI / 180);
+}
+
+double SyntheticFlow::expected_dt(const point &geo_start, const point &geo_end, const scut &geo_cut) const
+{
+	point start = geo_start, end = geo_end, cc = geo_cut.curvature_center;
+	start.to_dec_cs(prm.origin);
+	end.to_dec_cs(prm.origin);
+	cc.to_dec_cs(prm.origin);
+
+	Line cut_line(vec(start, end));
+	int n = SYN_QUADRATURE_STEPS;
+	double h = KM2M(vec(start, end).length()) / n;
+
+	// формула средних точек, как в Integral::take
+	double sum = 0.0;
+	for (int i = 0; i < n; ++i)
+	{
+		point pt(start.x + (i + 0.5) * (end.x - start.x) / n, start.y + (i + 0.5) * (end.y - start.y) / n);
+		double vn = normal_velocity(cut_line, pt);
+		double f = coriolis_koef(pt.at_geo_cs(prm.origin).y);
+		double curv_K = geo_cut.curvature_correction ? 1 / KM2M(cc.distance_to(pt)) : 0.;
+		sum += (f * vn + curv_K * vn * fabs(vn)) * h;
+	}
+	return sum / G;
+}
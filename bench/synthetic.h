@@ -0,0 +1,68 @@
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include "dt_defs.h"
+
+#include <vector>
+
+// Синтетическое поле скоростей для проверок и замеров: уровень моря - сумма гауссовых вихрей
+// и наклона, скорости - геострофические (с параметром Кориолиса широты точки) плюс шум.
+// Модель задаётся в локальной декартовой СК [км] с началом origin; первый разрез проходит
+// через origin, поэтому локальная СК расчёта совпадает с СК модели
+struct synthetic_params
+{
+	point origin;			// географический центр области
+	double half_x, half_y;	// [км] полуразмеры области
+	size_t vector_count;
+	int eddy_count;
+	double eddy_amplitude;	// [м] наибольшая амплитуда вихря (знак случайный)
+	double eddy_radius;		// [км]
+	double slope;			// [м / 100 км] наклон уровня вдоль оси y (фоновое течение)
+	double noise;			// [м/с] шум компонент скорости
+	double zero_share;		// доля векторов с нулевой скоростью (не попадают в коридоры)
+	double pixel_size;		// [км] шаг пиксельной сетки начал векторов
+	double interval;		// [с] интервал между снимками (длина вектора = скорость * interval)
+
+	int cut_count;
+	double cut_length;		// [км]
+	double cut_width;		// [км], -1 - по умолчанию программы
+	double curvature_share;	// доля разрезов с центром кривизны в центре ближайшего вихря
+	unsigned seed;
+
+	synthetic_params();
+};
+
+class SyntheticFlow
+{
+	struct eddy
+	{
+		point centre;	// [км]
+		double amplitude, radius;
+	};
+
+	synthetic_params prm;
+	std::vector <eddy> eddies;
+
+	// нормальная к разрезу компонента скорости в соглашении Interpolation::get_norm_comp
+	double normal_velocity(const Line &cut_line, const point &pt) const;
+
+public:
+	explicit SyntheticFlow(const synthetic_params &p);
+
+	const synthetic_params &params() const;
+
+	// уровень моря [м] и геострофическая скорость [м/с] в точке локальной СК
+	double eta(const point &pt) const;
+	void velocity(const point &pt, double &u, double &v) const;
+
+	// файлы в форматах <vp_out_file> и <boundary_points_list>
+	bool write_field(const char *file_name);
+	bool write_cuts(const char *file_name, std::vector <scut> &geo_cuts);
+
+	// Перепад ДТ [м] вдоль отрезка (географические координаты) по точному полю - тот же
+	// интеграл (f Vn + K Vn |Vn|) / g, что считает программа; без центра кривизны он равен
+	// разности уровня на концах отрезка
+	double expected_dt(const point &geo_start, const point &geo_end, const scut &geo_cut) const;
+};
+
+#endif // SYNTHETIC_H
@@ -0,0 +1,50 @@
+#ifndef CORRIDOR_FILTER_H
+#define CORRIDOR_FILTER_H
+
+#include "dt_defs.h"
+
+#include <cstddef>
+
+// уровни векторных инструкций, выбираемые при выполнении
+enum E_SIMD_LEVEL
+{
+	ESL_SCALAR,
+	ESL_AVX2,
+	ESL_AVX512
+};
+
+// наибольший уровень, поддерживаемый процессором
+E_SIMD_LEVEL simd_supported_level();
+
+// текущий уровень (по умолчанию - наибольший поддерживаемый)
+E_SIMD_LEVEL simd_level();
+
+// ограничение уровня (для проверок и сравнения), не выше поддерживаемого
+void set_simd_level(E_SIMD_LEVEL level);
+
+const char *simd_level_name(E_SIMD_LEVEL level);
+
+// Постоянные разреза для отбора коридора: те же величины и порядок операций, что в
+// Line::distance_to, Line::projection_of и Line::contains, поэтому отбор совпадает
+struct corridor_kernel_args
+{
+	double a, b, c;		// коэффициенты прямой разреза
+	double norm;		// sqrt(a * a + b * b)
+	double p1x, p1y;	// начало разреза
+	double dx, dy;		// конец разреза минус начало
+	double width;
+
+	corridor_kernel_args(const scut &cut);
+};
+
+// знаковое расстояние точки до прямой разреза - то же, что сравнивается с шириной при отборе
+double corridor_distance(const corridor_kernel_args &k, double x, double y);
+
+// Отбор векторов коридора среди кандидатов idx[0..n): знаковое расстояние до прямой
+// разреза, параметр проекции начала вектора на разрез и маска velocity > 0 считаются
+// сразу для 4 (AVX2) или 8 (AVX-512) векторов. Индексы отобранных векторов
+// записываются в sel в порядке idx, возвращается их количество
+size_t corridor_filter(const corridor_kernel_args &k, const double *x0, const double *y0,
+					   const double *velocity, const int *idx, size_t n, int *sel);
+
+#endif // CORRIDOR_FILTER_H
@@ -0,0 +1,46 @@
+#ifndef CUT_COEFS_H
+#define CUT_COEFS_H
+
+#include "dt_defs.h"
+#include "weight_kernel.h"
+
+#include <vector>
+
+#define CC_ANCHOR_STEP 0.25	// [град] шаг широт опорных точек таблицы Кориолиса
+#define CC_MAX_ERROR 1.e-15	// наибольшая ошибка табличного параметра Кориолиса в единицах 2 EARTH_OMEGA
+
+// широта [град] точки декартовой СК с началом origin - to_geo_cs без пересчёта долготы
+double latitude_at(const point &pt, const point &origin);
+
+// Коэффициенты подынтегральных функций вдоль разреза: параметр Кориолиса и кривизна потока.
+// Строятся один раз на разрез и общие для всех проходов и сеток интегрирования.
+// Параметр Кориолиса без таблицы - sin из libm в каждом узле (значения прежние), с таблицей (coriolis_table) -
+// по таблице sin и cos широт a опорных точек с шагом CC_ANCHOR_STEP: sin(a + e) = sin a cos e + cos a sin e,
+// |e| <= CC_ANCHOR_STEP / 2, cos e и sin e - многочлены Тейлора (остаток < 1e-22)
+class CutCoefs
+{
+	point origin;
+	bool coriolis_table;
+
+	std::vector <double> anchor_lat, anchor_sin, anchor_cos;
+
+	// кривизна: центр, начало и длина разреза [км], основание перпендикуляра из центра на разрез
+	// (расстояние от начала, может лежать вне разреза) и квадрат длины перпендикуляра
+	bool curvature, curvature_table;
+	point center, start;
+	double length, foot, perp2;
+
+public:
+	CutCoefs();
+
+	// cor_table - параметр Кориолиса по таблице опорных широт (ошибка до CC_MAX_ERROR), а не sin в узле;
+	// curv_table - кривизна по положению узла на разрезе (t), а не по его координатам
+	void set(const scut &cut, const point &dcs_origin, bool cor_table, bool curv_table);
+
+	// 2 Omega sin(широта pt)
+	double coriolis(const point &pt) const;
+	// 1 / расстояние [м] от центра кривизны до узла pt = start + t (end - start), 0 - без учёта кривизны
+	double curvature_koef(const point &pt, double t) const;
+};
+
+#endif // CUT_COEFS_H
@@ -0,0 +1,55 @@
+#ifndef DIAG_WRITER_H
+#define DIAG_WRITER_H
+
+#include "text_io.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#define DW_MAX_QUEUED (64 << 20) // [байт] предел ожидающего записи вывода, дальше расчёт ждёт
+
+// уровень диагностического вывода
+enum E_DIAG_LEVEL
+{
+	EDL_NONE,		// только файл результатов
+	EDL_SUMMARY,	// + DSC.txt, NVdec.txt и NVgeo.txt последнего разреза
+	EDL_FULL		// + NV%d.vec и AV%d.vec каждого разреза
+};
+
+const char *diag_level_name(E_DIAG_LEVEL level);
+
+// Запись диагностических файлов фоновым потоком: расчёт готовит содержимое файла в памяти
+// (TextWriter::open_memory) и ставит его в очередь, поток забирает очередь пачкой и пишет файлы
+class DiagWriter
+{
+	typedef std::pair <std::string, std::vector <char> > job;
+
+	std::mutex mtx;
+	std::condition_variable has_jobs, has_space;
+	std::vector <job> jobs;
+	size_t queued_bytes;
+	bool stopping;
+
+	std::thread worker;
+
+	void run();
+
+public:
+	DiagWriter();
+	~DiagWriter();
+
+	DiagWriter(const DiagWriter &) = delete;
+	DiagWriter &operator=(const DiagWriter &) = delete;
+
+	// содержимое out (режим памяти) записывается в file_name; out становится пустым
+	void submit(const std::string &file_name, TextWriter &out);
+
+	// запись всех поставленных файлов и остановка потока
+	void finish();
+};
+
+#endif // DIAG_WRITER_H
@@ -0,0 +1,77 @@
+#ifndef DT_CORE_H
+#define DT_CORE_H
+
+#include "dt_defs.h"
+#include "dynamic_topography.h"
+#include "field_store.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#define EC_CORE_SUCCESS 1000
+#define EC_CORE_FIELD 5001	// файл поля не найден, не читается или не содержит векторов
+
+////////////////////////////////////////////////////////////////////////////////
+// ------------------------------ чтение файлов ------------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+bool file_exists(const char *fname);
+
+// разрезы списка в географических координатах
+void read_cuts(const char *file_name, std::vector <scut> &cut);
+
+// разрезы списка перебора параметров (parse_sweep) и их сетки параметров
+void read_sweep(const char *file_name, std::vector <scut> &cut, std::vector <sweep_grid> &grid);
+
+// Изменения поля после предыдущего расчёта: строки "+ <строка поля>" (добавленный вектор) и
+// "- <строка поля>" (удалённый), векторы в географических координатах. false - файл не читается
+// или строка не разбирается (сообщение в std::cerr)
+bool read_field_delta(const char *file_name, std::vector <movement> &added, std::vector <movement> &removed);
+
+// Чтение поля (текстового или двоичного) по одному вектору без хранения всего поля.
+// start_pixels (если задан) получает пиксельные начала векторов (psx, psy) текстового файла,
+// у двоичного поля остаётся пустым
+void for_each_movement(const char *file_name, const std::function <void(const movement &)> &f, 
+					   std::vector <int> *start_pixels = NULL);
+
+void read_movement_field(const char *file_name, std::vector <movement> &mvn, std::vector <int> *start_pixels = NULL);
+
+////////////////////////////////////////////////////////////////////////////////
+// ------------------------------- DTField class -----------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+// Загруженное поле для встраивания расчёта ДТ: векторы один раз переводятся в локальную СК
+// с началом origin и индексируются, после чего compute считает разрезы без файлового
+// ввода-вывода. Поле неизменяемо, compute можно вызывать из нескольких потоков одновременно
+class DTField
+{
+	point geo_origin;
+	std::shared_ptr <const FieldStore> field;
+
+public:
+	DTField(std::shared_ptr <const FieldStore> store, const point &origin);
+
+	DTField(const DTField &) = delete;
+	DTField &operator=(const DTField &) = delete;
+
+	// поле файла (двоичное отображается в память) в локальной СК с началом origin
+	static int load(const char *file_name, const point &origin, std::shared_ptr <const DTField> &handle);
+
+	// векторы в географических координатах (mvn становится пустым)
+	static std::shared_ptr <const DTField> from_movements(std::vector <movement> &mvn, const point &origin);
+
+	size_t size() const;
+	const point &origin() const;
+	const FieldStore &store() const;
+
+	// ДТ разреза в географических координатах (как в списке разрезов); диагностические
+	// файлы не пишутся при любом options.diag_level. Возвращает код ошибки DynamicTopography
+	int compute(const scut &cut, const dt_options &options, dt_result &res) const;
+
+	// сочетания параметров grid для разреза cut (DynamicTopography::sweep), res[grid.index(...)]
+	void sweep(const scut &cut, const sweep_grid &grid, const dt_options &options, 
+			   std::vector <sweep_result> &res) const;
+};
+
+#endif // DT_CORE_H
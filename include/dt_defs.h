@@ -26,18 +26,16 @@ struct movement
 	vec mv;
 	double velocity;
 	double error;		// априорная ошибка
-	movement(vec v, double vl, double err) : mv(v), velocity(vl), error(err) {} 
+	movement(const vec &v, double vl, double err) : mv(v), velocity(vl), error(err) {} 
 };
 
 struct wvector
 {
-	movement mvn;
+	int idx;			// индекс вектора в хранилище поля (FieldStore)
 	point norm_comp;	//normal component for cut
 	point proj;			//start point projection on cut
 
-	wvector(movement _mvn, point nc, point pr) : mvn(_mvn), norm_comp(nc), proj(pr) {}
-
-	vec v() { return mvn.mv; }
+	wvector(int _idx, const point &nc, const point &pr) : idx(_idx), norm_comp(nc), proj(pr) {}
 };
 
 struct scut // Разрез
@@ -49,19 +47,36 @@ struct scut // Разрез
 	double weight_coef;
 	point curvature_center; // центр кривизны потока
 	bool curvature_correction = false; // учитывать ли кривизнц потока при расчете ДТ
+	double itg_tolerance = -1.0; // допуск адаптивного интегрирования разреза, -1 - общий
 
 	// cut(vec v, double w) : 
 		// start(v.start), end(v.end), width(w) {}
 
 	scut() {}
 
-	scut(vec v, double w, double id, double wc);
+	scut(const vec &v, double w, double id, double wc);
+
+	scut(const vec &v, double w, double id, double wc, const point &cc, bool correction = true);
 
-	scut(vec v, double w, double id, double wc, point cc, bool correction = true);
+	vec v() const;
 
-	vec v();
+	std::string toString(std::string name = std::string("")) const;
+};
 
-	std::string toString(std::string name = std::string(""));
+// Сетка параметров разреза для перебора: значения как в списке разрезов (-1 - ширина или
+// коэффициент по умолчанию, расчётный диаметр). Сочетания упорядочены по ширине, внутри -
+// по диаметру, внутри - по коэффициенту
+struct sweep_grid
+{
+	std::vector <double> width;
+	std::vector <double> itp_diameter;
+	std::vector <double> weight_coef;
+
+	size_t size() const { return width.size() * itp_diameter.size() * weight_coef.size(); }
+	size_t index(size_t iw, size_t id, size_t ik) const 
+	{ 
+		return (iw * itp_diameter.size() + id) * weight_coef.size() + ik; 
+	}
 };
 
 double coriolis_koef(double fi);
@@ -71,6 +86,7 @@ point geo2dec(const point &gp, const point &origin = point(0, 0));
 
 point dec2geo(const point &dp, const point &origin = point(0, 0));
 
-void to_cartesian_cs(std::vector <movement> &mvn, std::vector <scut> &station);
+// поле пересчитывается пакетно (geo_transform.h), большие поля - thread_count потоками
+void to_cartesian_cs(std::vector <movement> &mvn, std::vector <scut> &station, int thread_count = 1);
 
 #endif // DT_DEFS_H
\ No newline at end of file
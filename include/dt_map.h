@@ -0,0 +1,100 @@
+#ifndef DT_MAP_H
+#define DT_MAP_H
+
+#include "dt_defs.h"
+#include "dynamic_topography.h"
+#include "field_store.h"
+
+#include <cstdint>
+#include <vector>
+
+// Карта ДТ: узлы сетки с шагом spacing в локальной СК с началом в опорной точке (опорная точка -
+// узел сетки, ДТ в ней 0). Пути от опорной точки идут по сетке: по опорной строке до столбца узла,
+// затем по столбцу. Опорная строка и каждый столбец считаются одним неукороченным разрезом
+// (DynamicTopography::take_profile) с узлами интегрирования, выровненными по узлам сетки, так что
+// интеграл каждого отрезка между соседними узлами считается один раз и входит во все пути через него
+#define MAP_TILE_COLUMNS 8		// столбцов сетки в тайле (задаче пула потоков)
+#define MAP_MAX_NODES (1 << 26)	// наибольшее количество узлов карты
+#define MAP_NODATA -9999.0		// значение узлов без ДТ
+
+// Двоичный файл карты (little-endian): заголовок map_file_header, затем ny строк по nx значений
+// double, строка 0 - южная, узел (i, j) - точка (x0 + i * spacing, y0 + j * spacing) локальной СК
+#define MAP_MAGIC "DTMAP"
+#define MAP_VERSION 1
+
+// коды ошибок карты
+#define EC_MAP_SUCCESS 1000
+#define EC_MAP_SPEC 6001	// описание карты не читается или задаёт недопустимую сетку
+#define EC_MAP_OPEN 6002	// файл карты не создаётся или не открывается
+#define EC_MAP_FORMAT 6003	// файл не является двоичной картой этой версии
+
+struct map_spec
+{
+	point geo_min, geo_max;	// углы области (долгота, широта)
+	double spacing;			// шаг сетки, [км]
+	point geo_ref;			// опорная точка, начало локальной СК
+	double width;			// ширина коридора путей, -1 - по умолчанию (CUT_WIDTH)
+	double itp_diameter;	// диаметр интерполяции, -1 - расчётный (по каждому пути)
+	double weight_coef;		// весовой коэффициент (как в списке разрезов), -1 - по умолчанию
+
+	map_spec() : spacing(0.0), width(-1.0), itp_diameter(-1.0), weight_coef(-1.0) {}
+};
+
+struct map_file_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;	// FF_BYTE_ORDER в порядке байт записавшей машины
+	uint32_t nx, ny;
+	double ref_x, ref_y;	// опорная точка (географические координаты)
+	double x0, y0;			// узел (0, 0) в локальной СК, [км]
+	double spacing;			// [км]
+	double nodata;
+};
+
+// Описание карты - одна строка: долгота и широта юго-западного угла области, северо-восточного угла,
+// шаг сетки [км], долгота и широта опорной точки, затем необязательные ширина коридора, диаметр
+// интерполяции и весовой коэффициент (как в списке разрезов)
+int read_map_spec(const char *file_name, map_spec &spec);
+
+class DTMap
+{
+	map_spec spec;	// у прочитанной карты - только опорная точка и шаг
+	int ix0, iy0;	// номера узла (0, 0) от опорной точки
+	int nx, ny;
+	std::vector <double> value; // ny строк по nx узлов
+
+	// ошибки путей последнего compute
+	int row_code;
+	std::vector <int> column_code;
+
+public:
+	DTMap();
+
+	// сетка по описанию: область расширяется до узлов сетки и опорной точки
+	int set_spec(const map_spec &spec);
+
+	int width() const;
+	int height() const;
+	// узел (i, j) в локальной СК, [км]
+	point node(int i, int j) const;
+	double at(int i, int j) const;
+	const point &origin() const;
+
+	// ДТ узлов относительно опорной точки по полю field в локальной СК с началом в опорной точке.
+	// Опорная строка и тайлы по MAP_TILE_COLUMNS столбцов считаются на thread_count потоках над
+	// общим индексом поля, результат от разбиения на тайлы и количества потоков не зависит.
+	// Узлы путей с ошибкой и узлы, путь к которым выходит за крайние проекции векторов коридора
+	// строки или столбца, получают MAP_NODATA. Возвращает количество узлов с ДТ
+	size_t compute(const FieldStore &field, const dt_options &options, int thread_count);
+
+	// количество путей (строка и столбцы) с ошибкой в последнем compute
+	int failed_paths() const;
+
+	int write(const char *file_name) const;
+	int read(const char *file_name);
+	// ESRI ASCII grid в локальной СК, [км]: строки с севера на юг
+	int write_ascii(const char *file_name) const;
+};
+
+#endif // DT_MAP_H
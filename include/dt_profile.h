@@ -0,0 +1,93 @@
+#ifndef DT_PROFILE_H
+#define DT_PROFILE_H
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+// этапы расчёта; время этапа исключительное - вложенный этап не входит во время объемлющего
+enum E_PROFILE_PHASE
+{
+	EPP_READ,			// чтение поля и разрезов
+	EPP_TRANSFORM,		// пересчёт в локальную СК, хранилище поля
+	EPP_CORRIDOR,		// выбор коридора и проекции на разрез
+	EPP_SETUP,			// кэш коридора интерполяции
+	EPP_FIRST_PASS,		// первый проход интегрирования (начальная сетка адаптивного)
+	EPP_ACCURACY,		// ошибки интерполяции с исключением точки
+	EPP_SECOND_PASS,	// второй проход (уточнение сетки адаптивного)
+	EPP_OUTPUT,			// вывод результатов и диагностических файлов
+	EPP_COUNT
+};
+
+const char *profile_phase_name(E_PROFILE_PHASE phase);
+
+// Время этапов и счётчики одного разреза (или этапов запуска вне разрезов).
+// Заполняется одним потоком
+struct cut_profile
+{
+	int code;			// код результата разреза
+	double seconds[EPP_COUNT];
+	size_t corridor;	// векторов в коридоре
+	size_t steps;		// узлов интегрирования всех проходов
+	size_t neighbours;	// просмотренных соседей интерполяции (окна кэша коридора)
+
+	cut_profile();
+
+	// переключение этапа: время до момента переключения относится к текущему этапу
+	E_PROFILE_PHASE enter(E_PROFILE_PHASE phase);
+	void leave(E_PROFILE_PHASE outer);
+
+private:
+	E_PROFILE_PHASE active;	// EPP_COUNT - вне этапов
+	std::chrono::steady_clock::time_point since;
+
+	void charge(std::chrono::steady_clock::time_point now);
+};
+
+// Замер этапа на время области видимости (или до stop). Без профиля (NULL) ничего не делает,
+// поэтому при выключенном профилировании стоит одной проверки указателя
+class ProfileTimer
+{
+	cut_profile *profile;
+	E_PROFILE_PHASE outer;
+
+public:
+	ProfileTimer(cut_profile *p, E_PROFILE_PHASE phase) : profile(p), outer(EPP_COUNT)
+	{
+		if (profile != NULL) outer = profile->enter(phase);
+	}
+	~ProfileTimer()
+	{
+		stop();
+	}
+
+	ProfileTimer(const ProfileTimer &) = delete;
+	ProfileTimer &operator=(const ProfileTimer &) = delete;
+
+	void stop()
+	{
+		if (profile != NULL) profile->leave(outer);
+		profile = NULL;
+	}
+};
+
+// Профиль запуска: этапы вне разрезов и по записи на разрез (потоки пишут свои записи)
+class Profiler
+{
+	std::chrono::steady_clock::time_point started;
+	cut_profile run_profile;
+	std::vector <cut_profile> cuts;
+
+public:
+	Profiler();
+
+	void set_cut_count(size_t count);
+
+	cut_profile *run();
+	cut_profile *cut(size_t i);
+
+	// отчёт JSON: итоги по этапам и счётчикам и разбивка по разрезам
+	bool write(const char *file_name, int thread_count);
+};
+
+#endif // DT_PROFILE_H
@@ -0,0 +1,95 @@
+#ifndef DT_SERVER_H
+#define DT_SERVER_H
+
+#include "dt_core.h"
+#include "text_io.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define EC_SRV_SUCCESS 1000
+#define EC_SRV_SOCKET 4001		// сокет не создан (или не поддерживается системой)
+#define EC_SRV_FIELD 4002		// поле не загружено
+#define EC_SRV_REQUEST 4003		// неизвестный или неполный запрос
+
+#define SRV_MAX_LINE (1 << 16)	// [байт] предел строки запроса
+#define SRV_MAX_PENDING 64		// ответов соединения в очереди, больше - чтение соединения приостанавливается
+#define SRV_STOP_TIMEOUT 5000	// [мс] отправка оставшихся ответов после STOP
+
+// Сервер расчёта ДТ на локальном сокете (Unix domain socket): поле загружается один раз
+// в локальную СК с постоянным началом, запросы разрезов считаются над общим хранилищем.
+// Строчный протокол, ответ - одна строка на запрос:
+//   CUT <строка разреза как в списке разрезов>	-> OK <столбцы файла результатов> | ERR <код>
+//   RELOAD <файл поля>							-> OK <количество векторов> | ERR <код>
+//   QUIT - закрыть соединение, STOP - остановить сервер
+// Соединения читаются и пишутся одним потоком (poll), отдельные запросы CUT и RELOAD считаются
+// пулом потоков, так что соединений может быть больше, чем потоков. Ответы соединения идут в
+// порядке его запросов; строки после RELOAD ждут его завершения. Перезагрузка поля не прерывает
+// идущие расчёты: они дорабатывают со старым хранилищем
+class DTServer
+{
+public:
+	DTServer(const point &origin, const dt_options &opt, int thread_count);
+	~DTServer();
+
+	DTServer(const DTServer &) = delete;
+	DTServer &operator=(const DTServer &) = delete;
+
+	// поле файла в локальной СК сервера, возвращает код ошибки DTField::load
+	int load(const char *file_name);
+
+	// приём соединений и запросов до запроса STOP
+	int run(const char *socket_path);
+
+	// ответ на строку запроса [first, last) без перевода строки; false - закрыть соединение
+	bool answer(const char *first, const char *last, TextWriter &reply);
+
+private:
+	// ответ на запрос; готов (done), когда текст записан задачей пула
+	struct reply_slot
+	{
+		std::atomic <bool> done;
+		std::vector <char> text;
+
+		reply_slot() : done(false) {}
+	};
+
+	struct connection
+	{
+		int fd;
+		std::vector <char> in;		// принятые байты, с начала - неразобранные строки
+		size_t used;
+		std::deque <std::shared_ptr <reply_slot> > replies;	// ответы в порядке запросов
+		std::shared_ptr <reply_slot> reload;	// незавершённый RELOAD, следующие строки ждут его
+		std::vector <char> out;		// ответы к отправке
+		size_t sent;
+		bool reading;				// до QUIT или STOP
+		bool eof;					// клиент закончил передачу, принятые строки ещё разбираются
+		bool broken;				// ошибка сокета, клиент отключился или слишком длинная строка
+
+		explicit connection(int f) : fd(f), in(4096), used(0), sent(0), reading(true), eof(false), broken(false) {}
+	};
+
+	point origin;
+	dt_options options;
+
+	std::mutex field_mtx;
+	std::shared_ptr <const DTField> field;
+
+	ThreadPool pool;
+	std::atomic <bool> stopping;
+	int wake_fd[2];	// канал, которым задачи пула будят цикл опроса
+
+	std::shared_ptr <const DTField> current_field();
+
+	void receive(connection &c);
+	void parse_lines(connection &c);
+	void collect_replies(connection &c);
+	bool flush(connection &c);
+};
+
+#endif // DT_SERVER_H
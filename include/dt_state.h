@@ -0,0 +1,80 @@
+#ifndef DT_STATE_H
+#define DT_STATE_H
+
+#include "dt_core.h"
+#include "dt_defs.h"
+#include "dynamic_topography.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Состояние расчёта по списку разрезов для пересчёта после изменения поля (режим -u).
+// Текстовый файл: первая строка - DS_MAGIC, версия, старшая и младшая половины хэша списка
+// разрезов, количество разрезов, количество векторов поля и параметры расчёта (run_options);
+// далее строка на разрез: код ошибки и при успехе - строка результата (dt_result::print_to).
+// Результаты хранятся в виде вывода и выводятся без пересчёта
+#define DS_MAGIC "DTSTATE"
+#define DS_VERSION 2
+
+// коды ошибок чтения и записи состояния
+#define EC_DS_SUCCESS 1000
+#define EC_DS_OPEN 7001
+#define EC_DS_FORMAT 7002
+
+// хэш содержимого файла (FNV-1a), 0 - файл не читается
+uint64_t file_hash(const char *file_name);
+
+// Параметры расчёта, от которых зависят результаты разрезов (-a, -p, -o, -k и -m с бюджетом памяти
+// memory_budget [байт]), одной строкой без пробелов по краям: "a=<tol> p=<mode> o=<mode> k=<mode> m=<байт>",
+// допуск - с точностью до бита
+std::string run_options(const dt_options &options, size_t memory_budget);
+
+class RunState
+{
+	uint64_t cuts_hash;
+	std::string options;	// run_options расчёта
+	size_t field_count;
+	std::vector <int> code;
+	std::vector <std::string> line; // результат print_to с переводом строки
+
+public:
+	RunState();
+
+	// состояние без результатов для cut_count разрезов списка с хэшем hash, считаемых с
+	// параметрами opts (run_options)
+	void reset(uint64_t hash, const std::string &opts, size_t cut_count);
+
+	uint64_t cut_list_hash() const;
+	const std::string &run_options() const;
+	size_t cut_count() const;
+	size_t field_size() const;
+	void set_field_size(size_t count);
+
+	// результат разреза i; разные разрезы можно задавать из разных потоков
+	void set(size_t i, int ce, dt_result &res);
+	int result_code(size_t i) const;
+	const std::string &result(size_t i) const;
+
+	int read(const char *file_name);
+	int write(const char *file_name) const;
+};
+
+// Для каждого разреза cut (локальная СК) - количество векторов delta (локальная СК, становится
+// пустым), попадающих в его коридор. Векторы индексируются сеткой FieldStore, коридор отбирается
+// тем же select, что и в DynamicTopography::take
+void count_affected(const std::vector <scut> &cut, std::vector <movement> &delta, std::vector <int> &count);
+
+// Пересчёт результатов state после изменения поля: field - поле после изменения, cut - разрезы
+// списка, added и removed - изменение (всё в географических координатах). На thread_count потоках
+// считаются разрезы, в коридоре которых есть добавленный или удалённый вектор (при all - все
+// разрезы), результаты остальных сохраняются. Возвращает количество посчитанных разрезов.
+// Затронутый разрез считается заново целиком: разбиение - 5M и 10M интервалов по числу M векторов
+// коридора, концы - по крайним проекциям, так что изменение коридора сдвигает все узлы
+// интегрирования. Сохранённые коридор и подготовка Integral сэкономили бы только их отбор и
+// построение: по --profile 4.5% времени разреза на поле из 20000 векторов и 0.4% - из 500000
+size_t update_results(const DTField &field, const std::vector <scut> &cut, const std::vector <movement> &added,
+					  const std::vector <movement> &removed, const dt_options &options, int thread_count, 
+					  bool all, RunState &state);
+
+#endif // DT_STATE_H
@@ -3,9 +3,36 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
 
 #include "dt_defs.h"
+#include "dt_core.h"
+#include "dt_map.h"
+#include "dt_server.h"
+#include "dt_state.h"
+#include "corridor_filter.h"
+#include "cut_coefs.h"
+#include "field_file.h"
+#include "field_store.h"
+#include "field_tiles.h"
+#include "geo_transform.h"
 #include "geometry.h"
+#include "grid_cache.h"
+#include "weight_kernel.h"
+
+// ширина коридора по умолчанию - как в DynamicTopography::set_cut
+void set_default_width(scut &cut)
+{
+	if (cut.width == -1) cut.width = CUT_WIDTH;
+}
 
 void test_to_geo_transforms()
 {
@@ -81,4 +108,1082 @@ void test_geo2dec2geo(std::vector <movement> &mvn, point dcs_geo_origin)
 	f_geo_again.close();
 }
 
+// выбор коридоров разрезов по сетке поля векторными ядрами всех доступных уровней 
+// должен совпадать с полным перебором поля через Line
+void test_field_index(std::vector <movement> mvn, std::vector <scut> station)
+{
+	to_cartesian_cs(mvn, station);
+
+	std::vector <movement> field_mvn(mvn);
+	FieldStore field(field_mvn);
+
+	unsigned int failed_tests_amount = 0;
+	E_SIMD_LEVEL default_level = simd_level();
+
+	for (int level = ESL_SCALAR; level <= simd_supported_level(); ++level)
+	{
+		set_simd_level((E_SIMD_LEVEL)level);
+
+		for (size_t i = 0; i < station.size(); ++i)
+		{
+			set_default_width(station[i]);
+
+			std::vector <int> full, selected;
+			Line cut_line(station[i].v());
+			for (size_t j = 0; j < mvn.size(); ++j)
+				if (in_cut_corridor(cut_line, mvn[j], station[i].width))
+					full.push_back(j);
+
+			field.select(station[i], selected);
+
+			if (full != selected)
+			{
+				std::cout << simd_level_name((E_SIMD_LEVEL)level) << " cut " << i << ": FAIL (" 
+						<< full.size() << " vectors by full scan, " << selected.size() << " by field index)\n";
+				failed_tests_amount++;
+			}
+		}
+	}
+	set_simd_level(default_level);
+
+	std::cout << "field index corridor selection test (up to " << simd_level_name(simd_supported_level()) 
+			<< ") -- " << ((failed_tests_amount == 0) ? "SUCCESS" : "FAIL") << "\n";
+}
+
+// поле из двоичного файла (с сохранённой локальной СК и с пересчётом в другую СК)
+// должно совпадать с полем из векторов: те же векторы и те же коридоры разрезов
+void test_field_file(std::vector <movement> mvn, std::vector <scut> station)
+{
+	const char *file_name = "field_test.bin";
+	unsigned int failed_tests_amount = 0;
+
+	point geo_origin = station[0].v().middle();
+	std::vector <movement> dec_mvn(mvn);
+	to_cartesian_cs(dec_mvn, station);
+	std::vector <movement> store_mvn(dec_mvn);
+	FieldStore field(store_mvn);
+
+	if (write_field_file(file_name, mvn, &field, geo_origin) != EC_FF_SUCCESS)
+		return;
+	std::shared_ptr <FieldFile> ff = std::make_shared <FieldFile>();
+	if (ff->open(file_name) != EC_FF_SUCCESS)
+		return;
+
+	// вторая СК сдвинута на единицу последнего разряда широты: блок СК не подходит, пересчёт
+	point shifted_origin(geo_origin.x, nextafter(geo_origin.y, 90.));
+	FieldStore mapped(ff, geo_origin), recomputed(ff, shifted_origin);
+
+	for (size_t j = 0; j < dec_mvn.size(); ++j)
+	{
+		movement a = field.at(j), b = mapped.at(j);
+		if (a.mv.start.x != b.mv.start.x || a.mv.start.y != b.mv.start.y || a.mv.end.x != b.mv.end.x ||
+			a.mv.end.y != b.mv.end.y || a.velocity != b.velocity || a.error != b.error)
+		{
+			std::cout << "j = " << j << ": FAIL (mapped vector differs)\n";
+			failed_tests_amount++;
+			break;
+		}
+	}
+
+	std::vector <movement> shifted_mvn(mvn);
+	for (size_t j = 0; j < shifted_mvn.size(); ++j)
+	{
+		shifted_mvn[j].mv.start.to_dec_cs(shifted_origin);
+		shifted_mvn[j].mv.end.to_dec_cs(shifted_origin);
+	}
+	FieldStore shifted(shifted_mvn);
+
+	for (size_t i = 0; i < station.size(); ++i)
+	{
+		set_default_width(station[i]);
+
+		std::vector <int> a, b, c, d;
+		field.select(station[i], a);
+		mapped.select(station[i], b);
+		shifted.select(station[i], c);
+		recomputed.select(station[i], d);
+		if (a != b || c != d)
+		{
+			std::cout << "cut " << i << ": FAIL (corridor of binary field differs)\n";
+			failed_tests_amount++;
+		}
+	}
+
+	// количество векторов и смещение блока СК, при которых границы переполняются до размера файла
+	std::ifstream image_in(file_name, std::ios::binary);
+	std::string file_image((std::istreambuf_iterator <char>(image_in)), std::istreambuf_iterator <char>());
+	image_in.close();
+	for (int corruption = 0; corruption < 2; ++corruption)
+	{
+		std::string bad = file_image;
+		field_file_header *h = (field_file_header *)&bad[0];
+		if (corruption == 0) h->count = (uint64_t)1 << 61;
+		if (corruption == 1) h->frame_offset = UINT64_MAX - 7;
+		std::ofstream("field_test_bad.bin", std::ios::binary).write(bad.data(), bad.size());
+
+		FieldFile damaged;
+		if (damaged.open("field_test_bad.bin") == EC_FF_SUCCESS)
+		{
+			std::cout << "field file header corruption " << corruption << ": FAIL\n";
+			failed_tests_amount++;
+		}
+	}
+	remove("field_test_bad.bin");
+
+	remove(file_name);
+
+	// сохранённая сетка с убывающими началами ячеек или номером вектора за полем не принимается
+	std::vector <double> gx, gy;
+	for (size_t j = 0; j < dec_mvn.size(); ++j)
+		gx.push_back(dec_mvn[j].mv.start.x), gy.push_back(dec_mvn[j].mv.start.y);
+	FieldIndex index;
+	index.build(gx.data(), gy.data(), gx.size());
+	std::ostringstream saved;
+	index.write(saved);
+	std::string image = saved.str();
+	size_t cells = index.cell_count() + 1, n = gx.size();
+	size_t header_size = image.size() - (((cells + n) * sizeof(int32_t) + 7) & ~(size_t)7);
+	for (int corruption = 0; corruption < 3; ++corruption)
+	{
+		std::string bad = image;
+		int32_t *cs = (int32_t *)&bad[header_size];
+		if (corruption == 1) cs[cells / 2] = (int32_t)n + 1;
+		if (corruption == 2) cs[cells + n - 1] = (int32_t)n;
+		FieldIndex attached;
+		if (attached.attach(bad.data(), bad.size(), n) != (corruption == 0))
+		{
+			std::cout << "saved grid corruption " << corruption << ": FAIL\n";
+			failed_tests_amount++;
+		}
+	}
+
+	std::cout << "binary field file test -- " << ((failed_tests_amount == 0) ? "SUCCESS" : "FAIL") << "\n";
+}
+
+// коридоры разрезов по хранилищу из векторов тайлов (тайлы меньше коридора, бюджет
+// меньше поля) должны совпадать с коридорами по всему полю с точностью до нумерации
+void test_field_tiles(std::vector <movement> mvn, std::vector <scut> station)
+{
+	to_cartesian_cs(mvn, station);
+
+	unsigned int failed_tests_amount = 0;
+	TiledField tiles("field_test.tiles", mvn.size() * sizeof(tile_record) / 2, 3.);
+	for (size_t j = 0; j < mvn.size(); ++j)
+		tiles.add(mvn[j]);
+	tiles.finish();
+
+	std::vector <movement> field_mvn(mvn);
+	FieldStore field(field_mvn);
+
+	for (size_t i = 0; i < station.size(); ++i)
+	{
+		set_default_width(station[i]);
+
+		std::vector <int> full, selected;
+		field.select(station[i], full);
+
+		std::vector <movement> local;
+		tiles.gather(station[i], local);
+		FieldStore local_field(local);
+		local_field.select(station[i], selected);
+
+		bool same = (full.size() == selected.size());
+		for (size_t k = 0; same && k < full.size(); ++k)
+		{
+			movement a = field.at(full[k]), b = local_field.at(selected[k]);
+			same = a.mv.start.x == b.mv.start.x && a.mv.start.y == b.mv.start.y && a.velocity == b.velocity;
+		}
+		if (!same)
+		{
+			std::cout << "cut " << i << ": FAIL (" << full.size() << " vectors in the field, " 
+					<< selected.size() << " in the tiles)\n";
+			failed_tests_amount++;
+		}
+	}
+
+	std::cout << "field tiles test (" << tiles.tile_count() << " tiles, " << tiles.loads() << " loads) -- " 
+			<< ((failed_tests_amount == 0) ? "SUCCESS" : "FAIL") << "\n";
+}
+
+// снимок с теми же началами векторов (другие концы и скорости) получает сетку первого снимка,
+// коридоры по общей сетке совпадают с коридорами по собственной; снимок с другими началами - нет
+void test_grid_cache(std::vector <movement> mvn, std::vector <scut> station)
+{
+	point origin = station[0].v().middle();
+	std::vector <movement> no_mvn;
+	to_cartesian_cs(no_mvn, station);
+
+	std::vector <int> pixels(2 * mvn.size());
+	for (size_t j = 0; j < pixels.size(); ++j)
+		pixels[j] = (int)j;
+
+	std::vector <movement> next(mvn), shifted(mvn);
+	for (size_t j = 0; j < next.size(); ++j)
+	{
+		next[j].mv.end.x += 0.001;
+		next[j].velocity *= (j % 3 == 0) ? 0.0 : 1.1;
+		shifted[j].mv.start.x += 1.e-9;
+	}
+	std::vector <movement> own(next);
+	for (size_t j = 0; j < own.size(); ++j)
+	{
+		own[j].mv.start.to_dec_cs(origin);
+		own[j].mv.end.to_dec_cs(origin);
+	}
+
+	GridCache grids;
+	std::shared_ptr <const FieldStore> first = grids.make_store(mvn, pixels, origin);
+	std::shared_ptr <const FieldStore> second = grids.make_store(next, pixels, origin);
+	std::shared_ptr <const FieldStore> third = grids.make_store(shifted, pixels, origin);
+	FieldStore own_field(own);
+
+	unsigned int failed_tests_amount = 0;
+	if (first->shares_grid() || !second->shares_grid() || third->shares_grid() || grids.reused() != 1)
+	{
+		std::cout << "grid sharing: FAIL\n";
+		failed_tests_amount++;
+	}
+
+	for (size_t i = 0; i < station.size(); ++i)
+	{
+		set_default_width(station[i]);
+
+		std::vector <int> a, b;
+		second->select(station[i], a);
+		own_field.select(station[i], b);
+		if (a != b)
+		{
+			std::cout << "cut " << i << ": FAIL (corridor on the shared grid differs)\n";
+			failed_tests_amount++;
+		}
+	}
+
+	std::cout << "snapshot grid cache test -- " << ((failed_tests_amount == 0) ? "SUCCESS" : "FAIL") << "\n";
+}
+
+// расчёт через загруженное поле (разрезы в географических координатах) совпадает
+// с расчётом DynamicTopography по полю и разрезам, переведённым to_cartesian_cs
+void test_dt_field(std::vector <movement> mvn, std::vector <scut> station)
+{
+	point origin = station[0].v().middle();
+	std::vector <movement> geo_mvn(mvn);
+	std::shared_ptr <const DTField> handle = DTField::from_movements(geo_mvn, origin);
+
+	std::vector <scut> geo_station(station);
+	to_cartesian_cs(mvn, station);
+	FieldStore field(mvn);
+
+	dt_options options;
+	options.diag_level = EDL_NONE;
+
+	unsigned int failed_tests_amount = 0;
+	for (size_t i = 0; i < station.size(); ++i)
+	{
+		DynamicTopography dyn_tpg(field);
+		dyn_tpg.set_options(options);
+		dyn_tpg.set_cut(station[i]);
+		dyn_tpg.set_dcs_origin(origin);
+
+		dt_result a, b;
+		int ca = dyn_tpg.take(a);
+		int cb = handle->compute(geo_station[i], options, b);
+		if (ca != cb || (ca == EC_DT_SUCCESS && (a.dt != b.dt || a.vector_count != b.vector_count)))
+		{
+			std::cout << "cut " << i << ": FAIL (" << a.dt << " by file, " << b.dt << " by the field handle)\n";
+			failed_tests_amount++;
+		}
+	}
+
+	std::cout << "field handle test -- " << ((failed_tests_amount == 0) ? "SUCCESS" : "FAIL") << "\n";
+}
+
+// перебор параметров совпадает с расчётом разреза с каждым сочетанием (в обоих режимах точности)
+void test_sweep(std::vector <movement> mvn, std::vector <scut> station)
+{
+	point origin = station[0].v().middle();
+	std::shared_ptr <const DTField> handle = DTField::from_movements(mvn, origin);
+
+	sweep_grid grid;
+	grid.width = {4, -1, 15};
+	grid.itp_diameter = {-1, 6};
+	grid.weight_coef = {5, -1, 12, 20};
+
+	dt_options options;
+	options.diag_level = EDL_NONE;
+
+	unsigned int failed_tests_amount = 0;
+	size_t computed = 0;
+	// точный и быстрый режимы проходами 5M и 10M, точный - адаптивным интегрированием
+	for (int run = 0; run < 3; ++run)
+	{
+		int mode = (run == 1) ? EPR_FAST : EPR_EXACT;
+		options.precision = (E_PRECISION_MODE)mode;
+		options.itg_tolerance = (run == 2) ? 0.1 / 3 : -1.0;
+		for (size_t i = 0; i < station.size() && i < 4; ++i)
+		{
+			std::vector <sweep_result> res;
+			handle->sweep(station[i], grid, options, res);
+
+			for (size_t iw = 0; iw < grid.width.size(); ++iw)
+				for (size_t id = 0; id < grid.itp_diameter.size(); ++id)
+					for (size_t ik = 0; ik < grid.weight_coef.size(); ++ik)
+					{
+						scut cut = station[i];
+						cut.width = grid.width[iw];
+						cut.itp_diameter = grid.itp_diameter[id];
+						cut.weight_coef = grid.weight_coef[ik] / 1000;
+
+						dt_result one;
+						int code = handle->compute(cut, options, one);
+						const sweep_result &r = res[grid.index(iw, id, ik)];
+						if (r.first != code || (code == EC_DT_SUCCESS && (r.second.dt != one.dt || 
+							r.second.dt_error != one.dt_error || r.second.vector_count != one.vector_count ||
+							r.second.itg_res.interpolation_accuracy != one.itg_res.interpolation_accuracy ||
+							!r.second.cut.start.equal(one.cut.start) || !r.second.cut.end.equal(one.cut.end))))
+						{
+							std::cout << precision_mode_name((E_PRECISION_MODE)mode) << " cut " << i << " (" 
+									<< grid.width[iw] << ", " << grid.itp_diameter[id] << ", " << grid.weight_coef[ik] 
+									<< "): FAIL (" << r.second.dt << " by the sweep, " << one.dt << " by the cut)\n";
+							failed_tests_amount++;
+						}
+						computed += (code == EC_DT_SUCCESS);
+					}
+		}
+	}
+
+	std::cout << "parameter sweep test (" << computed << " combinations) -- " 
+			<< ((failed_tests_amount == 0) ? "SUCCESS" : "FAIL") << "\n";
+}
+
+// Профиль разреза заканчивается значением take с тем же количеством интервалов; карта не зависит от
+// количества потоков, в опорной точке ДТ 0, двоичный файл читается без потерь
+void test_dt_map(std::vector <movement> mvn, std::vector <scut> station)
+{
+	point origin = station[0].v().middle();
+	to_cartesian_cs(mvn, station);
+	FieldStore field(mvn);
+
+	unsigned int failed_tests_amount = 0;
+	for (size_t i = 0; i < station.size() && i < 8; ++i)
+	{
+		scut cut = station[i];
+		set_default_width(cut);
+		std::vector <int> crd;
+		field.select(cut, crd);
+		if (crd.size() < MIN_POINT_COUNT) continue;
+
+		Line cut_line(cut.v());
+		std::vector <wvector> wv;
+		for (size_t k = 0; k < crd.size(); ++k)
+		{
+			movement m = field.at(crd[k]);
+			wv.push_back(wvector(crd[k], cut_line.parallel(m.mv.end).projection_of(m.mv.start), 
+								 cut_line.projection_of(m.mv.start)));
+		}
+
+		Integral integral(cut, wv, field);
+		integral.set_dcs_origin(origin);
+		int count = 7, per_segment = 3;
+		std::vector <double> value;
+		struct itg_result itg_res;
+		integral.set_partitioning_count(count * per_segment);
+		int ca = integral.take(itg_res);
+		int cb = integral.take_profile(count, per_segment, value);
+		if (ca != cb || value.size() != (size_t)count + 1 || value[0] != 0.0 || 
+			value[count] != itg_res.lin_value + itg_res.sqr_value)
+		{
+			std::cout << "cut " << i << " profile: FAIL (" << value.back() << " by the profile, " 
+					<< itg_res.lin_value + itg_res.sqr_value << " by take)\n";
+			failed_tests_amount++;
+		}
+	}
+
+	map_spec spec;
+	spec.geo_ref = origin;
+	spec.geo_min = point(origin.x - 0.3, origin.y - 0.2);
+	spec.geo_max = point(origin.x + 0.3, origin.y + 0.2);
+	spec.spacing = 4.0;
+
+	dt_options options;
+	options.diag_level = EDL_NONE;
+
+	DTMap one, many, stored;
+	size_t valid = 0;
+	if (one.set_spec(spec) != EC_MAP_SUCCESS || many.set_spec(spec) != EC_MAP_SUCCESS)
+		failed_tests_amount++;
+	else
+	{
+		valid = one.compute(field, options, 1);
+		many.compute(field, options, 3);
+		if (one.write("dt_map_test.bin") != EC_MAP_SUCCESS || stored.read("dt_map_test.bin") != EC_MAP_SUCCESS)
+			failed_tests_amount++;
+		remove("dt_map_test.bin");
+
+		for (int j = 0; j < one.height(); ++j)
+			for (int i = 0; i < one.width(); ++i)
+			{
+				point pt = one.node(i, j);
+				bool reference = (pt.x == 0.0 && pt.y == 0.0);
+				if (one.at(i, j) != many.at(i, j) || (reference && one.at(i, j) != 0.0) ||
+					stored.width() != one.width() || stored.at(i, j) != one.at(i, j) || 
+					!stored.node(i, j).equal(pt))
+				{
+					std::cout << "map node (" << i << ", " << j << "): FAIL (" << one.at(i, j) << ", " 
+							<< many.at(i, j) << " on 3 threads)\n";
+					failed_tests_amount++;
+				}
+			}
+	}
+
+	// опорная строка области шире поля: ДТ есть только у узлов между крайними проекциями (по x)
+	// начал векторов её коридора
+	spec.geo_min.x = origin.x - 3.0, spec.geo_max.x = origin.x + 3.0;
+	DTMap wide;
+	if (wide.set_spec(spec) != EC_MAP_SUCCESS)
+		failed_tests_amount++;
+	else
+	{
+		wide.compute(field, options, 2);
+		int ref_j = 0, ref_i = 0;
+		while (wide.node(0, ref_j).y != 0.0) ++ref_j;
+		while (wide.node(ref_i, 0).x != 0.0) ++ref_i;
+
+		scut row(vec(wide.node(0, ref_j), wide.node(wide.width() - 1, ref_j)), -1, -1, -1);
+		set_default_width(row);
+		std::vector <int> crd;
+		field.select(row, crd);
+		double xmin = HUGE_VAL, xmax = -HUGE_VAL;
+		for (size_t k = 0; k < crd.size(); ++k)
+			xmin = std::min(xmin, field.at(crd[k]).mv.start.x), xmax = std::max(xmax, field.at(crd[k]).mv.start.x);
+
+		int outside = 0;
+		for (int i = 0; i < wide.width(); ++i)
+		{
+			double x = wide.node(i, ref_j).x;
+			bool expected = (i == ref_i) || (xmin <= x && x <= xmax);
+			if (!expected) ++outside;
+			if (expected != (wide.at(i, ref_j) != MAP_NODATA))
+			{
+				std::cout << "wide map node (" << i << ", " << ref_j << "): FAIL (" << wide.at(i, ref_j) 
+						<< " at x = " << x << ", corridor projections " << xmin << " .. " << xmax << ")\n";
+				failed_tests_amount++;
+			}
+		}
+		if (outside == 0)
+		{
+			std::cout << "wide map: FAIL (no reference row node outside the corridor projections)\n";
+			failed_tests_amount++;
+		}
+	}
+
+	// область через экватор: крайние x - на экваторе
+	map_spec equator;
+	equator.geo_ref = point(100.0, 5.0);
+	equator.geo_min = point(99.0, -5.0);
+	equator.geo_max = point(101.0, 5.0);
+	equator.spacing = 1.0;
+	DTMap eq;
+	if (eq.set_spec(equator) != EC_MAP_SUCCESS || 
+		eq.node(0, 0).x > point(99.0, 0.0).at_dec_cs(equator.geo_ref).x ||
+		eq.node(eq.width() - 1, 0).x < point(101.0, 0.0).at_dec_cs(equator.geo_ref).x)
+	{
+		std::cout << "equator map: FAIL (grid does not cover the equator)\n";
+		failed_tests_amount++;
+	}
+
+	std::cout << "DT map test (" << valid << " nodes) -- " 
+			<< ((failed_tests_amount == 0) ? "SUCCESS" : "FAIL") << "\n";
+}
+
+// Разрезы, затронутые изменением поля, - те, в коридоре которых есть вектор изменения (полный
+// перебор in_cut_corridor); состояние расчёта читается без потерь
+void test_run_state(std::vector <movement> mvn, std::vector <scut> station)
+{
+	point origin = station[0].v().middle();
+	std::vector <scut> geo_station(station);
+	std::vector <movement> field_a(mvn);
+	to_cartesian_cs(mvn, station);
+
+	// изменение - часть коридора первого разреза: затрагивает его и соседние разрезы, но не все
+	std::vector <movement> local_a(mvn);
+	FieldStore store_a(local_a);
+	scut first = station[0];
+	set_default_width(first);
+	std::vector <int> crd;
+	store_a.select(first, crd);
+
+	std::vector <movement> delta;
+	for (size_t k = 0; k < crd.size(); k += 5)
+		delta.push_back(mvn[crd[k]]);
+	std::vector <movement> changed(delta);
+
+	unsigned int failed_tests_amount = 0;
+	std::vector <int> count;
+	count_affected(station, changed, count);
+	size_t affected = 0;
+	for (size_t i = 0; i < station.size(); ++i)
+	{
+		scut cut = station[i];
+		set_default_width(cut);
+		double width = cut.width;
+		Line cut_line(cut.v());
+		int expected = 0;
+		for (size_t k = 0; k < delta.size(); ++k)
+			expected += in_cut_corridor(cut_line, delta[k], width);
+		if (count[i] != expected)
+		{
+			std::cout << "cut " << i << ": FAIL (" << count[i] << " changed vectors in the corridor, " 
+					<< expected << " by enumeration)\n";
+			failed_tests_amount++;
+		}
+		affected += (count[i] > 0);
+	}
+	if (affected == 0 || affected == station.size())
+	{
+		std::cout << "affected cuts: FAIL (" << affected << " of " << station.size() << ")\n";
+		failed_tests_amount++;
+	}
+
+	// результаты разных кодов - по полю из векторов изменения
+	std::vector <movement> geo_mvn;
+	for (size_t k = 0; k < delta.size(); ++k)
+	{
+		movement m = delta[k];
+		m.mv.start.to_geo_cs(origin);
+		m.mv.end.to_geo_cs(origin);
+		geo_mvn.push_back(m);
+	}
+	std::shared_ptr <const DTField> handle = DTField::from_movements(geo_mvn, origin);
+
+	RunState state, stored;
+	dt_options options;
+	options.itg_tolerance = 0.1 / 3;
+	state.reset(12345678901234567ull, run_options(options, 0), geo_station.size());
+	state.set_field_size(delta.size());
+	for (size_t i = 0; i < geo_station.size(); ++i)
+	{
+		dt_result res;
+		int ce = handle->compute(geo_station[i], dt_options(), res);
+		state.set(i, ce, res);
+	}
+	if (state.write("dt_state_test.txt") != EC_DS_SUCCESS || stored.read("dt_state_test.txt") != EC_DS_SUCCESS ||
+		stored.cut_list_hash() != state.cut_list_hash() || stored.cut_count() != state.cut_count() ||
+		stored.field_size() != state.field_size() || stored.run_options() != run_options(options, 0))
+		failed_tests_amount++;
+	else
+		for (size_t i = 0; i < geo_station.size(); ++i)
+			if (stored.result_code(i) != state.result_code(i) || stored.result(i) != state.result(i))
+			{
+				std::cout << "state of cut " << i << ": FAIL\n";
+				failed_tests_amount++;
+			}
+	remove("dt_state_test.txt");
+
+	// Поле B - поле A без двух векторов коридора первого разреза и с вектором рядом с ними:
+	// пересчёт затронутых разрезов состояния по A совпадает с полным расчётом по B, строки
+	// остальных разрезов остаются строками состояния по A
+	std::vector <movement> added, removed, field_b;
+	if (crd.size() >= 3)
+	{
+		removed.push_back(field_a[crd[0]]);
+		removed.push_back(field_a[crd[crd.size() / 2]]);
+		movement m = field_a[crd[1]];
+		m.mv.start.y += 0.001, m.mv.end.y += 0.001;
+		added.push_back(m);
+	}
+	for (size_t k = 0; k < field_a.size(); ++k)
+		if (crd.size() < 3 || (k != (size_t)crd[0] && k != (size_t)crd[crd.size() / 2]))
+			field_b.push_back(field_a[k]);
+	field_b.insert(field_b.end(), added.begin(), added.end());
+
+	std::vector <movement> geo_a(field_a), geo_b(field_b);
+	std::shared_ptr <const DTField> on_a = DTField::from_movements(geo_a, origin);
+	std::shared_ptr <const DTField> on_b = DTField::from_movements(geo_b, origin);
+
+	RunState updated, full;
+	updated.reset(1, run_options(options, 0), geo_station.size());
+	full.reset(1, run_options(options, 0), geo_station.size());
+	update_results(*on_a, geo_station, added, removed, options, 2, true, updated);
+	RunState previous(updated);
+	size_t recomputed = update_results(*on_b, geo_station, added, removed, options, 2, false, updated);
+	update_results(*on_b, geo_station, added, removed, options, 1, true, full);
+
+	if (added.empty() || recomputed == 0 || recomputed >= geo_station.size() || updated.field_size() != on_b->size())
+	{
+		std::cout << "field A to B: FAIL (" << recomputed << " of " << geo_station.size() << " cuts recomputed)\n";
+		failed_tests_amount++;
+	}
+
+	// незатронутые разрезы - перебором in_cut_corridor по изменению в локальной СК
+	std::vector <movement> local_delta(added);
+	local_delta.insert(local_delta.end(), removed.begin(), removed.end());
+	to_dec_cs(local_delta, origin);
+	size_t kept = 0;
+	for (size_t i = 0; i < station.size(); ++i)
+	{
+		scut cut = station[i];
+		set_default_width(cut);
+		Line cut_line(cut.v());
+		bool touched = false;
+		for (size_t k = 0; k < local_delta.size(); ++k)
+			touched = touched || in_cut_corridor(cut_line, local_delta[k], cut.width);
+		if (touched) continue;
+
+		++kept;
+		if (updated.result_code(i) != previous.result_code(i) || updated.result(i) != previous.result(i))
+		{
+			std::cout << "cut " << i << " on field B: FAIL (untouched result differs from the state on A)\n";
+			failed_tests_amount++;
+		}
+	}
+	if (kept + recomputed != geo_station.size())
+	{
+		std::cout << "field A to B: FAIL (" << kept << " untouched and " << recomputed << " recomputed of " 
+				<< geo_station.size() << " cuts)\n";
+		failed_tests_amount++;
+	}
+	for (size_t i = 0; i < geo_station.size(); ++i)
+		if (updated.result_code(i) != full.result_code(i) || updated.result(i) != full.result(i))
+		{
+			std::cout << "cut " << i << " on field B: FAIL (incremental result differs from the full run)\n";
+			failed_tests_amount++;
+		}
+
+	std::cout << "incremental run test (" << affected << " of " << station.size() << " cuts affected, " 
+			<< recomputed << " recomputed on field B) -- " 
+			<< ((failed_tests_amount == 0) ? "SUCCESS" : "FAIL") << "\n";
+}
+
+#ifndef _WIN32
+
+// соединение с сервером; -1 - сокет не появился за время ожидания
+int connect_server(const char *socket_name)
+{
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socket_name);
+	for (int attempt = 0; attempt < 500; ++attempt)
+	{
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (connect(fd, (sockaddr *)&addr, sizeof(addr)) == 0)
+			return fd;
+		close(fd);
+		usleep(10000);
+	}
+	return -1;
+}
+
+// строка ответа без перевода строки; пустая - нет ответа за timeout_ms
+std::string read_reply(int fd, int timeout_ms)
+{
+	std::string line;
+	char ch;
+	pollfd pfd = {fd, POLLIN, 0};
+	while (poll(&pfd, 1, timeout_ms) > 0 && recv(fd, &ch, 1, 0) == 1)
+	{
+		if (ch == '\n') return line;
+		line += ch;
+	}
+	return std::string();
+}
+
+// строка разреза в формате списка разрезов
+std::string cut_request(const scut &cut)
+{
+	std::ostringstream request;
+	request.precision(17);
+	request << cut.start.x << ' ' << cut.start.y << ' ' << cut.end.x << ' ' << cut.end.y << ' ' 
+			<< cut.width << ' ' << cut.itp_diameter << ' ' << cut.weight_coef;
+	return request.str();
+}
+
+// ответ сервера на CUT <line> по полю handle, без перевода строки
+std::string expected_reply(const DTField &handle, const dt_options &options, const std::string &line)
+{
+	scut parsed;
+	const char *p = line.c_str();
+	parse_cut(p, line.c_str() + line.size(), parsed);
+	dt_result res;
+	TextWriter expected;
+	expected.open_memory();
+	int ce = handle.compute(parsed, options, res);
+	if (ce == EC_DT_SUCCESS)
+	{
+		expected << "OK ";
+		res.print_to(expected);
+	}
+	else
+		expected << "ERR " << ce << '\n';
+	std::vector <char> text;
+	expected.release(text);
+	return std::string(text.begin(), text.end() - 1);
+}
+
+// Клиентов больше, чем потоков сервера: соединения не занимают потоки, и клиент, подключившийся
+// последним, получает ответ, пока соединения остальных открыты. Ответы совпадают с DTField::compute.
+// Запросы одного клиента разом (разрезы вокруг RELOAD, последняя строка без перевода строки перед
+// концом передачи) получают ответы в порядке запросов, разрезы после RELOAD - по новому полю
+void test_dt_server(std::vector <movement> mvn, std::vector <scut> station)
+{
+	const char *field_name = "dt_server_test.bin", *socket_name = "dt_server_test.sock";
+	const char *half_name = "dt_server_test_half.bin";
+	point origin = station[0].v().middle();
+	std::vector <movement> half;
+	for (size_t k = 0; k < mvn.size(); k += 2)
+		half.push_back(mvn[k]);
+	if (write_field_file(field_name, mvn, NULL, origin) != EC_FF_SUCCESS ||
+		write_field_file(half_name, half, NULL, origin) != EC_FF_SUCCESS)
+		return;
+
+	dt_options options;
+	options.diag_level = EDL_NONE;
+	std::shared_ptr <const DTField> handle, half_handle;
+	DTField::load(field_name, origin, handle);
+	DTField::load(half_name, origin, half_handle);
+
+	const int thread_count = 2;
+	DTServer server(origin, options, thread_count);
+	server.load(field_name);
+	std::thread serving([&server, socket_name]() { server.run(socket_name); });
+
+	const int client_count = 3;
+	unsigned int failed_tests_amount = 0;
+	std::vector <int> fd(client_count);
+	for (int c = 0; c < client_count; ++c)
+		fd[c] = connect_server(socket_name);
+
+	// запросы - с последнего клиента: при потоке на соединение он ждал бы закрытия первого
+	for (int c = client_count - 1; c >= 0; --c)
+	{
+		if (fd[c] < 0)
+		{
+			failed_tests_amount++;
+			continue;
+		}
+
+		// ожидаемый ответ - по той же строке разреза
+		std::string line = cut_request(station[c % station.size()]);
+		std::string text = expected_reply(*handle, options, line);
+
+		line = "CUT " + line + "\n";
+		send(fd[c], line.c_str(), line.size(), MSG_NOSIGNAL);
+		std::string reply = read_reply(fd[c], 10000);
+		if (reply != text)
+		{
+			std::cout << "client " << c << ": FAIL (" << (reply.empty() ? "no reply" : reply.c_str()) << ")\n";
+			failed_tests_amount++;
+		}
+	}
+
+	// конвейер: CUT, CUT, RELOAD половины поля, CUT, CUT, RELOAD всего поля, CUT без перевода строки
+	int pipe_fd = connect_server(socket_name);
+	if (pipe_fd >= 0)
+	{
+		std::string request;
+		std::vector <std::string> expected;
+		for (int r = 0; r < 7; ++r)
+		{
+			if (r == 2 || r == 5)
+			{
+				const char *name = (r == 2) ? half_name : field_name;
+				request += std::string("RELOAD ") + name;
+				expected.push_back("OK " + std::to_string(((r == 2) ? half_handle : handle)->size()));
+			}
+			else
+			{
+				std::string line = cut_request(station[r % station.size()]);
+				request += "CUT " + line;
+				expected.push_back(expected_reply((r == 3 || r == 4) ? *half_handle : *handle, options, line));
+			}
+			if (r + 1 < 7) request += '\n';
+		}
+		send(pipe_fd, request.c_str(), request.size(), MSG_NOSIGNAL);
+		shutdown(pipe_fd, SHUT_WR);
+
+		for (size_t r = 0; r < expected.size(); ++r)
+		{
+			std::string reply = read_reply(pipe_fd, 10000);
+			if (reply != expected[r])
+			{
+				std::cout << "pipelined request " << r << ": FAIL (" << (reply.empty() ? "no reply" : reply.c_str()) 
+						<< ")\n";
+				failed_tests_amount++;
+			}
+		}
+		close(pipe_fd);
+	}
+	else
+		failed_tests_amount++;
+
+	for (int c = 0; c < client_count; ++c)
+		if (fd[c] >= 0)
+		{
+			const char *last = (c + 1 < client_count) ? "QUIT\n" : "STOP\n";
+			send(fd[c], last, strlen(last), MSG_NOSIGNAL);
+		}
+	// без открытых соединений STOP - через новое
+	if (fd[client_count - 1] < 0)
+	{
+		int stop_fd = connect_server(socket_name);
+		if (stop_fd >= 0) send(stop_fd, "STOP\n", 5, MSG_NOSIGNAL), close(stop_fd);
+	}
+	serving.join();
+	for (int c = 0; c < client_count; ++c)
+		if (fd[c] >= 0) close(fd[c]);
+	remove(field_name);
+	remove(half_name);
+
+	std::cout << "DT server test (" << client_count << " clients, " << thread_count << " threads) -- " 
+			<< ((failed_tests_amount == 0) ? "SUCCESS" : "FAIL") << "\n";
+}
+
+#endif
+
+// профиль не меняет результат; коридор - векторы результата, узлы - 5M + 10M двух проходов
+void test_profile(std::vector <movement> mvn, std::vector <scut> station)
+{
+	point origin = station[0].v().middle();
+	to_cartesian_cs(mvn, station);
+	FieldStore field(mvn);
+
+	dt_options options;
+	options.diag_level = EDL_NONE;
+
+	unsigned int failed_tests_amount = 0;
+	for (size_t i = 0; i < station.size(); ++i)
+	{
+		DynamicTopography dyn_tpg(field);
+		dyn_tpg.set_options(options);
+		dyn_tpg.set_cut(station[i]);
+		dyn_tpg.set_dcs_origin(origin);
+
+		dt_result a, b;
+		int ca = dyn_tpg.take(a);
+		cut_profile prof;
+		dyn_tpg.set_profile(&prof);
+		dyn_tpg.set_cut(station[i]);
+		int cb = dyn_tpg.take(b);
+		if (ca != cb || (ca == EC_DT_SUCCESS && (a.dt != b.dt || prof.corridor != (size_t)b.vector_count || 
+			prof.steps != 15 * prof.corridor || prof.neighbours == 0)))
+		{
+			std::cout << "cut " << i << ": FAIL (" << prof.corridor << " vectors, " << prof.steps << " nodes)\n";
+			failed_tests_amount++;
+		}
+	}
+
+	std::cout << "profile test -- " << ((failed_tests_amount == 0) ? "SUCCESS" : "FAIL") << "\n";
+}
+
+// приближённая экспонента в пределах FE_MAX_REL_ERROR от exp, суммы векторных ядер
+// весовой функции всех доступных уровней - в пределах той же ошибки от суммирования через exp
+void test_weight_kernel()
+{
+	unsigned int failed_tests_amount = 0;
+
+	double max_rel_err = 0.0;
+	for (int i = 0; i <= 1000000; ++i)
+	{
+		double x = FE_MIN_ARG * i / 1000000;
+		max_rel_err = std::max(max_rel_err, fabs(fast_exp(x) - exp(x)) / exp(x));
+	}
+	if (max_rel_err > FE_MAX_REL_ERROR)
+	{
+		std::cout << "fast exp: FAIL (max relative error " << max_rel_err << ")\n";
+		failed_tests_amount++;
+	}
+
+	// окно соседей вокруг точки интерполяции, часть точек - за радиусом
+	std::vector <double> x, y, nc;
+	for (int j = 0; j < 103; ++j)
+	{
+		x.push_back(0.37 * j - 19.);
+		y.push_back(0.05 * (j % 7) - 0.1);
+		nc.push_back(sin(0.1 * j) - 0.2);
+	}
+	weight_kernel_args a;
+	a.px = 0.11, a.py = 0.02, a.k = 0.01, a.R2 = 15. * 15.;
+	a.cutoff = fast_exp(- a.k * a.R2);
+
+	double S0 = 0.0, V0 = 0.0, nc_abs = 0.0;
+	for (size_t j = 0; j < x.size(); ++j)
+	{
+		double r2 = (x[j] - a.px) * (x[j] - a.px) + (y[j] - a.py) * (y[j] - a.py);
+		if (r2 > a.R2) continue;
+		double w = exp(- a.k * r2) - exp(- a.k * a.R2);
+		S0 += w, V0 += nc[j] * w, nc_abs += fabs(nc[j]) * w;
+	}
+
+	E_SIMD_LEVEL default_level = simd_level();
+	for (int level = ESL_SCALAR; level <= simd_supported_level(); ++level)
+	{
+		set_simd_level((E_SIMD_LEVEL)level);
+
+		double S, V;
+		weight_window(a, &x[0], &y[0], &nc[0], x.size(), S, V);
+		if (fabs(S - S0) > 10 * FE_MAX_REL_ERROR * S0 || fabs(V - V0) > 10 * FE_MAX_REL_ERROR * nc_abs)
+		{
+			std::cout << simd_level_name((E_SIMD_LEVEL)level) << " weight window: FAIL (S = " << S 
+					<< " vs " << S0 << ", V = " << V << " vs " << V0 << ")\n";
+			failed_tests_amount++;
+		}
+
+		// набор коэффициентов - те же суммы, что по одному
+		weight_multi_args ma;
+		ma.px = a.px, ma.py = a.py, ma.R2 = a.R2, ma.m = WK_MAX_COEFS;
+		for (int c = 0; c < ma.m; ++c)
+			ma.k[c] = 0.002 * (c + 1), ma.cutoff[c] = fast_exp(- ma.k[c] * ma.R2);
+		double mS[WK_MAX_COEFS], mV[WK_MAX_COEFS];
+		weight_window_multi(ma, &x[0], &y[0], &nc[0], x.size(), mS, mV);
+		for (int c = 0; c < ma.m; ++c)
+		{
+			weight_kernel_args ca = a;
+			ca.k = ma.k[c], ca.cutoff = ma.cutoff[c];
+			weight_window(ca, &x[0], &y[0], &nc[0], x.size(), S, V);
+			if (mS[c] != S || mV[c] != V)
+			{
+				std::cout << simd_level_name((E_SIMD_LEVEL)level) << " weight window for coefficient " << c 
+						<< ": FAIL (S = " << mS[c] << " vs " << S << ", V = " << mV[c] << " vs " << V << ")\n";
+				failed_tests_amount++;
+			}
+		}
+	}
+	set_simd_level(default_level);
+
+	std::cout << "fast weight kernel test (max exp relative error " << max_rel_err << ", up to " 
+			<< simd_level_name(simd_supported_level()) << ") -- " 
+			<< ((failed_tests_amount == 0) ? "SUCCESS" : "FAIL") << "\n";
+}
+
+// Радиус параллели - в пределах GT_MAX_REL_ERROR от расчёта в long double; пакетный пересчёт
+// векторными ядрами всех уровней и несколькими потоками совпадает с поточечным
+void test_geo_transform(const std::vector <movement> &mvn, const point &origin)
+{
+	unsigned int failed_tests_amount = 0;
+
+	double max_rel_err = 0.0;
+	for (int i = -1000000; i <= 1000000; ++i)
+	{
+		double lat = 89.999 * i / 1000000;
+		// у полюса cos через sin дополнительного угла: иначе ошибка аргумента cosl велика
+		long double a = fabsl(lat) > 45 ? (90.L - fabsl(lat)) * (M_PIl / 180) : 0.L;
+		long double s = fabsl(lat) > 45 ? copysignl(cosl(a), lat) : sinl(lat * (M_PIl / 180));
+		long double c = fabsl(lat) > 45 ? sinl(a) : cosl(lat * (M_PIl / 180));
+		long double f = (long double)(EQUATOR_RADIUS - POLAR_RADIUS) / EQUATOR_RADIUS;
+		long double r = EQUATOR_RADIUS * (1.L - f * s * s) * c;
+		max_rel_err = std::max(max_rel_err, (double)fabsl((parallel_radius(lat) - r) / r));
+	}
+	if (max_rel_err > GT_MAX_REL_ERROR)
+	{
+		std::cout << "parallel radius: FAIL (max relative error " << max_rel_err << ")\n";
+		failed_tests_amount++;
+	}
+
+	// поле, повторённое до размера, на котором пересчёт делится между потоками
+	std::vector <movement> geo;
+	while (geo.size() < GT_PARALLEL_MIN + 77)
+		geo.insert(geo.end(), mvn.begin(), mvn.end());
+
+	std::vector <movement> own(geo);
+	for (size_t j = 0; j < own.size(); ++j)
+	{
+		own[j].mv.start.to_dec_cs(origin);
+		own[j].mv.end.to_dec_cs(origin);
+	}
+	std::vector <double> x(own.size()), y(own.size()), lon(own.size()), lat(own.size());
+	for (size_t j = 0; j < own.size(); ++j)
+		x[j] = own[j].mv.end.x, y[j] = own[j].mv.end.y;
+
+	E_SIMD_LEVEL default_level = simd_level();
+	for (int level = ESL_SCALAR; level <= simd_supported_level(); ++level)
+	{
+		set_simd_level((E_SIMD_LEVEL)level);
+		for (int threads = 1; threads <= 3; threads += 2)
+		{
+			std::vector <movement> batch(geo);
+			to_dec_cs(batch, origin, threads);
+			to_geo_cs(x.data(), y.data(), lon.data(), lat.data(), x.size(), origin, threads);
+
+			size_t bad = 0;
+			for (size_t j = 0; j < own.size(); ++j)
+			{
+				point g = own[j].mv.end.at_geo_cs(origin);
+				if (!batch[j].mv.start.equal(own[j].mv.start) || !batch[j].mv.end.equal(own[j].mv.end) ||
+					!g.equal(point(lon[j], lat[j])))
+					++bad;
+			}
+			if (bad > 0)
+			{
+				std::cout << simd_level_name((E_SIMD_LEVEL)level) << ", " << threads << " threads: FAIL (" 
+						<< bad << " points differ from the per-point transform)\n";
+				failed_tests_amount++;
+			}
+		}
+	}
+	set_simd_level(default_level);
+
+	std::cout << "batch geo transform test (max radius relative error " << max_rel_err << ") -- " 
+			<< ((failed_tests_amount == 0) ? "SUCCESS" : "FAIL") << "\n";
+}
+
+// Параметр Кориолиса без таблицы совпадает с прежним расчётом через at_geo_cs, по таблице 
+// (coriolis_table) - в пределах CC_MAX_ERROR; кривизна по положению узла - в пределах ошибок округления
+void test_cut_coefs()
+{
+	unsigned int failed_tests_amount = 0;
+
+	double max_err = 0.0, max_curv_err = 0.0;
+	size_t exact_bad = 0;
+	for (int o = -8; o <= 8; ++o)
+	{
+		point origin(140. + o, 10. * o + 0.37);
+		// разрезы разной длины и направления, центр кривизны сбоку
+		for (int c = 0; c < 6; ++c)
+		{
+			double len = 20. * (c + 1) * (c + 1), ang = 0.7 * c + 0.2;
+			scut cut(vec(point(-len / 2 * cos(ang), -len / 2 * sin(ang) + 5. * c), 
+						 point(len / 2 * cos(ang), len / 2 * sin(ang) + 5. * c)), -1, -1, -1, 
+					 point(30. - 7. * c, 40. + 3. * c), true);
+
+			CutCoefs exact, fast, curv;
+			exact.set(cut, origin, false, false);
+			fast.set(cut, origin, true, false);
+			curv.set(cut, origin, false, true);
+
+			int count = 1000;
+			for (int j = 0; j <= count; ++j)
+			{
+				double t = (double)j / count;
+				point pt(cut.start.x + j * (cut.end.x - cut.start.x) / count, 
+						 cut.start.y + j * (cut.end.y - cut.start.y) / count);
+				double old = coriolis_koef(pt.at_geo_cs(origin).y);
+				if (exact.coriolis(pt) != old)
+					++exact_bad;
+				max_err = std::max(max_err, fabs(fast.coriolis(pt) - old) / (2 * EARTH_OMEGA));
+
+				double direct = exact.curvature_koef(pt, t);
+				max_curv_err = std::max(max_curv_err, fabs(curv.curvature_koef(pt, t) - direct) / direct);
+			}
+		}
+	}
+	if (exact_bad > 0)
+	{
+		std::cout << "exact coriolis: FAIL (" << exact_bad << " nodes differ from the at_geo_cs latitude)\n";
+		failed_tests_amount++;
+	}
+	if (max_err > CC_MAX_ERROR)
+	{
+		std::cout << "coriolis table: FAIL (max error " << max_err << " of 2 Omega)\n";
+		failed_tests_amount++;
+	}
+	if (max_curv_err > 1.e-12)
+	{
+		std::cout << "curvature table: FAIL (max relative error " << max_curv_err << ")\n";
+		failed_tests_amount++;
+	}
+
+	std::cout << "cut coefficients test (max coriolis table error " << max_err << ", curvature " 
+			<< max_curv_err << ") -- " << ((failed_tests_amount == 0) ? "SUCCESS" : "FAIL") << "\n";
+}
+
 #endif // DT_TESTS_H
\ No newline at end of file
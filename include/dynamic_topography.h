@@ -1,18 +1,23 @@
 #ifndef DYNAMIC_TOPOGRAPHY_H
 #define DYNAMIC_TOPOGRAPHY_H
 
+#include "diag_writer.h"
 #include "dt_defs.h"
+#include "field_store.h"
 #include "integration.h"
+#include "text_io.h"
 
 #include <vector>
 #include <fstream>
 #include <iostream>
 
 #define CUT_WIDTH 10 // [км]
+#define PROFILE_EPS 1e-9 // допуск положения крайних проекций take_profile, [шагов точек]
 
 // коды ошибок при расчете перепада динамических высот
 #define EC_DT_SUCCESS 1000
 #define EC_DT_FVF_EMPTY 1002
+#define EC_DT_ZERO_CORIOLIS 1003 // допуск адаптивного интегрирования не переводится: f = 0 на всём разрезе
 
 struct dt_result
 {
@@ -28,30 +33,77 @@ struct dt_result
 
 	dt_result();
 
-	void set(scut _cut, int vc);
+	void set(const scut &_cut, int vc);
 
 	void calc_dt(double latitude);
 
-	void print_to(std::ofstream &file);
+	void print_to(TextWriter &file);
+};
+
+// результат сочетания параметров перебора: код ошибки и результат (при коде EC_DT_SUCCESS)
+typedef std::pair <int, dt_result> sweep_result;
+
+// параметры расчёта, общие для всех разрезов
+struct dt_options
+{
+	double itg_tolerance; // допуск адаптивного интегрирования (в единицах dt_error), -1 - проходы 5M и 10M
+	E_PRECISION_MODE precision; // точность весовой функции интерполяции
+	E_DIAG_LEVEL diag_level; // диагностические файлы разрезов
+	bool coriolis_table; // параметр Кориолиса по таблице опорных широт (Integral::set_coriolis_table)
+	bool curvature_table; // кривизна потока по положению узла на разрезе (Integral::set_curvature_table)
+
+	dt_options() : itg_tolerance(-1.0), precision(EPR_EXACT), diag_level(EDL_FULL), coriolis_table(false), 
+		curvature_table(false) {}
 };
 
 class DynamicTopography
 {
 	scut cut;
 	point dcs_origin; // начало локальной Декартовой СК в географических координатах
-	std::vector <movement> mvn;
+	const FieldStore &field; // общее для всех разрезов и потоков, только для чтения
 
-	std::ofstream fNV;
+	// диагностические файлы разреза готовятся в памяти и пишутся фоновым потоком diag
+	DiagWriter *diag;
+	TextWriter fNV, fNVdec, fNVgeo;
 	int file_index;
+	bool cut_log; // запись NVdec.txt и NVgeo.txt (перезаписываются каждым разрезом)
+	dt_options options;
+	cut_profile *profile; // профиль текущего разреза, NULL - без профиля
+
+	// integral - NULL, если разрез отброшен до построения Integral (файла AV нет)
+	void submit_logs(Integral *integral);
 
 public:
-	DynamicTopography(std::vector <movement> &m);
+	DynamicTopography(const FieldStore &f);
 
+	void set_options(const dt_options &opt);
+	// без писателя (NULL) диагностические файлы не создаются при любом уровне
+	void set_diag_writer(DiagWriter *dw);
 	void set_file_index(int index);
-	void set_cut(scut c);
+	void set_cut_log(bool on);
+	void set_cut(const scut &c);
 	void set_dcs_origin(const point &dcs_orn);
+	// этапы и счётчики следующих разрезов записываются в p (задаётся на каждый разрез)
+	void set_profile(cut_profile *p);
 	int take(struct dt_result &dt_res);
 
+	// Перебор параметров разреза: коридор отбирается один раз по наибольшей ширине сетки, узкие
+	// коридоры - его подмножества по тому же расстоянию до прямой разреза. Для каждой ширины
+	// строится один Integral (упорядоченные проекции, нормальные компоненты, коэффициенты узлов), 
+	// общий для всех диаметров и коэффициентов; коэффициенты одного диаметра считаются одним
+	// проходом (Integral::take с набором коэффициентов), при адаптивном интегрировании - по одному.
+	// res[grid.index(...)] совпадает с take по разрезу с этими параметрами; диагностические
+	// файлы не пишутся
+	void sweep(const sweep_grid &grid, std::vector <sweep_result> &res);
+
+	// ДТ вдоль разреза без укорачивания по крайним проекциям (путь карты ДТ): dt[k] - перепад от
+	// начала разреза до точки k / count его длины, dt[0] = 0. Интервалов не меньше 5M, как у 
+	// первого прохода take, и по целому числу на каждую из count частей; допуск адаптивного
+	// интегрирования не используется, диагностические файлы не пишутся. Точки first..last лежат
+	// между крайними проекциями векторов коридора, перепады между ними не экстраполируются
+	// (first > last - таких точек нет)
+	int take_profile(int count, std::vector <double> &dt, int &first, int &last);
+
 };
 
 #endif //DYNAMIC_TOPOGRAPHY_H
\ No newline at end of file
@@ -0,0 +1,103 @@
+#ifndef FIELD_FILE_H
+#define FIELD_FILE_H
+
+#include "dt_defs.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Двоичный файл поля скоростей (little-endian):
+//   заголовок field_file_header;
+//   столбцы поля в географических координатах: x0, y0, x1, y1, velocity, error (по count чисел);
+//   необязательный блок локальной СК (флаг FFF_FRAME, смещение frame_offset): декартовы
+//   x0, y0, x1, y1 в СК с началом (frame_x, frame_y) и сохранённая сетка FieldIndex.
+// Все блоки выровнены на 8 байт, файл отображается в память и используется без копирования
+#define FF_MAGIC "DTFIELD"
+#define FF_VERSION 2
+#define FF_MIN_VERSION 1		// версии, которые ещё читаются
+#define FF_FRAME_VERSION 2	// блок локальной СК версий раньше этой посчитан с широтой float
+							// и не используется: СК пересчитывается из столбцов
+#define FF_BYTE_ORDER 0x01020304
+
+#define FFF_FRAME 1 // есть блок локальной СК
+
+// коды ошибок чтения и записи двоичного файла поля
+#define EC_FF_SUCCESS 1000
+#define EC_FF_OPEN 3001
+#define EC_FF_FORMAT 3002
+#define EC_FF_VERSION 3003
+#define EC_FF_BYTE_ORDER 3004
+
+// столбцы поля
+enum E_FIELD_COLUMN
+{
+	EFC_X0,
+	EFC_Y0,
+	EFC_X1,
+	EFC_Y1,
+	EFC_VELOCITY,
+	EFC_ERROR,
+	EFC_COUNT
+};
+
+struct field_file_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;		// FF_BYTE_ORDER в порядке байт записавшей машины
+	uint64_t count;				// количество векторов
+	uint64_t flags;
+	double frame_x, frame_y;	// начало локальной СК блока (географические координаты)
+	uint64_t frame_offset;		// смещение блока локальной СК от начала файла
+	uint64_t file_size;
+};
+
+// true, если файл начинается с сигнатуры двоичного поля
+bool is_field_file(const char *file_name);
+
+class FieldStore;
+
+// Запись поля: mvn - векторы в географических координатах; frame (может быть NULL) -
+// то же поле в локальной СК с началом frame_origin, сохраняется вместе с сеткой
+int write_field_file(const char *file_name, const std::vector <movement> &mvn,
+					 const FieldStore *frame, const point &frame_origin);
+
+// Двоичный файл поля, отображённый в память только для чтения
+class FieldFile
+{
+	const char *data;
+	size_t size;
+#ifdef _WIN32
+	std::vector <char> buffer; // без mmap файл читается целиком
+#endif
+	field_file_header header;
+
+	void close();
+
+public:
+	FieldFile();
+	~FieldFile();
+
+	FieldFile(const FieldFile &) = delete;
+	FieldFile &operator=(const FieldFile &) = delete;
+
+	int open(const char *file_name);
+
+	size_t count() const;
+
+	// столбец в географических координатах
+	const double *column(E_FIELD_COLUMN c) const;
+
+	bool has_frame() const;
+	point frame_origin() const;
+	// декартовы столбцы EFC_X0..EFC_Y1 блока локальной СК
+	const double *frame_column(E_FIELD_COLUMN c) const;
+	const char *index_data() const;
+	size_t index_size() const;
+
+	// векторы в географических координатах (как после чтения текстового файла)
+	void to_movements(std::vector <movement> &mvn) const;
+};
+
+#endif // FIELD_FILE_H
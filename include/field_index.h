@@ -0,0 +1,59 @@
+#ifndef FIELD_INDEX_H
+#define FIELD_INDEX_H
+
+#include "dt_defs.h"
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#define FI_POINTS_PER_CELL 4		// среднее количество векторов в ячейке сетки
+#define FI_MAX_CELLS_PER_SIDE 4096	// ограничение размера сетки при вытянутом поле
+#define FI_BAND_MARGIN 1.e-6		// [км] запас полосы разреза на ошибки округления
+
+// точная проверка попадания вектора в коридор разреза (как в полном переборе поля)
+bool in_cut_corridor(const Line &cut_line, const movement &m, double width);
+
+// Равномерная сетка по начальным точкам векторов поля в локальной декартовой СК.
+// Строится один раз на поле, выбор коридора разреза просматривает только ячейки,
+// пересекающие полосу шириной width вокруг разреза
+class FieldIndex
+{
+	point origin;	// левый нижний угол сетки
+	double cell_size;
+	int nx, ny;
+
+	// массивы сетки: собственные (после build) или в отображённом файле (после attach)
+	std::vector <int> cell_start_data, items_data;
+	const int *cell_start;	// начало ячейки в items, размер nx * ny + 1
+	const int *items;		// индексы векторов, упорядоченные по ячейкам
+	size_t item_count;
+
+	int cell_x(double x) const;
+	int cell_y(double y) const;
+
+public:
+	FieldIndex();
+
+	// массивы сетки указывают на собственные данные или на внешний буфер
+	FieldIndex(const FieldIndex &) = delete;
+	FieldIndex &operator=(const FieldIndex &) = delete;
+
+	// x, y - начальные точки векторов поля
+	void build(const double *x, const double *y, size_t n);
+
+	// Сохранённая сетка: параметры и массивы в том виде, в каком они лежат в памяти
+	// (little-endian), с выравниванием конца на 8 байт
+	size_t serialized_size() const;
+	void write(std::ostream &out) const;
+	// сетка без копирования поверх сохранённой в data (буфер должен жить дольше сетки);
+	// false, если данные не согласованы с n векторами
+	bool attach(const char *data, size_t size, size_t n);
+
+	// индексы векторов из ячеек, пересекающих полосу разреза (с запасом)
+	void candidates(const scut &cut, std::vector <int> &idx) const;
+
+	int cell_count() const;
+};
+
+#endif // FIELD_INDEX_H
@@ -0,0 +1,65 @@
+#ifndef FIELD_STORE_H
+#define FIELD_STORE_H
+
+#include "dt_defs.h"
+#include "field_file.h"
+#include "field_index.h"
+
+#include <memory>
+#include <ostream>
+#include <vector>
+
+// Неизменяемое хранилище поля скоростей в локальной декартовой СК вместе с его сеткой.
+// Загружается один раз и используется всеми разрезами и потоками только для чтения;
+// коридоры разрезов хранят индексы векторов хранилища.
+// Векторы хранятся по столбцам (x0, y0, x1, y1, velocity, error) для векторного отбора коридора;
+// столбцы лежат в собственном буфере или в отображённом двоичном файле поля.
+// Поле снимка с теми же началами векторов может брать начала и сетку другого хранилища
+class FieldStore
+{
+	std::vector <double> storage;			// собственные столбцы
+	std::shared_ptr <const FieldFile> file;	// отображённый файл, на который указывают столбцы
+	std::shared_ptr <const FieldStore> base;	// хранилище, чьи начала и сетка используются
+	size_t count;
+
+	const double *x0, *y0;	// начала векторов
+	const double *x1, *y1;	// концы векторов
+	const double *velocity;
+	const double *error;
+
+	FieldIndex index;
+	const FieldIndex *grid;	// собственная сетка или сетка base
+
+	// копирует столбцы m (без начал, если starts == false) и освобождает m
+	void copy_columns(std::vector <movement> &m, bool starts);
+
+public:
+	// забирает векторы из m (m остаётся пустым) и строит сетку
+	explicit FieldStore(std::vector <movement> &m);
+
+	// Поле двоичного файла в локальной СК с началом origin (географические координаты).
+	// Если в файле сохранена та же СК, её столбцы и сетка используются без копирования,
+	// иначе декартовы координаты пересчитываются и сетка строится заново
+	FieldStore(std::shared_ptr <const FieldFile> f, const point &origin);
+
+	// Векторы m с теми же началами, что у g (проверяет вызывающий, например GridCache): столбцы
+	// начал и сетка g используются без копирования и перестроения, начала m не читаются
+	FieldStore(std::vector <movement> &m, std::shared_ptr <const FieldStore> g);
+
+	FieldStore(const FieldStore &) = delete;
+	FieldStore &operator=(const FieldStore &) = delete;
+
+	size_t size() const;
+	bool shares_grid() const;
+
+	movement at(size_t i) const;
+
+	// индексы векторов коридора разреза в порядке возрастания, возвращает их количество
+	int select(const scut &cut, std::vector <int> &idx) const;
+
+	// блок локальной СК двоичного файла: столбцы x0, y0, x1, y1 и сетка
+	size_t frame_size() const;
+	void write_frame(std::ostream &out) const;
+};
+
+#endif // FIELD_STORE_H
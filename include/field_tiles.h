@@ -0,0 +1,94 @@
+#ifndef FIELD_TILES_H
+#define FIELD_TILES_H
+
+#include "dt_defs.h"
+
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#define FT_TILE_SIZE 20.	// [км] сторона квадратного тайла в локальной декартовой СК
+#define FT_MB (1 << 20)
+
+// вектор поля в тайле: номер во входном файле и декартовы координаты
+struct tile_record
+{
+	int64_t index;
+	double x0, y0, x1, y1;
+	double velocity, error;
+};
+
+typedef std::pair <int, int> tile_key; // (номер столбца, номер строки) тайла
+
+// Поле, разбитое на квадратные тайлы во временном файле (режим для полей больше памяти).
+// При разбиении векторы копятся по тайлам и сбрасываются в файл частями, когда буферы
+// превышают бюджет памяти. При расчёте в памяти держатся только тайлы, пересекающие
+// коридоры последних разрезов: давно не использованные вытесняются при превышении бюджета
+class TiledField
+{
+	struct tile_entry
+	{
+		std::vector <std::pair <uint64_t, uint32_t> > chunks; // части тайла в файле: смещение, количество
+		size_t count;
+		std::vector <tile_record> pending;	// ещё не записанные векторы
+		std::vector <tile_record> records;	// загруженный тайл
+		bool loaded;
+		std::list <tile_key>::iterator lru_pos;
+
+		tile_entry() : count(0), loaded(false) {}
+	};
+
+	std::string file_name;
+	std::fstream file;
+	uint64_t file_size;
+
+	double tile_size;
+	size_t budget;			// [байт]
+	size_t pending_bytes;
+	size_t cached_bytes;
+
+	std::map <tile_key, tile_entry> tiles;
+	std::list <tile_key> lru;	// загруженные тайлы, недавно использованные - в начале
+
+	size_t vector_count;
+	size_t load_count;			// количество чтений тайлов из файла
+	size_t peak_bytes;
+	bool over_budget;			// предупреждение о превышении бюджета уже выдано
+
+	void flush_pending();
+	void load(tile_key key, tile_entry &t);
+	// вытесняет тайлы, кроме pinned, пока загрузка need байт превышает бюджет
+	void evict(const std::vector <tile_key> &pinned, size_t need);
+
+public:
+	TiledField(const std::string &fname, size_t memory_budget, double tsize = FT_TILE_SIZE);
+	~TiledField();
+
+	TiledField(const TiledField &) = delete;
+	TiledField &operator=(const TiledField &) = delete;
+
+	bool is_open() const;
+
+	// разбиение: векторы в локальной СК в порядке входного файла
+	void add(const movement &m);
+	void finish();
+
+	tile_key tile_of(const point &pt) const;
+
+	// тайлы, которые могут содержать начала векторов коридора разреза (ширина уже задана)
+	void tiles_of(const scut &cut, std::vector <tile_key> &keys) const;
+
+	// Векторы тайлов коридора разреза в порядке входного файла (надмножество коридора,
+	// отбор - в FieldStore::select); загружает недостающие тайлы с учётом бюджета
+	void gather(const scut &cut, std::vector <movement> &mvn);
+
+	size_t size() const;
+	size_t tile_count() const;
+	size_t loads() const;
+	size_t peak_memory() const;
+};
+
+#endif // FIELD_TILES_H
@@ -0,0 +1,33 @@
+#ifndef GEO_TRANSFORM_H
+#define GEO_TRANSFORM_H
+
+#include "dt_defs.h"
+
+#include <cstddef>
+#include <vector>
+
+#define GT_BLOCK 256				// точек на блок пакетного пересчёта (буферы на стеке)
+#define GT_PARALLEL_MIN (1 << 18)	// точек, начиная с которых пересчёт делится между потоками
+#define GT_MAX_REL_ERROR 1.e-15		// наибольшая относительная ошибка parallel_radius
+
+// Радиус параллели [м] на широте latitude [град]: EQUATOR_RADIUS * (1 - f sin^2) * cos.
+// sin и cos считаются многочленами после приведения широты к [-45, 45] градусам
+// (ошибка 1-2 ulp против libm); векторные версии повторяют те же операции без FMA,
+// поэтому пакетный пересчёт совпадает с point::to_dec_cs и to_geo_cs поэлементно
+double parallel_radius(double latitude);
+
+// радиусы параллелей для n широт lat[0..n), по 4 (AVX2) или 8 (AVX-512) за раз
+void parallel_radius(const double *lat, double *r, size_t n);
+
+// Пакетный пересчёт столбцов координат: географические lon, lat -> декартовы x, y [км]
+// в СК с началом origin и обратно; выходные столбцы могут совпадать с входными.
+// Большие массивы делятся между thread_count потоками
+void to_dec_cs(const double *lon, const double *lat, double *x, double *y, size_t n,
+			   const point &origin, int thread_count = 1);
+void to_geo_cs(const double *x, const double *y, double *lon, double *lat, size_t n,
+			   const point &origin, int thread_count = 1);
+
+// начала и концы векторов поля на месте
+void to_dec_cs(std::vector <movement> &mvn, const point &origin, int thread_count = 1);
+
+#endif // GEO_TRANSFORM_H
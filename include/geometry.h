@@ -30,11 +30,11 @@ struct point
 	point(double a, double b) : x(a), y(b) {};
 	point(const point &p) : x(p.x), y(p.y) {};
 
-	bool equal(const point &p);
+	bool equal(const point &p) const;
 
-	bool equal_eps(const point &p);
+	bool equal_eps(const point &p) const;
 
-	double distance_to(point p) const;
+	double distance_to(const point &p) const;
 
 	void to_related_cs(const point &origin);
 	void to_global_cs(const point &origin);
@@ -55,21 +55,21 @@ struct vec
 	point start;
 	point end;
 
-	vec(point a, point b) : start(a), end(b) {};
+	vec(const point &a, const point &b) : start(a), end(b) {};
 
-	bool contains(point p);
+	bool contains(const point &p) const;
 
-	double length();
+	double length() const;
 
 	void shorten(double len/*, double dl = 0.0*/);
 
-	point middle();
+	point middle() const;
 
-	std::string toString(std::string name = std::string(""));
+	std::string toString(std::string name = std::string("")) const;
 
-	vec at_geo_cs(const point &origin);
+	vec at_geo_cs(const point &origin) const;
 
-	std::string toGlanceFormat();
+	std::string toGlanceFormat() const;
 };
 
 class Line // line segment
@@ -77,33 +77,33 @@ class Line // line segment
 	double a, b, c;
 	point p1, p2;
 
-	double f(point p);
+	double f(const point &p) const;
 public:
 	Line();
-	Line(vec v);
-	Line(point _p1, point _p2);
+	Line(const vec &v);
+	Line(const point &_p1, const point &_p2);
 	Line(double _a, double _b, double _c);
 
-	double get_a();
-	double get_b();
-	double get_c();
+	double get_a() const;
+	double get_b() const;
+	double get_c() const;
 
-	point start();
-	point end();
+	point start() const;
+	point end() const;
 
-	vec interval();
-	void set_interval(point _p1, point _p2);
+	vec interval() const;
+	void set_interval(const point &_p1, const point &_p2);
 
-	bool contains(point p);
+	bool contains(const point &p) const;
 
-	double distance_to(point p);
-	double angle(vec v);
+	double distance_to(const point &p) const;
+	double angle(const vec &v) const;
 
-	point intersection(Line l);
-	point projection_of(point p);
+	point intersection(const Line &l) const;
+	point projection_of(const point &p) const;
 
-	vec perpendicular(point p);
-	Line parallel(point p);
+	vec perpendicular(const point &p) const;
+	Line parallel(const point &p) const;
 
 	std::string as_string(std::string name = std::string("")) const;
 };
@@ -0,0 +1,47 @@
+#ifndef GRID_CACHE_H
+#define GRID_CACHE_H
+
+#include "field_store.h"
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define GC_MAX_GRIDS 4	// количество запоминаемых сеток начальных точек
+
+// Сетки начальных точек полей серии снимков. Снимки одной пиксельной сетки начал векторов
+// (столбцы psx, psy) с теми же географическими началами получают декартовы начала и
+// сетку ранее загруженного снимка: начала не пересчитываются в локальную СК, сетка не строится.
+// Сетка регистрируется до построения, так что из снимков, загружаемых параллельно, её строит
+// только первый, остальные ждут его хранилище
+class GridCache
+{
+	struct grid_entry
+	{
+		std::vector <int> pixels;		// psx, psy начал векторов
+		std::vector <double> gx, gy;	// географические начала
+		std::shared_future <std::shared_ptr <const FieldStore> > store; // готово после построения
+	};
+
+	std::mutex mtx;
+	std::vector <grid_entry> grids;	// последние загруженные сетки, новые - в конце
+	size_t reused_count;
+
+public:
+	GridCache();
+
+	GridCache(const GridCache &) = delete;
+	GridCache &operator=(const GridCache &) = delete;
+
+	// Хранилище поля снимка в локальной СК с началом origin. mvn - векторы в географических
+	// координатах (mvn становится пустым), pixels - их пиксельные начала (пусто - сетка неизвестна)
+	std::shared_ptr <const FieldStore> make_store(std::vector <movement> &mvn, 
+		const std::vector <int> &pixels, const point &origin);
+
+	// количество снимков, получивших сетку другого снимка
+	size_t reused() const;
+};
+
+#endif // GRID_CACHE_H
@@ -1,8 +1,10 @@
 #ifndef INTEGRATION_H
 #define INTEGRATION_H
 
+#include "cut_coefs.h"
 #include "dt_defs.h"
 #include "interpolation.h"
+#include "text_io.h"
 
 #include <string.h>
 #include <cmath>
@@ -11,6 +13,10 @@
 
 #define MIN_POINT_COUNT 10
 
+// адаптивное интегрирование на вложенных сетках
+#define ITG_START_FACTOR 2	// начальное количество интервалов на вектор коридора
+#define ITG_MAX_LEVEL 5		// наибольшее количество удвоений сетки
+
 // коды ошибок при расчете интеграла
 #define EC_ITG_SUCCESS 1000
 #define EC_ITG_NOT_ENOUGH_DATA 2004
@@ -38,9 +44,11 @@ struct itg_result
 	double step_count;
 	double itp_diameter;
 	double weight_coef;
+	int refinement_level; // достигнутый уровень адаптивного интегрирования, -1 - без адаптации
 
 	itg_result() : lin_value(0.0), sqr_value(0.0), interpolation_accuracy(1.0), integration_error(1.0), 
-		ms_deviation(1.0), step_size(0.0), step_count(0), itp_diameter(0.0), weight_coef(0.0)
+		ms_deviation(1.0), step_size(0.0), step_count(0), itp_diameter(0.0), weight_coef(0.0),
+		refinement_level(-1)
 	{}
 };
 
@@ -49,24 +57,77 @@ class Integral
 {
 	scut cut;
 	point dcs_origin;
-	std::vector <wvector> wv;
+	const std::vector <wvector> &wv;
+	const FieldStore &field;
+
+	Interpolation itp; // строится один раз на коридор и используется всеми проходами
+
+	// коэффициенты подынтегральных функций, строятся при первом проходе после изменения разреза
+	CutCoefs coefs;
+	bool coriolis_table, curvature_table;
+	bool coefs_ready;
 
 	int n; // количество интервалов разбиения
 
+	// узлы прохода и скорости в них (пакетная интерполяция)
+	std::vector <point> nodes;
+	std::vector <double> node_vel;
+	std::vector <std::vector <double> > coef_acr; // ошибки интерполяции по коэффициентам (take с coefs)
+
 	E_PRINT_MODE print_mode;
-	std::ofstream fitp;
+	TextWriter fitp;
+
+	cut_profile *profile; // NULL - без профиля
 
 	double get_integration_error(std::vector <double> &val, double h, int n);
 
+	void setup_interpolation();
+	void setup_coefs();
+	void calc_accuracy(struct itg_result &itg_res);
+	void accuracy_stats(const std::vector <double> &itp_acr, struct itg_result &itg_res);
+
+	point node(int j, int count);
+	// t - положение узла pt на разрезе: 0 - начало, 1 - конец
+	void integrand(const point &pt, double t, double velocity, double &lin, double &sqr);
+	void print_node(const point &pt, double velocity, double len_K);
+
 public:
-	Integral(scut c, std::vector <wvector> &_wv);
+	Integral(const scut &c, const std::vector <wvector> &_wv, const FieldStore &f);
 
-	void set_cut(scut c);
+	void set_cut(const scut &c);
+	// параметры интерполяции разреза (как в scut) без пересчёта кэша коридора
+	void set_parameters(double itp_diameter, double weight_coef);
 	void set_dcs_origin(const point &dcs_orn);
 	void set_partitioning_count(int _n);
 	void set_filename(std::string filename);
+	// вывод режима EPM_ON: файл set_filename или память (open_memory)
+	TextWriter &print_log();
+	void set_precision_mode(E_PRECISION_MODE mode);
+	// параметр Кориолиса по таблице опорных широт разреза (CutCoefs), а не sin в каждом узле
+	void set_coriolis_table(bool on);
+	// кривизна потока по положению узла на разрезе (CutCoefs), а не по его координатам
+	void set_curvature_table(bool on);
+	// время ошибок интерполяции и уточнения сетки, узлы и соседи интерполяции
+	void set_profile(cut_profile *p);
 
 	int take(struct itg_result &itg_res, E_PRINT_MODE pm = EPM_OFF);
+
+	// Проход take для нескольких коэффициентов весовой функции (в единицах scut::weight_coef) при 
+	// радиусе по диаметру разреза: узлы, окна соседей и коэффициенты подынтегральных функций 
+	// общие, res[c] - для weight_coefs[c] (см. Interpolation::take_for с coefs)
+	int take(const std::vector <double> &weight_coefs, std::vector <itg_result> &res);
+
+	// Профиль вдоль разреза для карты ДТ: проход take с count * per_segment интервалами, 
+	// value[k] - сумма lin_value + sqr_value от начала разреза до точки k / count его длины
+	// (value[0] = 0, value[count] совпадает с take при том же количестве интервалов)
+	int take_profile(int count, int per_segment, std::vector <double> &value);
+
+	// Метод трапеций на вложенных сетках: начиная с ITG_START_FACTOR интервалов на вектор,
+	// сетка удваивается с сохранением всех прежних узлов, пока |I(n) - I(2n)| по lin_value
+	// не станет меньше lin_tolerance (или не будет достигнут ITG_MAX_LEVEL).
+	// itg_res - результат на последней сетке, coarse - на предыдущей
+	int take_adaptive(struct itg_result &itg_res, struct itg_result &coarse, double lin_tolerance, 
+					  E_PRINT_MODE pm = EPM_OFF);
 };
 
 
@@ -2,40 +2,106 @@
 #define INTERPOLATION_H
 
 #include "dt_defs.h"
+#include "dt_profile.h"
+#include "field_store.h"
+#include "weight_kernel.h"
 
 #include <algorithm>
+#include <limits>
 #include <vector>
 
 #define WEIGHT_COEF 0.01
 #define WEIGHT_COEF_TRANSFORM 1. // потребовалось при переходе от градусов к метрам для сохранение прежней размерности WEIGHT_COEF
+#define LOO_CANCEL_RATIO 1.e-4 // доля суммы весов, ниже которой исключение своего веса вычитанием неточно
 
 class Interpolation
 {
 	double R;
 	double weight_coef;
 	vec interval;
-	std::vector <wvector> wv;
+	const std::vector <wvector> &wv;
+	const FieldStore &field;
+
+	double cutoff;	// exp(- weight_coef * R * R), пересчитывается при смене R и weight_coef
+	E_PRECISION_MODE precision;
+	cut_profile *profile;	// счётчик просмотренных соседей, NULL - без профиля
+
+	// кэш коридора, упорядоченный по координате проекции вдоль разреза
+	point dir;					// единичный вектор вдоль разреза
+	std::vector <int> order;	// индексы wv в порядке возрастания координаты проекции
+	std::vector <int> rank;		// место вектора wv[i] в этом порядке
+	std::vector <double> pos;	// координаты проекций вдоль разреза
+	std::vector <point> prj;	// проекции
+	std::vector <double> nc;	// нормальные к разрезу компоненты скорости
+	std::vector <double> prj_x, prj_y;	// координаты проекций по столбцам (для векторного ядра)
+
+	// ошибки интерполяции с исключением точки (по местам кэша) и параметры, при которых 
+	// они посчитаны; не зависят от количества интервалов интегрирования
+	std::vector <double> loo_err;
+	double loo_R, loo_weight_coef;
+	E_PRECISION_MODE loo_precision;
+	void calc_loo_errors();
+
+	// то же для набора коэффициентов (calc_accuracy с coefs): loo_multi_err[c * размер + место]
+	std::vector <double> loo_multi_err, loo_multi_coefs;
+	double loo_multi_R;
+	E_PRECISION_MODE loo_multi_precision;
+	void calc_loo_errors(const std::vector <double> &coefs);
+
+	// рабочие массивы пакетной интерполяции (без выделения памяти на каждую точку)
+	std::vector <double> win_w, win_r;
+	double window_value(const point &pt, size_t lo, size_t hi);
+
+	// постоянные весовой функции для коэффициентов coefs (в единицах set_weight_coef) при текущем R
+	void coef_constants(const std::vector <double> &coefs, std::vector <double> &k, std::vector <double> &cut);
+	// значения в точке pt по окну [lo, hi) для m коэффициентов: vals[0..m)
+	void window_values(const point &pt, size_t lo, size_t hi, const double *k, const double *cut, int m, 
+					   double *vals);
+
+	double along(const point &pt);
+	void sort_projections();
+	void update_cutoff();
 
 	double get_norm_comp(int idx);
 
 	double weight_func(double _r);
-	double calc_weight_sum(std::vector <int> &idx, point pt, int omit_idx);
-	double get_interpolation_result(std::vector <int> &idx, point pt, double sum);
+	weight_kernel_args kernel_args(const point &pt);
+	// idx - места соседей в упорядоченном кэше
+	double calc_weight_sum(std::vector <int> &idx, const point &pt, int omit_pos);
+	double get_interpolation_result(std::vector <int> &idx, const point &pt, double sum);
 
 public:
-	Interpolation(vec itv, std::vector <wvector> &_wv);
+	Interpolation(const vec &itv, const std::vector <wvector> &_wv, const FieldStore &f);
+
+	// смена разреза с пересчётом кэша коридора
+	void set_interval(const vec &itv);
 
 	void calc_radius();
 	void set_radius(double r);
 	void set_weight_coef(double coef);
+	void set_precision_mode(E_PRECISION_MODE mode);
+	void set_profile(cut_profile *p);
 
 	double get_radius();
 	double get_weight_coef();
+	// коэффициент весовой функции по умолчанию (get_weight_coef нового объекта)
+	static double default_weight_coef();
 
 	double take_for(point pt);
 
+	// Интерполяция во всех точках pts за один проход: точки просматриваются вдоль разреза,
+	// окно соседей в упорядоченном кэше сдвигается вместе с ними. Для неубывающих координат
+	// (узлы разбиения разреза) поиск окна не повторяется. Результат совпадает с take_for
+	void take_for(const std::vector <point> &pts, std::vector <double> &vals);
+
 	void calc_accuracy(std::vector <double> &err);
 
+	// Перебор коэффициентов весовой функции при текущем радиусе: окно соседей и расстояния
+	// считаются один раз на точку, vals[i * coefs.size() + c] и err[c] - для coefs[c]. Значения
+	// совпадают с take_for и calc_accuracy после set_weight_coef(coefs[c])
+	void take_for(const std::vector <point> &pts, const std::vector <double> &coefs, std::vector <double> &vals);
+	void calc_accuracy(const std::vector <double> &coefs, std::vector <std::vector <double> > &err);
+
 };
 
 #endif // INTERPOLATION_H
\ No newline at end of file
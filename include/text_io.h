@@ -0,0 +1,99 @@
+#ifndef TEXT_IO_H
+#define TEXT_IO_H
+
+#include "dt_defs.h"
+#include "geometry.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#define TIO_BLOCK_SIZE (1 << 20) // размер блока чтения и буфера вывода, [байт]
+
+// Чтение текстового файла большими блоками; строки выдаются указателями в буфер без копирования
+class TextReader
+{
+	FILE *file;
+	std::vector <char> buffer;
+	size_t begin, end;	// непрочитанная часть буфера
+	bool eof;
+
+public:
+	explicit TextReader(const char *file_name);
+	~TextReader();
+
+	TextReader(const TextReader &) = delete;
+	TextReader &operator=(const TextReader &) = delete;
+
+	bool is_open() const;
+
+	// следующая строка [first, last) без перевода строки; false в конце файла.
+	// Указатели действительны до следующего вызова
+	bool next_line(const char *&first, const char *&last);
+};
+
+// Разбор числа строки с позиции p (начальные пробелы пропускаются) через std::from_chars:
+// значения совпадают с чтением через std::istream >>. При успехе p сдвигается за число
+bool parse_number(const char *&p, const char *last, double &v);
+bool parse_number(const char *&p, const char *last, int &v);
+
+// в [p, last) только пробельные символы
+bool is_blank(const char *p, const char *last);
+
+// Разрез в формате строки списка разрезов (географические координаты): 7 обязательных чисел,
+// затем необязательные центр кривизны и/или допуск интегрирования
+bool parse_cut(const char *&p, const char *last, scut &cut);
+
+// Строка поля скоростей (VecPlotter): географические начало и конец, пиксельные начало и конец,
+// корреляция, скорость, априорная ошибка. pixels (если задан) получает пиксельное начало вектора
+bool parse_movement(const char *&p, const char *last, movement &m, int *pixels = NULL);
+
+// Строка списка перебора параметров: как строка списка разрезов, но ширина, диаметр и коэффициент -
+// списки значений через запятую без пробелов (например 5,10,15)
+bool parse_sweep(const char *&p, const char *last, scut &cut, sweep_grid &grid);
+
+// Вывод в текстовый файл через переиспользуемый буфер, числа форматируются std::to_chars.
+// В режиме памяти (open_memory) весь вывод остаётся в буфере до release
+class TextWriter
+{
+	FILE *file;
+	bool memory;
+	std::vector <char> buffer;
+	size_t used;
+
+	char *reserve(size_t size);
+
+public:
+	TextWriter();
+	explicit TextWriter(const char *file_name);
+	TextWriter(TextWriter &&other);
+	~TextWriter();
+
+	TextWriter(const TextWriter &) = delete;
+	TextWriter &operator=(const TextWriter &) = delete;
+
+	bool open(const char *file_name);
+	void open_memory();
+	bool is_open() const;
+	void flush();
+	// закрывает файл; в режиме памяти вывод сохраняется до release
+	void close();
+
+	// забирает накопленный в памяти вывод и закрывает писатель
+	void release(std::vector <char> &out);
+
+	// %g с 6 значащими цифрами - как std::ostream << double по умолчанию
+	TextWriter &operator<<(double v);
+	TextWriter &operator<<(int v);
+	TextWriter &operator<<(size_t v);
+	TextWriter &operator<<(char c);
+	TextWriter &operator<<(const char *s);
+
+	// %f с 6 знаками после точки (формат %2f прежнего sprintf)
+	TextWriter &put_fixed(double v);
+};
+
+// вектор в формате Glance (как vec::toGlanceFormat)
+void write_glance(TextWriter &out, const vec &v);
+
+#endif // TEXT_IO_H
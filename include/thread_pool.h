@@ -0,0 +1,89 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с перехватом задач: у каждого потока своя очередь, задачи раздаются
+// по очереди, поток берёт задачи с начала своей очереди (в порядке постановки),
+// а при её исчерпании - с конца чужих
+class ThreadPool
+{
+public:
+	typedef std::function <void (int)> task; // аргумент - номер рабочего потока
+
+	explicit ThreadPool(int thread_count);
+	~ThreadPool();
+
+	int size() const;
+
+	void submit(task t);
+
+	// ожидание завершения всех поставленных задач
+	void wait();
+
+	// количество потоков для параметра -j (0 - по числу ядер)
+	static int resolve_thread_count(int requested);
+
+private:
+	struct worker_queue
+	{
+		std::mutex mtx;
+		std::deque <task> tasks;
+	};
+
+	std::vector <std::unique_ptr <worker_queue> > queues;
+	std::vector <std::thread> threads;
+
+	std::mutex mtx;
+	std::condition_variable task_cv;
+	std::condition_variable done_cv;
+	size_t queued;		// задачи в очередях
+	size_t pending;		// поставленные и ещё не завершённые задачи
+	size_t next_queue;
+	bool stop;
+
+	bool pop(int w, task &t);
+	void run(int w);
+};
+
+// Буфер восстановления порядка: результаты приходят от потоков в произвольном порядке,
+// а забираются строго по возрастанию номера
+template <typename T>
+class ReorderBuffer
+{
+	std::vector <T> slots;
+	std::vector <char> ready;
+	std::mutex mtx;
+	std::condition_variable cv;
+
+public:
+	explicit ReorderBuffer(size_t count) : slots(count), ready(count, 0) {}
+
+	void put(size_t i, T value)
+	{
+		{
+			std::lock_guard <std::mutex> lock(mtx);
+			slots[i] = std::move(value);
+			ready[i] = 1;
+		}
+		cv.notify_all();
+	}
+
+	// ожидает результат с номером i и освобождает его место в буфере
+	T take(size_t i)
+	{
+		std::unique_lock <std::mutex> lock(mtx);
+		cv.wait(lock, [this, i] { return ready[i] != 0; });
+		T value = std::move(slots[i]);
+		slots[i] = T();
+		return value;
+	}
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,60 @@
+#ifndef WEIGHT_KERNEL_H
+#define WEIGHT_KERNEL_H
+
+#include "corridor_filter.h"
+
+#include <cstddef>
+
+// точность весовой функции интерполяции (параметр Кориолиса - отдельно, dt_options::coriolis_table)
+enum E_PRECISION_MODE
+{
+	EPR_EXACT,	// exp из libm, прежний порядок суммирования
+	EPR_FAST	// векторное ядро с приближённой экспонентой
+};
+
+const char *precision_mode_name(E_PRECISION_MODE mode);
+
+// Приближённая экспонента для x <= 0: x = n ln2 + f, |f| <= ln2 / 2, exp(f) - многочлен
+// Тейлора 12-й степени. Наибольшая относительная ошибка на [-708, 0] не превышает
+// FE_MAX_REL_ERROR (остаток ряда ~2e-16 плюс округления схемы Горнера, на проверочной 
+// сетке - 3.2e-16). Аргументы меньше FE_MIN_ARG заменяются на FE_MIN_ARG (результат 
+// ~1e-308 вместо 0)
+#define FE_MIN_ARG -708.
+#define FE_MAX_REL_ERROR 1.e-15
+
+double fast_exp(double x);
+
+// Постоянные весовой функции exp(-k r^2) - cutoff для точки интерполяции
+struct weight_kernel_args
+{
+	double px, py;	// точка интерполяции
+	double k;		// коэффициент весовой функции
+	double R2;		// квадрат радиуса интерполяции
+	double cutoff;	// fast_exp(-k R^2)
+};
+
+// Суммы весов S и взвешенных нормальных компонент V по окну соседей x, y, nc [0..n):
+// точки с r^2 > R2 не учитываются. Одним проходом по 4 (AVX2) или 8 (AVX-512) точек
+void weight_window(const weight_kernel_args &a, const double *x, const double *y, const double *nc,
+				   size_t n, double &S, double &V);
+
+#define WK_MAX_COEFS 8 // коэффициентов весовой функции в одном вызове weight_window_multi
+
+// Постоянные весовой функции для m <= WK_MAX_COEFS коэффициентов сразу (перебор параметров)
+struct weight_multi_args
+{
+	double px, py;				// точка интерполяции
+	double R2;					// квадрат радиуса интерполяции
+	int m;						// количество коэффициентов
+	double k[WK_MAX_COEFS];		// коэффициенты весовой функции
+	double cutoff[WK_MAX_COEFS];	// fast_exp(-k[c] R^2)
+};
+
+// Суммы S[c] и V[c] по окну соседей для m коэффициентов за один проход: r^2, маска радиуса и
+// нормальные компоненты загружаются один раз на 4 (AVX2) или 8 (AVX-512) соседей, экспоненты
+// считаются для каждого коэффициента по ним. Порядок суммирования - как в weight_window, поэтому
+// S[c] и V[c] совпадают с weight_window с коэффициентом k[c] на том же уровне инструкций
+void weight_window_multi(const weight_multi_args &a, const double *x, const double *y, const double *nc,
+						 size_t n, double *S, double *V);
+
+#endif // WEIGHT_KERNEL_H
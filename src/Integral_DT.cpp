@@ -1,14 +1,25 @@
+#include <algorithm>
 #include <fstream>
-#include <io.h>
+#include <functional>
 #include <iostream>
 #include <locale>
 #include <math.h>
-#include <sstream>
+#include <memory>
 #include <string.h>
 #include <vector>
 
+#include "diag_writer.h"
+#include "dt_core.h"
+#include "dt_map.h"
+#include "dt_profile.h"
+#include "dt_server.h"
+#include "dt_state.h"
 #include "dt_tests.h"
 #include "dynamic_topography.h"
+#include "field_tiles.h"
+#include "grid_cache.h"
+#include "text_io.h"
+#include "thread_pool.h"
 
 void print_eng_usage()
 {
@@ -20,9 +31,75 @@ void print_eng_usage()
 		 << "\t-h\tDisplay this information.\n"
 		 << "\t-v\tDisplay release data.\n"
 		 << "\t-f\tDisplay files format.\n"
-		 << "\t-t <files>\tRun tests.\n\n";
+		 << "\t-t <files>\tRun tests.\n"
+		 << "\t-c <vp_out_file> <binary_file> [<boundary_points_list>]\n"
+		 << "\t\t\tConvert the field to the binary format. With the cut list the local frame\n"
+		 << "\t\t\tof its first cut and the field index are stored too and are used without\n"
+		 << "\t\t\trecomputation by runs with the same first cut.\n"
+		 << "\t-S <socket> <vp_out_file> [<boundary_points_list>]\n"
+		 << "\t\t\tServer mode: the field is loaded once and cuts are answered over the Unix\n"
+		 << "\t\t\tsocket. One thread reads and writes all connections, the CUT and RELOAD\n"
+		 << "\t\t\trequests of all clients are computed on -j threads; the replies of a client\n"
+		 << "\t\t\tkeep the order of its requests. Requests, one line each:\n"
+		 << "\t\t\t  CUT <cut as in <boundary_points_list>>  -> OK <dt_out_file columns> | ERR <code>\n"
+		 << "\t\t\t  RELOAD <vp_out_file>                    -> OK <vector count> | ERR <code>\n"
+		 << "\t\t\t  QUIT (close the connection), STOP (stop the server)\n"
+		 << "\t\t\tThe local frame is the one of the first listed cut, otherwise the frame of the\n"
+		 << "\t\t\tbinary file or the middle of the field.\n"
+		 << "\t-s <field_list> <boundary_points_list> <dt_out_file>\n"
+		 << "\t\t\tTime series: DT of every cut for every field file of the list (one per line).\n"
+		 << "\t\t\tSnapshots are processed on -j threads; snapshots with the same pixel grid of\n"
+		 << "\t\t\tvector starts share the field grid. No diagnostic files are written.\n"
+		 << "\t-w <vp_out_file> <sweep_list> <dt_out_file>\n"
+		 << "\t\t\tParameter sweep: DT of every combination of the cut widths, interpolation\n"
+		 << "\t\t\tdiameters and weight coefficients listed for the cut (cuts on -j threads). The\n"
+		 << "\t\t\tcorridor is selected once with the widest width; the weight coefficients of a\n"
+		 << "\t\t\tdiameter are evaluated in one pass. Results are the same as for a cut list with\n"
+		 << "\t\t\tevery combination. The sensitivity table is written to <dt_out_file>.sens.\n"
+		 << "\t\t\tNo diagnostic files are written.\n"
+		 << "\t-g <vp_out_file> <map_description> <map_out_file>\n"
+		 << "\t\t\tDT map: DT of the grid nodes of a region relative to a reference point, along\n"
+		 << "\t\t\tpaths on the grid (the reference row, then the node column). Every grid line\n"
+		 << "\t\t\tis integrated once and its segments are shared by all paths through them.\n"
+		 << "\t\t\tTiles of grid columns are processed on -j threads over one field index. The map\n"
+		 << "\t\t\tis written to <map_out_file> (binary) and <map_out_file>.asc (ESRI ASCII grid).\n"
+		 << "\t\t\tNodes whose path leaves the extreme projections of the corridor vectors of\n"
+		 << "\t\t\tits row or column are not extrapolated and get NODATA (-9999).\n"
+		 << "\t\t\tNo diagnostic files are written, -a is not used.\n"
+		 << "\t-u <vp_out_file> <boundary_points_list> <delta_file> <dt_out_file>\n"
+		 << "\t\t\tIncremental run: <vp_out_file> is the field after the changes listed in\n"
+		 << "\t\t\t<delta_file>, the previous run state is <dt_out_file>.state. Only the cuts\n"
+		 << "\t\t\twith an added or removed vector in the corridor are recomputed (on -j threads),\n"
+		 << "\t\t\tthe other results are kept. Without the state, for another cut list, other\n"
+		 << "\t\t\t-a, -p, -o, -k or -m options or a field that does not match the state and the delta\n"
+		 << "\t\t\tall cuts are computed. The results are the same as of a full run on\n"
+		 << "\t\t\t<vp_out_file>. No diagnostic files are written.\n"
+		 << "\t-j <N>\t\tProcess cuts on N threads (0 - one per core), results keep the cut order.\n"
+		 << "\t-a <tol>\tAdaptive integration on nested grids until the integration error (K|I(n)-I(2n)|)\n"
+		 << "\t\t\tis below tol, instead of two passes with 5 and 10 intervals per vector. tol is\n"
+		 << "\t\t\tconverted with the largest |f| of the frame origin and the cut ends; a cut with\n"
+		 << "\t\t\tf = 0 at all of them (on the equator) is rejected with error 1003.\n"
+		 << "\t-m <MB>\t\tOut-of-core mode for fields larger than memory: the field is split into tiles\n"
+		 << "\t\t\tin <dt_out_file>.tiles, cuts are processed in tile order keeping at most MB\n"
+		 << "\t\t\tmegabytes of tiles in memory (one thread). Results are the same as in memory.\n"
+		 << "\t-p <mode>\tInterpolation weights: libm exp (exact, default) or vectorized exp with\n"
+		 << "\t\t\trelative error below 1e-15 (fast).\n"
+		 << "\t-o <mode>\tCoriolis parameter of the nodes: libm sin at every node (direct, default) or a\n"
+		 << "\t\t\ttable of anchor latitudes of the cut with error below 1e-15 of 2 Omega (table).\n"
+		 << "\t-k <mode>\tFlow curvature term: direct (default, distance from the curvature center to\n"
+		 << "\t\t\tevery node) or table (from the node position on the cut, rounding-level changes).\n"
+		 << "\t-d <level>\tDiagnostic files: full (default, NV and AV files of every cut), summary\n"
+		 << "\t\t\t(DSC.txt, NVdec.txt and NVgeo.txt) or none (only <dt_out_file>).\n"
+		 << "\t\t\tA cut rejected for too few corridor vectors still gets its NV file (and\n"
+		 << "\t\t\tNVdec.txt, NVgeo.txt) with the corridor vectors, but no AV file.\n"
+		 << "\t\t\tThey are written by a background thread.\n"
+		 << "\t--profile <report.json>\n"
+		 << "\t\t\tTime of the calculation phases (reading, local frame, corridor, interpolation\n"
+		 << "\t\t\tsetup, first pass, LOO accuracy, second pass, output) and counters (corridor\n"
+		 << "\t\t\tvectors, integration nodes, visited interpolation neighbours): totals and per\n"
+		 << "\t\t\tcut. Phase times are exclusive of the nested phases.\n\n";
 
-	std::cout << "USAGE: <vp_out_file> <boundary_points_list> <dt_out_file>\n\n";
+	std::cout << "USAGE: [-j <N>] [-a <tol>] [-m <MB>] [-p <mode>] [-o <mode>] [-k <mode>] [-d <level>] [--profile <report.json>] <vp_out_file> <boundary_points_list> <dt_out_file>\n\n";
 
 	std::cout << "Example: ""integral_DT.exe out_2006-05-04_0730_n27799.m.pro_2006-05-04_1300_n70056.m.pro.txt stations.txt DT_out.txt""\n\n";
 }
@@ -43,6 +120,7 @@ void print_file_formats()
 	<< "\t\tcorrelation\n"
 	<< "\t\tvelocity of movement\n"
 	<< "\t\ta priori error\n"
+	<< "\t    or a binary field file made by the -c option\n"
 
 	<< "\t<boundary_points_list>\tList of cut definitions\n"
 	<< "\t    string format:\n"
@@ -55,6 +133,22 @@ void print_file_formats()
 	<< "\t\tweight coefficient\tor -1 by default\n"
 	<< "\t\tgeo longitude of curvature center (optional)\n"
 	<< "\t\tgeo latitude of curvature center (optional)\n"
+	<< "\t\tadaptive integration tolerance (optional), overrides -a for the cut\n"
+
+	<< "\t<sweep_list>\t\tList of cuts with parameter grids (-w): as <boundary_points_list>, but\n"
+	<< "\t\tcut width, interpolation interval and weight coefficient are comma separated\n"
+	<< "\t\tlists without spaces, for example 5,10,15\n"
+
+	<< "\t<map_description>\tDT map region (-g), one line:\n"
+	<< "\t\tgeo longitude and latitude of the south-west corner of the region\n"
+	<< "\t\tgeo longitude and latitude of the north-east corner of the region\n"
+	<< "\t\tgrid spacing, [km]\n"
+	<< "\t\tgeo longitude and latitude of the reference point (DT = 0)\n"
+	<< "\t\tcut width, interpolation interval and weight coefficient of the paths (optional,\n"
+	<< "\t\tas in <boundary_points_list>)\n"
+
+	<< "\t<delta_file>\t\tField changes since the previous run (-u), a line per vector:\n"
+	<< "\t\t+ or - (added or removed vector), then the vector as a <vp_out_file> line\n"
 
 	<< "\t<dt_out_file>\t\tfile for result output\n"
 	<< "\t    string format:\n"
@@ -75,7 +169,33 @@ void print_file_formats()
 	<< "\t\tDT coefficient (f / G)\n"
 	<< "\t\tintegration step size, [meters]\n"
 	<< "\t\tintegration steps count\n"
-	<< "\t\tvector count\n";
+	<< "\t\tvector count\n"
+	<< "\t\trefinement level (adaptive integration only)\n"
+
+	<< "\t<dt_out_file> of the -s time series: the same columns preceded by\n"
+	<< "\t\tcut number (as in <boundary_points_list>)\n"
+	<< "\t\tsnapshot number (as in <field_list>)\n"
+
+	<< "\t<dt_out_file> of the -w parameter sweep: the same columns preceded by\n"
+	<< "\t\tcut number (as in <sweep_list>)\n"
+	<< "\t\tcut width, interpolation interval and weight coefficient (as in <sweep_list>)\n"
+
+	<< "\t<dt_out_file>.sens\tsensitivity table of the -w parameter sweep, a line per cut:\n"
+	<< "\t\tcut number\n"
+	<< "\t\tcombination count, computed combination count\n"
+	<< "\t\tDT minimum, maximum and mean, [meters]\n"
+	<< "\t\tmaximum |dDT/d(width)|, [meters/km]\n"
+	<< "\t\tmaximum |dDT/d(interpolation interval)|, [meters/km]\n"
+	<< "\t\tmaximum |dDT/d(weight coefficient)|, [meters]\n"
+	<< "\t\t(between neighbouring values of the parameter with the others fixed; -1 if the\n"
+	<< "\t\tparameter has less than two values, calculated interpolation intervals are skipped)\n"
+
+	<< "\t<map_out_file>\t\tbinary DT map (-g), little-endian: header (magic DTMAP, version,\n"
+	<< "\t\tbyte order mark, column and row counts, reference point, local coordinates of the\n"
+	<< "\t\tsouth-west node [km], grid spacing [km], no-data value) and rows of DT [meters]\n"
+	<< "\t\tas doubles from south to north. The grid is in the local frame of the reference\n"
+	<< "\t\tpoint (x to the east, y to the north, [km]); <map_out_file>.asc is the same grid\n"
+	<< "\t\tas an ESRI ASCII grid with rows from north to south\n";
 }
 
 void print_version()
@@ -86,55 +206,13 @@ void print_version()
 char* move_points_file;
 char* station_points_file;
 char* out_file;
+int thread_count = 1;
+size_t memory_budget = 0; // [байт], 0 - поле целиком в памяти
+dt_options options;
+char* profile_file = NULL; // отчёт --profile, NULL - без профилирования
 // char* output_log = (char *)"log.txt";
 // char* itg_log = (char *)"itg_log.txt";
 
-bool file_exists(const char *fname)
-{
-	//return !(ifstream(fname) == NULL);
-	return _access(fname, 0) != -1;
-}
-
-void read_cuts(const char *file_name, std::vector <scut> &cut)
-{
-	std::fstream fcut;
-	fcut.open(file_name);
-	double gsx, gsy, gex, gey, cut_width, itp_diameter, weight_coef, cc_long, cc_lat;
-
-	std::string line;
-	while (getline(fcut, line))
-	{
-		std::istringstream iss(line);
-		if (iss >> gsx >> gsy >> gex >> gey >> cut_width >> itp_diameter >> weight_coef)
-		{
-			vec v(point(gsx, gsy), point(gex, gey));
-			if (iss >> cc_long >> cc_lat)
-			{
-				point curv_center = point(cc_long, cc_lat);
-				cut.push_back(scut(v, cut_width, itp_diameter, weight_coef, curv_center));
-			}
-			else
-				cut.push_back(scut(v, cut_width, itp_diameter, weight_coef));
-		}
-	}
-	fcut.close();
-}
-
-void read_movement_field(char *file_name, std::vector <movement> &mvn)
-{
-	std::fstream fmoves;
-	fmoves.open(file_name);
-	double gsx, gsy, gex, gey, crl, vlc, err;
-	int psx, psy, pex, pey;
-	while (fmoves >> gsx >> gsy >> gex >> gey >> psx >> psy >> pex >> pey >> crl >> vlc >> err)
-	{
-		vec v(point(gsx, gsy), point(gex, gey));
-		mvn.push_back(movement(v, vlc, err));
-		// getline(fmoves, s);
-	}
-	fmoves.close();
-}
-
 /*wstring AnsiToWide(const string& in_sAnsi)
 {
 	wstring wsWide;
@@ -150,6 +228,37 @@ void read_movement_field(char *file_name, std::vector <movement> &mvn)
 	return wsWide;
 }*/
 
+void convert_field(char *field_file, char *binary_file, char *cuts_file)
+{
+	std::vector <movement> mvn;
+	read_movement_field(field_file, mvn);
+
+	int ce;
+	if (cuts_file == NULL)
+		ce = write_field_file(binary_file, mvn, NULL, point(0., 0.));
+	else
+	{
+		std::vector <scut> station;
+		read_cuts(cuts_file, station);
+		if (station.size() == 0)
+		{
+			std::cerr << "Error: Station amount is zero\n";
+			return;
+		}
+
+		// локальная СК первого разреза, как в calculate_dyn_top
+		point geo_origin = station[0].v().middle();
+		std::vector <movement> dec_mvn(mvn);
+		to_cartesian_cs(dec_mvn, station);
+		FieldStore frame(dec_mvn);
+
+		ce = write_field_file(binary_file, mvn, &frame, geo_origin);
+	}
+
+	if (ce == EC_FF_SUCCESS)
+		std::cout << mvn.size() << " vectors are written to " << binary_file << "\n";
+}
+
 void run_tests()
 {
 	std::vector <movement> mvn;
@@ -165,67 +274,657 @@ void run_tests()
 	}
 
 	test_geo2dec2geo(mvn, station[0].v().middle());
+	test_field_index(mvn, station);
+	test_field_file(mvn, station);
+	test_field_tiles(mvn, station);
+	test_grid_cache(mvn, station);
+	test_dt_field(mvn, station);
+	test_sweep(mvn, station);
+	test_dt_map(mvn, station);
+	test_run_state(mvn, station);
+#ifndef _WIN32
+	test_dt_server(mvn, station);
+#endif
+	test_profile(mvn, station);
+	test_weight_kernel();
+	test_geo_transform(mvn, station[0].v().middle());
+	test_cut_coefs();
 	// test_to_geo_transforms();
 
 }
 
+// номер на кривой Мортона: близкие тайлы получают близкие номера
+static uint64_t morton_code(uint32_t x, uint32_t y)
+{
+	uint64_t code = 0;
+	for (int b = 0; b < 32; ++b)
+		code |= (uint64_t)((x >> b) & 1) << (2 * b) | (uint64_t)((y >> b) & 1) << (2 * b + 1);
+	return code;
+}
+
+void calculate_dyn_top_tiled()
+{
+	std::unique_ptr <Profiler> profiler;
+	if (profile_file != NULL)
+		profiler.reset(new Profiler());
+	cut_profile *run_prof = profiler ? profiler->run() : NULL;
+
+	ProfileTimer read_timer(run_prof, EPP_READ);
+	std::vector <scut> station;
+	read_cuts(station_points_file, station);
+
+	if (station.size() == 0)
+	{
+		std::cerr << "Error: Station amount is zero\n";
+		return;
+	}
+	if (profiler) profiler->set_cut_count(station.size());
+
+	point geo_origin = station[0].v().middle();
+	std::vector <movement> no_mvn;
+	to_cartesian_cs(no_mvn, station);
+
+	// разбиение поля на тайлы за один проход чтения; DSC.txt пишется по ходу
+	TiledField tiles(std::string(out_file) + ".tiles", memory_budget);
+	if (!tiles.is_open())
+		return;
+
+	TextWriter fDSC;
+	if (options.diag_level != EDL_NONE)
+		fDSC.open("DSC.txt");
+	for_each_movement(move_points_file, [&](const movement &geo_m)
+	{
+		movement m = geo_m;
+		m.mv.start.to_dec_cs(geo_origin);
+		m.mv.end.to_dec_cs(geo_origin);
+		fDSC << m.mv.start.x << ' ' << m.mv.start.y << ' ' 
+			<< m.mv.end.x << ' ' << m.mv.end.y << '\n';
+		tiles.add(m);
+	});
+	fDSC << station[0].start.x << ' ' << station[0].start.y << ' ' 
+		<< station[0].end.x << ' ' << station[0].end.y << '\n';
+	fDSC.close();
+	tiles.finish();
+	read_timer.stop();
+
+	// обход разрезов по тайлам их середин, чтобы соседние разрезы использовали загруженные тайлы
+	std::vector <tile_key> mid(station.size());
+	int min_tx = 0, min_ty = 0;
+	for (size_t i = 0; i < station.size(); ++i)
+	{
+		mid[i] = tiles.tile_of(station[i].v().middle());
+		min_tx = (i == 0) ? mid[i].first : std::min(min_tx, mid[i].first);
+		min_ty = (i == 0) ? mid[i].second : std::min(min_ty, mid[i].second);
+	}
+	std::vector <uint64_t> code(station.size());
+	std::vector <size_t> order(station.size());
+	for (size_t i = 0; i < station.size(); ++i)
+	{
+		code[i] = morton_code(mid[i].first - min_tx, mid[i].second - min_ty);
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&code](size_t a, size_t b) { return code[a] < code[b]; });
+
+	typedef std::pair <int, dt_result> cut_result;
+	std::vector <cut_result> results(station.size());
+	std::vector <movement> local;
+
+	std::unique_ptr <DiagWriter> diag;
+	if (options.diag_level != EDL_NONE)
+		diag.reset(new DiagWriter());
+
+	for (size_t k = 0; k < order.size(); ++k)
+	{
+		size_t i = order[k];
+
+		// векторы тайлов коридора в порядке файла: их хранилище даёт тот же коридор, что и всё поле
+		cut_profile *prof = profiler ? profiler->cut(i) : NULL;
+		ProfileTimer gather_timer(prof, EPP_READ);
+		scut cut = station[i];
+		if (cut.width == -1) cut.width = CUT_WIDTH;
+		tiles.gather(cut, local);
+		FieldStore field(local);
+		gather_timer.stop();
+
+		DynamicTopography dyn_tpg(field);
+		dyn_tpg.set_options(options);
+		dyn_tpg.set_diag_writer(diag.get());
+		dyn_tpg.set_cut(station[i]);
+		dyn_tpg.set_file_index(i + 1);
+		dyn_tpg.set_dcs_origin(geo_origin);
+		// NVdec.txt и NVgeo.txt перезаписываются каждым разрезом - остаётся последний
+		dyn_tpg.set_cut_log(i + 1 == station.size());
+		dyn_tpg.set_profile(prof);
+
+		results[i].first = dyn_tpg.take(results[i].second);
+		if (prof) prof->code = results[i].first;
+	}
+
+	ProfileTimer output_timer(run_prof, EPP_OUTPUT);
+	TextWriter fres(out_file);
+	for (size_t i = 0; i < station.size(); ++i)
+	{
+		if (results[i].first == EC_DT_SUCCESS)
+			results[i].second.print_to(fres);
+		else
+			std::cerr << "Error: DT taking: " << results[i].first << std::endl;
+	}
+	fres.close();
+
+	if (diag)
+		diag->finish();
+	output_timer.stop();
+
+	if (profiler)
+		profiler->write(profile_file, 1);
+}
+
 void calculate_dyn_top()
 {
-	std::ofstream fres;
+	if (memory_budget > 0)
+	{
+		calculate_dyn_top_tiled();
+		return;
+	}
+
+	TextWriter fres;
+
+	// этапы запуска (чтение, пересчёт, вывод) считаются в этом потоке, этапы разрезов - потоками разрезов
+	std::unique_ptr <Profiler> profiler;
+	if (profile_file != NULL)
+		profiler.reset(new Profiler());
+	cut_profile *run_prof = profiler ? profiler->run() : NULL;
 
 	std::vector <movement> mvn;
 	std::vector <scut> station;
 
+	ProfileTimer read_timer(run_prof, EPP_READ);
 	read_cuts(station_points_file, station);
-	read_movement_field(move_points_file, mvn);
+
+	// двоичное поле отображается в память, текстовое читается в mvn
+	std::shared_ptr <FieldFile> field_file;
+	if (is_field_file(move_points_file))
+	{
+		field_file = std::make_shared <FieldFile>();
+		if (field_file->open(move_points_file) != EC_FF_SUCCESS)
+			return;
+	}
+	else
+		read_movement_field(move_points_file, mvn);
+	read_timer.stop();
 	
 	if (station.size() == 0)
 	{
 		std::cerr << "Error: Station amount is zero\n";
 		return;
 	}
+	if (profiler) profiler->set_cut_count(station.size());
 
 	// flog.open(output_log);
 	// fitg.open(itg_log);
 
+	ProfileTimer transform_timer(run_prof, EPP_TRANSFORM);
 	point geo_origin = station[0].v().middle();
-	to_cartesian_cs(mvn, station);
-
-	std::ofstream fDSC;
-	fDSC.open("DSC.txt");
-	for (size_t i = 0; i < mvn.size(); i++)
-		fDSC << mvn[i].mv.start.x << " " << mvn[i].mv.start.y << " " 
-			<< mvn[i].mv.end.x << " " << mvn[i].mv.end.y << std::endl;
-	fDSC << station[0].start.x << " " << station[0].start.y << " " 
-		<< station[0].end.x << " " << station[0].end.y << std::endl;
-	fDSC.close();
+	to_cartesian_cs(mvn, station, thread_count);
+
+	// поле переходит в общее хранилище без копирования
+	std::unique_ptr <FieldStore> field_store;
+	if (field_file)
+		field_store.reset(new FieldStore(field_file, geo_origin));
+	else
+		field_store.reset(new FieldStore(mvn));
+	const FieldStore &field = *field_store;
+	transform_timer.stop();
+
+	if (options.diag_level != EDL_NONE)
+	{
+		ProfileTimer dsc_timer(run_prof, EPP_OUTPUT);
+		TextWriter fDSC("DSC.txt");
+		for (size_t i = 0; i < field.size(); i++)
+		{
+			movement m = field.at(i);
+			fDSC << m.mv.start.x << ' ' << m.mv.start.y << ' ' 
+				<< m.mv.end.x << ' ' << m.mv.end.y << '\n';
+		}
+		fDSC << station[0].start.x << ' ' << station[0].start.y << ' ' 
+			<< station[0].end.x << ' ' << station[0].end.y << '\n';
+		fDSC.close();
+	}
+
+	// диагностические файлы разрезов пишутся в фоне, пока считаются следующие разрезы
+	std::unique_ptr <DiagWriter> diag;
+	if (options.diag_level != EDL_NONE)
+		diag.reset(new DiagWriter());
 
 	fres.open(out_file);
 
-	DynamicTopography dyn_tpg(mvn);
+	if (thread_count == 1)
+	{
+		DynamicTopography dyn_tpg(field);
+		dyn_tpg.set_options(options);
+		dyn_tpg.set_diag_writer(diag.get());
 
-	for (size_t i = 0; i < station.size(); ++i)
+		for (size_t i = 0; i < station.size(); ++i)
+		{
+			dyn_tpg.set_cut(station[i]);
+			dyn_tpg.set_file_index(i + 1);
+			dyn_tpg.set_dcs_origin(geo_origin);
+			// NVdec.txt и NVgeo.txt перезаписываются каждым разрезом - остаётся последний
+			dyn_tpg.set_cut_log(i + 1 == station.size());
+			cut_profile *prof = profiler ? profiler->cut(i) : NULL;
+			dyn_tpg.set_profile(prof);
+
+			struct dt_result dt_res;
+			int ce = dyn_tpg.take(dt_res);
+			if (prof) prof->code = ce;
+
+			ProfileTimer output_timer(run_prof, EPP_OUTPUT);
+			if (ce == EC_DT_SUCCESS)
+				dt_res.print_to(fres);
+			else
+				std::cerr << "Error: DT taking: " << ce << std::endl;
+
+		}
+	}
+	else
 	{
-		dyn_tpg.set_cut(station[i]);
-		dyn_tpg.set_file_index(i + 1);
-		dyn_tpg.set_dcs_origin(geo_origin);
+		// разрезы независимы: каждый поток считает своим экземпляром DynamicTopography
+		// над общим хранилищем поля, результаты выводятся в порядке разрезов через буфер восстановления порядка
+		ThreadPool pool(thread_count);
 
-		struct dt_result dt_res;
-		int ce = dyn_tpg.take(dt_res);
+		std::vector <DynamicTopography> dyn_tpg;
+		dyn_tpg.reserve(pool.size());
+		for (int w = 0; w < pool.size(); ++w)
+		{
+			dyn_tpg.emplace_back(field);
+			dyn_tpg.back().set_options(options);
+			dyn_tpg.back().set_diag_writer(diag.get());
+		}
 
-		if (ce == EC_DT_SUCCESS)
-			dt_res.print_to(fres);
-		else
-			std::cerr << "Error: DT taking: " << ce << std::endl;
+		typedef std::pair <int, dt_result> cut_result;
+		ReorderBuffer <cut_result> results(station.size());
+
+		for (size_t i = 0; i < station.size(); ++i)
+			pool.submit([&, i](int w)
+			{
+				dyn_tpg[w].set_cut(station[i]);
+				dyn_tpg[w].set_file_index(i + 1);
+				dyn_tpg[w].set_dcs_origin(geo_origin);
+				// NVdec.txt и NVgeo.txt перезаписываются каждым разрезом - остаётся последний
+				dyn_tpg[w].set_cut_log(i + 1 == station.size());
+				cut_profile *prof = profiler ? profiler->cut(i) : NULL;
+				dyn_tpg[w].set_profile(prof);
 
+				struct dt_result dt_res;
+				int ce = dyn_tpg[w].take(dt_res);
+				if (prof) prof->code = ce;
+				results.put(i, cut_result(ce, dt_res));
+			});
+
+		for (size_t i = 0; i < station.size(); ++i)
+		{
+			cut_result res = results.take(i);
+
+			ProfileTimer output_timer(run_prof, EPP_OUTPUT);
+			if (res.first == EC_DT_SUCCESS)
+				res.second.print_to(fres);
+			else
+				std::cerr << "Error: DT taking: " << res.first << std::endl;
+		}
+
+		pool.wait();
 	}
 
+	ProfileTimer output_timer(run_prof, EPP_OUTPUT);
 	fres.close();
 
+	if (diag)
+		diag->finish();
+	output_timer.stop();
+
+	if (profiler)
+		profiler->write(profile_file, thread_count);
+
 	// flog.close();
 	// fitg.close();
 }
 
+// Временной ряд ДТ разрезов по списку файлов поля (по снимку на строку). Разрезы читаются и
+// переводятся в локальную СК один раз, снимки считаются параллельно (разрезы снимка - по порядку),
+// снимки с общей пиксельной сеткой начал векторов используют одну сетку поля
+void calculate_time_series(char *series_file)
+{
+	std::vector <std::string> snapshot;
+	TextReader flist(series_file);
+	const char *p, *last;
+	while (flist.next_line(p, last))
+	{
+		while (p < last && isspace((unsigned char)*p)) ++p;
+		while (last > p && isspace((unsigned char)*(last - 1))) --last;
+		if (p == last) continue;
+
+		snapshot.push_back(std::string(p, last));
+		if (!file_exists(snapshot.back().c_str()))
+		{
+			std::cerr << "Error: field file " << snapshot.back() << " is not found\n";
+			return;
+		}
+	}
+
+	std::vector <scut> station;
+	read_cuts(station_points_file, station);
+
+	if (snapshot.size() == 0 || station.size() == 0)
+	{
+		std::cerr << "Error: " << (snapshot.size() == 0 ? "Snapshot" : "Station") << " amount is zero\n";
+		return;
+	}
+
+	point geo_origin = station[0].v().middle();
+	std::vector <movement> no_mvn;
+	to_cartesian_cs(no_mvn, station);
+
+	GridCache grids;
+
+	typedef std::pair <int, dt_result> cut_result;
+	size_t cut_count = station.size();
+	std::vector <cut_result> results(cut_count * snapshot.size());
+
+	ThreadPool pool(thread_count);
+	for (size_t s = 0; s < snapshot.size(); ++s)
+		pool.submit([&, s](int)
+		{
+			std::shared_ptr <const FieldStore> field;
+			if (is_field_file(snapshot[s].c_str()))
+			{
+				std::shared_ptr <FieldFile> ff = std::make_shared <FieldFile>();
+				int ce = ff->open(snapshot[s].c_str());
+				if (ce != EC_FF_SUCCESS)
+				{
+					for (size_t i = 0; i < cut_count; ++i)
+						results[i * snapshot.size() + s].first = ce;
+					return;
+				}
+				field = std::make_shared <FieldStore>(ff, geo_origin);
+			}
+			else
+			{
+				std::vector <movement> mvn;
+				std::vector <int> pixels;
+				read_movement_field(snapshot[s].c_str(), mvn, &pixels);
+				field = grids.make_store(mvn, pixels, geo_origin);
+			}
+
+			// диагностические файлы разрезов снимков не пишутся
+			DynamicTopography dyn_tpg(*field);
+			dyn_tpg.set_options(options);
+			dyn_tpg.set_dcs_origin(geo_origin);
+			for (size_t i = 0; i < cut_count; ++i)
+			{
+				dyn_tpg.set_cut(station[i]);
+				dyn_tpg.set_file_index(i + 1);
+
+				cut_result &res = results[i * snapshot.size() + s];
+				res.first = dyn_tpg.take(res.second);
+			}
+		});
+	pool.wait();
+
+	// таблица по разрезам, внутри разреза - по снимкам
+	TextWriter fres(out_file);
+	for (size_t i = 0; i < cut_count; ++i)
+		for (size_t s = 0; s < snapshot.size(); ++s)
+		{
+			cut_result &res = results[i * snapshot.size() + s];
+			if (res.first == EC_DT_SUCCESS)
+			{
+				fres << i + 1 << ' ' << s + 1 << ' ';
+				res.second.print_to(fres);
+			}
+			else
+				std::cerr << "Error: DT taking (cut " << i + 1 << ", snapshot " << s + 1 << "): " 
+						<< res.first << std::endl;
+		}
+	fres.close();
+
+	std::cout << snapshot.size() << " snapshots, " << grids.reused() << " of them on the grid of an earlier snapshot\n";
+}
+
+// Наибольшая |dDT / dp| между соседними по возрастанию значениями параметра axis (0 - ширина,
+// 1 - диаметр, 2 - коэффициент) при неизменных остальных; value[i] < 0 - значение не числовое.
+// -1 - нет ни одной пары
+double sweep_slope(const sweep_grid &grid, const std::vector <sweep_result> &res, int axis, 
+				   const std::vector <double> &value)
+{
+	size_t n[3] = {grid.width.size(), grid.itp_diameter.size(), grid.weight_coef.size()};
+	std::vector <size_t> order;
+	for (size_t i = 0; i < value.size(); ++i)
+		if (value[i] >= 0.0) order.push_back(i);
+	std::stable_sort(order.begin(), order.end(), [&value](size_t a, size_t b) { return value[a] < value[b]; });
+
+	double slope = -1.0;
+	size_t i[3];
+	for (size_t rest = 0; rest < grid.size() / n[axis]; ++rest)
+	{
+		// номера остальных параметров
+		size_t r = rest;
+		for (int a = 2; a >= 0; --a)
+			if (a != axis)
+				i[a] = r % n[a], r /= n[a];
+
+		for (size_t k = 1; k < order.size(); ++k)
+		{
+			i[axis] = order[k - 1];
+			const sweep_result &lo = res[grid.index(i[0], i[1], i[2])];
+			i[axis] = order[k];
+			const sweep_result &hi = res[grid.index(i[0], i[1], i[2])];
+			double dp = value[order[k]] - value[order[k - 1]];
+			if (lo.first == EC_DT_SUCCESS && hi.first == EC_DT_SUCCESS && dp > 0.0)
+				slope = std::max(slope, fabs(hi.second.dt - lo.second.dt) / dp);
+		}
+	}
+	return slope;
+}
+
+// Перебор параметров разрезов списка sweep_file: строки всех сочетаний в out_file, 
+// таблица чувствительности в out_file.sens
+void calculate_sweep(char *sweep_file)
+{
+	std::vector <scut> station;
+	std::vector <sweep_grid> grid;
+	read_sweep(sweep_file, station, grid);
+
+	if (station.size() == 0)
+	{
+		std::cerr << "Error: Station amount is zero\n";
+		return;
+	}
+
+	// та же локальная СК, что у расчёта по списку разрезов
+	std::shared_ptr <const DTField> field;
+	if (DTField::load(move_points_file, station[0].v().middle(), field) != EC_CORE_SUCCESS)
+		return;
+
+	std::vector <std::vector <sweep_result> > results(station.size());
+	ThreadPool pool(thread_count);
+	for (size_t i = 0; i < station.size(); ++i)
+		pool.submit([&, i](int)
+		{
+			field->sweep(station[i], grid[i], options, results[i]);
+		});
+	pool.wait();
+
+	TextWriter fres(out_file), fsens((std::string(out_file) + ".sens").c_str());
+	for (size_t i = 0; i < station.size(); ++i)
+	{
+		const sweep_grid &g = grid[i];
+		double dt_min = 0.0, dt_max = 0.0, dt_sum = 0.0;
+		size_t computed = 0;
+		for (size_t iw = 0; iw < g.width.size(); ++iw)
+			for (size_t id = 0; id < g.itp_diameter.size(); ++id)
+				for (size_t ik = 0; ik < g.weight_coef.size(); ++ik)
+				{
+					sweep_result &res = results[i][g.index(iw, id, ik)];
+					if (res.first != EC_DT_SUCCESS)
+					{
+						std::cerr << "Error: DT taking (cut " << i + 1 << ", width " << g.width[iw] 
+								<< ", diameter " << g.itp_diameter[id] << ", weight " << g.weight_coef[ik] 
+								<< "): " << res.first << std::endl;
+						continue;
+					}
+					fres << i + 1 << ' ' << g.width[iw] << ' ' << g.itp_diameter[id] << ' ' 
+						 << g.weight_coef[ik] << ' ';
+					res.second.print_to(fres);
+
+					double dt = res.second.dt;
+					dt_min = (computed == 0) ? dt : std::min(dt_min, dt);
+					dt_max = (computed == 0) ? dt : std::max(dt_max, dt);
+					dt_sum += dt;
+					++computed;
+				}
+
+		// числовые значения параметров: ширина и коэффициент по умолчанию, расчётный диаметр пропускается
+		std::vector <double> width(g.width), weight(g.weight_coef);
+		for (size_t iw = 0; iw < width.size(); ++iw)
+			if (width[iw] == -1) width[iw] = CUT_WIDTH;
+		for (size_t ik = 0; ik < weight.size(); ++ik)
+			if (weight[ik] < 0.0) weight[ik] = Interpolation::default_weight_coef() * 1000;
+
+		fsens << i + 1 << ' ' << g.size() << ' ' << computed << ' ' << dt_min << ' ' << dt_max << ' ' 
+			  << ((computed > 0) ? dt_sum / computed : 0.0) << ' ' << sweep_slope(g, results[i], 0, width) << ' ' 
+			  << sweep_slope(g, results[i], 1, g.itp_diameter) << ' ' << sweep_slope(g, results[i], 2, weight) << '\n';
+	}
+	fres.close();
+	fsens.close();
+}
+
+// Пересчёт после изменения поля: из состояния предыдущего расчёта (out_file.state) берутся
+// результаты разрезов, в коридоры которых не попал ни один добавленный или удалённый вектор
+void calculate_update(char *delta_file)
+{
+	std::vector <scut> station;
+	read_cuts(station_points_file, station);
+	if (station.size() == 0)
+	{
+		std::cerr << "Error: Station amount is zero\n";
+		return;
+	}
+
+	std::vector <movement> added, removed;
+	if (!read_field_delta(delta_file, added, removed))
+		return;
+
+	// та же локальная СК, что у расчёта по списку разрезов
+	std::shared_ptr <const DTField> field;
+	if (DTField::load(move_points_file, station[0].v().middle(), field) != EC_CORE_SUCCESS)
+		return;
+
+	std::string state_file = std::string(out_file) + ".state";
+	uint64_t hash = file_hash(station_points_file);
+	std::string opts = run_options(options, memory_budget);
+	RunState state;
+	bool incremental = file_exists(state_file.c_str()) && state.read(state_file.c_str()) == EC_DS_SUCCESS;
+	if (incremental && (state.cut_list_hash() != hash || state.cut_count() != station.size()))
+	{
+		std::cerr << "Warning: " << state_file << " is of another cut list, all cuts are computed\n";
+		incremental = false;
+	}
+	else if (incremental && state.run_options() != opts)
+	{
+		std::cerr << "Warning: " << state_file << " is of other options (" << state.run_options() << ", now " 
+				  << opts << "), all cuts are computed\n";
+		incremental = false;
+	}
+	else if (incremental && state.field_size() + added.size() != field->size() + removed.size())
+	{
+		std::cerr << "Warning: " << state_file << " (" << state.field_size() << " vectors) and the delta (+" 
+				  << added.size() << ", -" << removed.size() << ") do not match the field (" << field->size() 
+				  << " vectors), all cuts are computed\n";
+		incremental = false;
+	}
+
+	if (!incremental)
+		state.reset(hash, opts, station.size());
+	size_t recomputed = update_results(*field, station, added, removed, options, thread_count, !incremental, state);
+
+	TextWriter fres(out_file);
+	for (size_t i = 0; i < station.size(); ++i)
+	{
+		if (state.result_code(i) == EC_DT_SUCCESS)
+			fres << state.result(i).c_str();
+		else
+			std::cerr << "Error: DT taking: " << state.result_code(i) << std::endl;
+	}
+	fres.close();
+	if (state.write(state_file.c_str()) != EC_DS_SUCCESS)
+		return;
+
+	std::cout << recomputed << " of " << station.size() << " cuts computed (" << added.size() 
+			  << " vectors added, " << removed.size() << " removed)\n";
+}
+
+// Карта ДТ по описанию map_file: поле индексируется один раз в локальной СК опорной точки
+void calculate_map(char *map_file)
+{
+	map_spec spec;
+	DTMap map;
+	if (read_map_spec(map_file, spec) != EC_MAP_SUCCESS || map.set_spec(spec) != EC_MAP_SUCCESS)
+		return;
+
+	std::shared_ptr <const DTField> field;
+	if (DTField::load(move_points_file, spec.geo_ref, field) != EC_CORE_SUCCESS)
+		return;
+
+	size_t valid = map.compute(field->store(), options, thread_count);
+	if (map.write(out_file) != EC_MAP_SUCCESS || 
+		map.write_ascii((std::string(out_file) + ".asc").c_str()) != EC_MAP_SUCCESS)
+		return;
+
+	std::cout << map.width() << " x " << map.height() << " nodes, " << valid << " with DT, " 
+			  << map.failed_paths() << " paths failed\n";
+}
+
+// Сервер разрезов: начало локальной СК - середина первого разреза списка (ответы совпадают
+// с расчётом по этому списку), без списка - начало СК двоичного файла или середина поля
+void run_server(const char *socket_path, const char *field_file, const char *cuts_file)
+{
+	point geo_origin;
+	if (cuts_file != NULL)
+	{
+		std::vector <scut> station;
+		read_cuts(cuts_file, station);
+		if (station.size() == 0)
+		{
+			std::cerr << "Error: Station amount is zero\n";
+			return;
+		}
+		geo_origin = station[0].v().middle();
+	}
+	else
+	{
+		FieldFile ff;
+		if (is_field_file(field_file) && ff.open(field_file) == EC_FF_SUCCESS && ff.has_frame())
+			geo_origin = ff.frame_origin();
+		else
+		{
+			double xmin = HUGE_VAL, ymin = HUGE_VAL, xmax = -HUGE_VAL, ymax = -HUGE_VAL;
+			for_each_movement(field_file, [&](const movement &m)
+			{
+				xmin = std::min(xmin, m.mv.start.x), xmax = std::max(xmax, m.mv.start.x);
+				ymin = std::min(ymin, m.mv.start.y), ymax = std::max(ymax, m.mv.start.y);
+			});
+			geo_origin = point((xmin + xmax) / 2, (ymin + ymax) / 2);
+		}
+	}
+
+	DTServer server(geo_origin, options, thread_count);
+	if (server.load(field_file) != EC_SRV_SUCCESS)
+		return;
+
+	std::cout << "Serving " << field_file << " on " << socket_path << "\n";
+	server.run(socket_path);
+}
+
 bool is_filenames_correct(char *fn1, char *fn2)
 {
 	return strcmp(fn1, fn2) && file_exists(fn1) && file_exists(fn2);
@@ -233,6 +932,40 @@ bool is_filenames_correct(char *fn1, char *fn2)
 
 void parse_cmd_arguments(int argc, char** argv)
 {
+	// параметры расчёта предшествуют именам файлов
+	while (argc > 3)
+	{
+		if (strcmp(argv[1], "-j") == false)
+			thread_count = ThreadPool::resolve_thread_count(atoi(argv[2]));
+		else if (strcmp(argv[1], "-a") == false)
+			options.itg_tolerance = atof(argv[2]);
+		else if (strcmp(argv[1], "-m") == false)
+			memory_budget = (size_t)(atof(argv[2]) * FT_MB);
+		else if (strcmp(argv[1], "-p") == false && strcmp(argv[2], "fast") == false)
+			options.precision = EPR_FAST;
+		else if (strcmp(argv[1], "-p") == false && strcmp(argv[2], "exact") == false)
+			options.precision = EPR_EXACT;
+		else if (strcmp(argv[1], "-d") == false && strcmp(argv[2], "none") == false)
+			options.diag_level = EDL_NONE;
+		else if (strcmp(argv[1], "-d") == false && strcmp(argv[2], "summary") == false)
+			options.diag_level = EDL_SUMMARY;
+		else if (strcmp(argv[1], "-d") == false && strcmp(argv[2], "full") == false)
+			options.diag_level = EDL_FULL;
+		else if (strcmp(argv[1], "-o") == false && strcmp(argv[2], "table") == false)
+			options.coriolis_table = true;
+		else if (strcmp(argv[1], "-o") == false && strcmp(argv[2], "direct") == false)
+			options.coriolis_table = false;
+		else if (strcmp(argv[1], "-k") == false && strcmp(argv[2], "table") == false)
+			options.curvature_table = true;
+		else if (strcmp(argv[1], "-k") == false && strcmp(argv[2], "direct") == false)
+			options.curvature_table = false;
+		else if (strcmp(argv[1], "--profile") == false)
+			profile_file = argv[2];
+		else
+			break;
+		argc -= 2, argv += 2;
+	}
+
 	if (argc == 2)
 	{
 		if (strcmp(argv[1], "-h") == false)
@@ -251,8 +984,58 @@ void parse_cmd_arguments(int argc, char** argv)
 			return;
 		}
 	}
+	else if (argc == 5 && strcmp(argv[1], "-c") == false && is_filenames_correct(argv[2], argv[4]))
+	{
+		convert_field(argv[2], argv[3], argv[4]);
+		return;
+	}
+	else if (argc == 5 && strcmp(argv[1], "-S") == false && is_filenames_correct(argv[3], argv[4]))
+	{
+		run_server(argv[2], argv[3], argv[4]);
+		return;
+	}
+	else if (argc == 5 && strcmp(argv[1], "-s") == false && is_filenames_correct(argv[2], argv[3]))
+	{
+		station_points_file = argv[3];
+		out_file = argv[4];
+		calculate_time_series(argv[2]);
+		return;
+	}
+	else if (argc == 5 && strcmp(argv[1], "-w") == false && is_filenames_correct(argv[2], argv[3]))
+	{
+		move_points_file = argv[2];
+		out_file = argv[4];
+		calculate_sweep(argv[3]);
+		return;
+	}
+	else if (argc == 6 && strcmp(argv[1], "-u") == false && is_filenames_correct(argv[2], argv[3]) && 
+			 file_exists(argv[4]))
+	{
+		move_points_file = argv[2];
+		station_points_file = argv[3];
+		out_file = argv[5];
+		calculate_update(argv[4]);
+		return;
+	}
+	else if (argc == 5 && strcmp(argv[1], "-g") == false && is_filenames_correct(argv[2], argv[3]))
+	{
+		move_points_file = argv[2];
+		out_file = argv[4];
+		calculate_map(argv[3]);
+		return;
+	}
 	else if (argc == 4)
 	{
+		if (strcmp(argv[1], "-c") == false && file_exists(argv[2]))
+		{
+			convert_field(argv[2], argv[3], NULL);
+			return;
+		}
+		if (strcmp(argv[1], "-S") == false && file_exists(argv[3]))
+		{
+			run_server(argv[2], argv[3], NULL);
+			return;
+		}
 		if (strcmp(argv[1], "-t") == false && is_filenames_correct(argv[2], argv[3]))
 		{
 			move_points_file = argv[2];
@@ -0,0 +1,249 @@
+#include "corridor_filter.h"
+
+#include <atomic>
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DT_SIMD_X86
+#include <immintrin.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// ----------------------------- SIMD dispatch -------------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+static std::atomic <int> current_simd_level(-1);
+
+E_SIMD_LEVEL simd_supported_level()
+{
+#ifdef DT_SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) return ESL_AVX512;
+	if (__builtin_cpu_supports("avx2")) return ESL_AVX2;
+#endif
+	return ESL_SCALAR;
+}
+
+E_SIMD_LEVEL simd_level()
+{
+	int level = current_simd_level.load();
+	if (level < 0)
+	{
+		level = simd_supported_level();
+		current_simd_level.store(level);
+	}
+	return (E_SIMD_LEVEL)level;
+}
+
+void set_simd_level(E_SIMD_LEVEL level)
+{
+	E_SIMD_LEVEL supported = simd_supported_level();
+	current_simd_level.store(level < supported ? level : supported);
+}
+
+const char *simd_level_name(E_SIMD_LEVEL level)
+{
+	switch (level)
+	{
+		case ESL_AVX512: return "AVX-512";
+		case ESL_AVX2: return "AVX2";
+		default: return "scalar";
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ------------------------- corridor filter kernel --------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+corridor_kernel_args::corridor_kernel_args(const scut &cut)
+{
+	Line cut_line(cut.start, cut.end);
+	a = cut_line.get_a();
+	b = cut_line.get_b();
+	c = cut_line.get_c();
+	norm = sqrt(a * a + b * b);
+	p1x = cut.start.x, p1y = cut.start.y;
+	dx = cut.end.x - cut.start.x, dy = cut.end.y - cut.start.y;
+	width = cut.width;
+}
+
+// is_t из geometry.cpp: параметр проекции в отрезке [0, 1]
+static inline bool in_unit_range(double numerator, double denominator)
+{
+	return (denominator == 0 && numerator == 0) ||
+		   (denominator != 0 && numerator / denominator >= 0 && numerator / denominator <= 1);
+}
+
+double corridor_distance(const corridor_kernel_args &k, double x, double y)
+{
+	return (k.a * x + k.b * y + k.c) / k.norm;
+}
+
+static inline bool corridor_test(const corridor_kernel_args &k, double x, double y, double v)
+{
+	double dist = corridor_distance(k, x, y);
+	if (!(fabs(dist) < k.width && v > 0)) return false;
+
+	// перпендикуляр к разрезу через начало вектора и его пересечение с разрезом
+	double la = (y + k.b) - y;
+	double lb = x - (x + k.a);
+	double lc = - y * lb - x * la;
+	double py = (k.a * lc - la * k.c) / (la * k.b - k.a * lb);
+	double px = (k.b * lc - lb * k.c) / (k.a * lb - la * k.b);
+
+	return fabs(k.a * px + k.b * py + k.c) < EPS &&
+		   in_unit_range(px - k.p1x, k.dx) && in_unit_range(py - k.p1y, k.dy);
+}
+
+static size_t corridor_filter_scalar(const corridor_kernel_args &k, const double *x0, const double *y0,
+									 const double *velocity, const int *idx, size_t n, int *sel)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < n; ++i)
+		if (corridor_test(k, x0[idx[i]], y0[idx[i]], velocity[idx[i]]))
+			sel[count++] = idx[i];
+	return count;
+}
+
+#ifdef DT_SIMD_X86
+
+__attribute__((target("avx2")))
+static inline __m256d unit_range_avx2(__m256d num, double den)
+{
+	if (den == 0)
+		return _mm256_cmp_pd(num, _mm256_setzero_pd(), _CMP_EQ_OQ);
+	__m256d t = _mm256_div_pd(num, _mm256_set1_pd(den));
+	return _mm256_and_pd(_mm256_cmp_pd(t, _mm256_setzero_pd(), _CMP_GE_OQ),
+						 _mm256_cmp_pd(t, _mm256_set1_pd(1.0), _CMP_LE_OQ));
+}
+
+__attribute__((target("avx2")))
+static size_t corridor_filter_avx2(const corridor_kernel_args &k, const double *x0, const double *y0,
+								   const double *velocity, const int *idx, size_t n, int *sel)
+{
+	const __m256d a = _mm256_set1_pd(k.a), b = _mm256_set1_pd(k.b), c = _mm256_set1_pd(k.c);
+	const __m256d norm = _mm256_set1_pd(k.norm), width = _mm256_set1_pd(k.width);
+	const __m256d p1x = _mm256_set1_pd(k.p1x), p1y = _mm256_set1_pd(k.p1y);
+	const __m256d eps = _mm256_set1_pd(EPS), zero = _mm256_setzero_pd();
+	const __m256d sign_bit = _mm256_set1_pd(-0.0);
+	const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+	size_t count = 0, i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		// маскированная выборка с явным нулевым источником: у немаскированной источник не определён
+		__m128i vi = _mm_loadu_si128((const __m128i *)(idx + i));
+		__m256d x = _mm256_mask_i32gather_pd(zero, x0, vi, all, 8);
+		__m256d y = _mm256_mask_i32gather_pd(zero, y0, vi, all, 8);
+		__m256d v = _mm256_mask_i32gather_pd(zero, velocity, vi, all, 8);
+
+		// знаковое расстояние до прямой разреза и маска velocity > 0
+		__m256d dist = _mm256_div_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(a, x),
+								_mm256_mul_pd(b, y)), c), norm);
+		__m256d m = _mm256_and_pd(_mm256_cmp_pd(_mm256_andnot_pd(sign_bit, dist), width, _CMP_LT_OQ),
+								  _mm256_cmp_pd(v, zero, _CMP_GT_OQ));
+		if (_mm256_movemask_pd(m) == 0) continue;
+
+		// проекция начала вектора на разрез
+		__m256d la = _mm256_sub_pd(_mm256_add_pd(y, b), y);
+		__m256d lb = _mm256_sub_pd(x, _mm256_add_pd(x, a));
+		__m256d lc = _mm256_sub_pd(_mm256_mul_pd(_mm256_xor_pd(y, sign_bit), lb), _mm256_mul_pd(x, la));
+		__m256d py = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(a, lc), _mm256_mul_pd(la, c)),
+								   _mm256_sub_pd(_mm256_mul_pd(la, b), _mm256_mul_pd(a, lb)));
+		__m256d px = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(b, lc), _mm256_mul_pd(lb, c)),
+								   _mm256_sub_pd(_mm256_mul_pd(a, lb), _mm256_mul_pd(la, b)));
+
+		// проекция лежит на отрезке разреза
+		__m256d f = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(a, px), _mm256_mul_pd(b, py)), c);
+		m = _mm256_and_pd(m, _mm256_cmp_pd(_mm256_andnot_pd(sign_bit, f), eps, _CMP_LT_OQ));
+		m = _mm256_and_pd(m, unit_range_avx2(_mm256_sub_pd(px, p1x), k.dx));
+		m = _mm256_and_pd(m, unit_range_avx2(_mm256_sub_pd(py, p1y), k.dy));
+
+		for (int bits = _mm256_movemask_pd(m); bits != 0; bits &= bits - 1)
+			sel[count++] = idx[i + __builtin_ctz(bits)];
+	}
+
+	// без очистки верхних половин регистров последующий SSE-код (в том числе libm) 
+	// замедляется; компилятор вставляет vzeroupper только при оптимизации
+	_mm256_zeroupper();
+
+	return count + corridor_filter_scalar(k, x0, y0, velocity, idx + i, n - i, sel + count);
+}
+
+__attribute__((target("avx512f")))
+static inline __mmask8 unit_range_avx512(__m512d num, double den)
+{
+	if (den == 0)
+		return _mm512_cmp_pd_mask(num, _mm512_setzero_pd(), _CMP_EQ_OQ);
+	__m512d t = _mm512_div_pd(num, _mm512_set1_pd(den));
+	return _mm512_cmp_pd_mask(t, _mm512_setzero_pd(), _CMP_GE_OQ) &
+		   _mm512_cmp_pd_mask(t, _mm512_set1_pd(1.0), _CMP_LE_OQ);
+}
+
+__attribute__((target("avx512f")))
+static size_t corridor_filter_avx512(const corridor_kernel_args &k, const double *x0, const double *y0,
+									 const double *velocity, const int *idx, size_t n, int *sel)
+{
+	const __m512d a = _mm512_set1_pd(k.a), b = _mm512_set1_pd(k.b), c = _mm512_set1_pd(k.c);
+	const __m512d norm = _mm512_set1_pd(k.norm), width = _mm512_set1_pd(k.width);
+	const __m512d p1x = _mm512_set1_pd(k.p1x), p1y = _mm512_set1_pd(k.p1y);
+	const __m512d eps = _mm512_set1_pd(EPS), zero = _mm512_setzero_pd();
+	const __m512i sign_bit = _mm512_set1_epi64(0x8000000000000000LL);
+
+	size_t count = 0, i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i vi = _mm256_loadu_si256((const __m256i *)(idx + i));
+		__m512d x = _mm512_mask_i32gather_pd(zero, 0xFF, vi, x0, 8);
+		__m512d y = _mm512_mask_i32gather_pd(zero, 0xFF, vi, y0, 8);
+		__m512d v = _mm512_mask_i32gather_pd(zero, 0xFF, vi, velocity, 8);
+
+		// знаковое расстояние до прямой разреза и маска velocity > 0
+		__m512d dist = _mm512_div_pd(_mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(a, x),
+								_mm512_mul_pd(b, y)), c), norm);
+		__mmask8 m = _mm512_cmp_pd_mask(_mm512_abs_pd(dist), width, _CMP_LT_OQ) &
+					 _mm512_cmp_pd_mask(v, zero, _CMP_GT_OQ);
+		if (m == 0) continue;
+
+		// проекция начала вектора на разрез
+		__m512d neg_y = _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(y), sign_bit));
+		__m512d la = _mm512_sub_pd(_mm512_add_pd(y, b), y);
+		__m512d lb = _mm512_sub_pd(x, _mm512_add_pd(x, a));
+		__m512d lc = _mm512_sub_pd(_mm512_mul_pd(neg_y, lb), _mm512_mul_pd(x, la));
+		__m512d py = _mm512_div_pd(_mm512_sub_pd(_mm512_mul_pd(a, lc), _mm512_mul_pd(la, c)),
+								   _mm512_sub_pd(_mm512_mul_pd(la, b), _mm512_mul_pd(a, lb)));
+		__m512d px = _mm512_div_pd(_mm512_sub_pd(_mm512_mul_pd(b, lc), _mm512_mul_pd(lb, c)),
+								   _mm512_sub_pd(_mm512_mul_pd(a, lb), _mm512_mul_pd(la, b)));
+
+		// проекция лежит на отрезке разреза
+		__m512d f = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(a, px), _mm512_mul_pd(b, py)), c);
+		m &= _mm512_cmp_pd_mask(_mm512_abs_pd(f), eps, _CMP_LT_OQ);
+		m &= unit_range_avx512(_mm512_sub_pd(px, p1x), k.dx);
+		m &= unit_range_avx512(_mm512_sub_pd(py, p1y), k.dy);
+
+		for (unsigned bits = m; bits != 0; bits &= bits - 1)
+			sel[count++] = idx[i + __builtin_ctz(bits)];
+	}
+
+	// без очистки верхних половин регистров последующий SSE-код (в том числе libm) 
+	// замедляется; компилятор вставляет vzeroupper только при оптимизации
+	_mm256_zeroupper();
+
+	return count + corridor_filter_scalar(k, x0, y0, velocity, idx + i, n - i, sel + count);
+}
+
+#endif // DT_SIMD_X86
+
+size_t corridor_filter(const corridor_kernel_args &k, const double *x0, const double *y0,
+					   const double *velocity, const int *idx, size_t n, int *sel)
+{
+#ifdef DT_SIMD_X86
+	switch (simd_level())
+	{
+		case ESL_AVX512: return corridor_filter_avx512(k, x0, y0, velocity, idx, n, sel);
+		case ESL_AVX2: return corridor_filter_avx2(k, x0, y0, velocity, idx, n, sel);
+		default: break;
+	}
+#endif
+	return corridor_filter_scalar(k, x0, y0, velocity, idx, n, sel);
+}
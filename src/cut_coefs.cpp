@@ -0,0 +1,81 @@
+#include "cut_coefs.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define CC_DEG2RAD (M_PI / 180)
+
+double latitude_at(const point &pt, const point &origin)
+{
+	// те же операции, что в point::to_geo_cs
+	double y = KM2M(pt.y);
+	y = y / MERIDIAN_LENGTH * 360.;
+	return y + origin.y;
+}
+
+CutCoefs::CutCoefs() : coriolis_table(false), curvature(false), curvature_table(false),
+	length(0.0), foot(0.0), perp2(0.0)
+{}
+
+void CutCoefs::set(const scut &cut, const point &dcs_origin, bool cor_table, bool curv_table)
+{
+	origin = dcs_origin;
+	coriolis_table = cor_table;
+
+	anchor_lat.clear(), anchor_sin.clear(), anchor_cos.clear();
+	if (coriolis_table)
+	{
+		// широта линейна вдоль разреза: опорные точки кратны CC_ANCHOR_STEP и покрывают его концы
+		double lat1 = latitude_at(cut.start, origin), lat2 = latitude_at(cut.end, origin);
+		double first = floor(std::min(lat1, lat2) / CC_ANCHOR_STEP);
+		double last = ceil(std::max(lat1, lat2) / CC_ANCHOR_STEP);
+		for (double k = first; k <= last; ++k)
+		{
+			double a = k * CC_ANCHOR_STEP;
+			anchor_lat.push_back(a);
+			anchor_sin.push_back(sin(a * CC_DEG2RAD));
+			anchor_cos.push_back(cos(a * CC_DEG2RAD));
+		}
+	}
+
+	curvature = cut.curvature_correction;
+	curvature_table = curv_table;
+	center = cut.curvature_center;
+	start = cut.start;
+	length = cut.v().length();
+	if (length > 0.0)
+	{
+		double cx = center.x - start.x, cy = center.y - start.y;
+		foot = (cx * (cut.end.x - start.x) + cy * (cut.end.y - start.y)) / length;
+		perp2 = std::max(cx * cx + cy * cy - foot * foot, 0.0);
+	}
+	else
+		foot = 0.0, perp2 = start.distance_to(center) * start.distance_to(center);
+}
+
+double CutCoefs::coriolis(const point &pt) const
+{
+	double lat = latitude_at(pt, origin);
+	if (!coriolis_table)
+		return coriolis_koef(lat);
+
+	// ближайшая опорная точка; узлы вне разреза (на величину округления) берут крайнюю
+	int k = (int)floor((lat - anchor_lat[0]) / CC_ANCHOR_STEP + 0.5);
+	k = std::max(0, std::min(k, (int)anchor_lat.size() - 1));
+
+	double e = (lat - anchor_lat[k]) * CC_DEG2RAD, z = e * e;
+	double sin_e = e - e * z * (1. / 6 - z / 120);
+	double cos_e = 1. - z * (0.5 - z * (1. / 24 - z / 720));
+	return 2 * EARTH_OMEGA * (anchor_sin[k] * cos_e + anchor_cos[k] * sin_e);
+}
+
+double CutCoefs::curvature_koef(const point &pt, double t) const
+{
+	if (!curvature)
+		return 0.;
+	if (!curvature_table)
+		return 1 / KM2M(center.distance_to(pt));
+
+	double u = t * length - foot;
+	return 1 / KM2M(sqrt(perp2 + u * u));
+}
@@ -0,0 +1,82 @@
+#include "diag_writer.h"
+
+#include <cstdio>
+
+const char *diag_level_name(E_DIAG_LEVEL level)
+{
+	switch (level)
+	{
+		case EDL_NONE: return "none";
+		case EDL_SUMMARY: return "summary";
+		default: return "full";
+	}
+}
+
+DiagWriter::DiagWriter() : queued_bytes(0), stopping(false)
+{
+	worker = std::thread(&DiagWriter::run, this);
+}
+
+DiagWriter::~DiagWriter()
+{
+	finish();
+}
+
+void DiagWriter::submit(const std::string &file_name, TextWriter &out)
+{
+	job j(file_name, std::vector <char>());
+	out.release(j.second);
+
+	std::unique_lock <std::mutex> lock(mtx);
+	// файл больше предела ставится в пустую очередь
+	has_space.wait(lock, [&] { return queued_bytes == 0 || queued_bytes + j.second.size() <= DW_MAX_QUEUED; });
+	queued_bytes += j.second.size();
+	jobs.push_back(std::move(j));
+	has_jobs.notify_one();
+}
+
+void DiagWriter::run()
+{
+	std::vector <job> batch;
+	for (;;)
+	{
+		{
+			std::unique_lock <std::mutex> lock(mtx);
+			has_jobs.wait(lock, [this] { return !jobs.empty() || stopping; });
+			if (jobs.empty()) return;
+			batch.swap(jobs);
+		}
+
+		size_t bytes = 0;
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			// текстовый режим, как у std::ofstream
+			FILE *f = fopen(batch[i].first.c_str(), "w");
+			if (f != NULL)
+			{
+				if (!batch[i].second.empty())
+					fwrite(batch[i].second.data(), 1, batch[i].second.size(), f);
+				fclose(f);
+			}
+			bytes += batch[i].second.size();
+		}
+		batch.clear();
+
+		{
+			std::lock_guard <std::mutex> lock(mtx);
+			queued_bytes -= bytes;
+		}
+		has_space.notify_all();
+	}
+}
+
+void DiagWriter::finish()
+{
+	{
+		std::lock_guard <std::mutex> lock(mtx);
+		stopping = true;
+	}
+	has_jobs.notify_one();
+	if (worker.joinable())
+		worker.join();
+}
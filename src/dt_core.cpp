@@ -0,0 +1,210 @@
+#include "dt_core.h"
+#include "field_file.h"
+#include "geo_transform.h"
+#include "text_io.h"
+
+#include <cctype>
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+bool file_exists(const char *fname)
+{
+	//return !(ifstream(fname) == NULL);
+#ifdef _WIN32
+	return _access(fname, 0) != -1;
+#else
+	return access(fname, F_OK) != -1;
+#endif
+}
+
+void read_cuts(const char *file_name, std::vector <scut> &cut)
+{
+	TextReader fcut(file_name);
+	scut c;
+
+	const char *p, *last;
+	while (fcut.next_line(p, last))
+		if (parse_cut(p, last, c))
+			cut.push_back(c);
+}
+
+void read_sweep(const char *file_name, std::vector <scut> &cut, std::vector <sweep_grid> &grid)
+{
+	TextReader fcut(file_name);
+	scut c;
+	sweep_grid g;
+
+	const char *p, *last;
+	while (fcut.next_line(p, last))
+		if (parse_sweep(p, last, c, g))
+		{
+			cut.push_back(c);
+			grid.push_back(g);
+		}
+}
+
+bool read_field_delta(const char *file_name, std::vector <movement> &added, std::vector <movement> &removed)
+{
+	TextReader fdelta(file_name);
+	if (!fdelta.is_open())
+	{
+		std::cerr << "Error: delta file " << file_name << " is not found\n";
+		return false;
+	}
+
+	movement m(vec(point(), point()), 0.0, 0.0);
+	const char *p, *last;
+	for (int line = 1; fdelta.next_line(p, last); ++line)
+	{
+		while (p < last && isspace((unsigned char)*p)) ++p;
+		if (p == last) continue;
+
+		char sign = *p++;
+		if ((sign != '+' && sign != '-') || !parse_movement(p, last, m))
+		{
+			std::cerr << "Error: line " << line << " of " << file_name << " is not a field change\n";
+			return false;
+		}
+		(sign == '+' ? added : removed).push_back(m);
+	}
+	return true;
+}
+
+void for_each_movement(const char *file_name, const std::function <void(const movement &)> &f, 
+					   std::vector <int> *start_pixels)
+{
+	if (start_pixels != NULL)
+		start_pixels->clear();
+
+	if (is_field_file(file_name))
+	{
+		FieldFile ff;
+		if (ff.open(file_name) != EC_FF_SUCCESS)
+			return;
+		const double *x0 = ff.column(EFC_X0), *y0 = ff.column(EFC_Y0);
+		const double *x1 = ff.column(EFC_X1), *y1 = ff.column(EFC_Y1);
+		const double *velocity = ff.column(EFC_VELOCITY), *error = ff.column(EFC_ERROR);
+		for (size_t i = 0; i < ff.count(); ++i)
+			f(movement(vec(point(x0[i], y0[i]), point(x1[i], y1[i])), velocity[i], error[i]));
+		return;
+	}
+
+	TextReader fmoves(file_name);
+	movement m(vec(point(), point()), 0.0, 0.0);
+	int pixels[2];
+
+	// строка на вектор; чтение прекращается на первой неполной строке, пустые пропускаются
+	const char *p, *last;
+	while (fmoves.next_line(p, last))
+	{
+		const char *line = p;
+		if (parse_movement(p, last, m, pixels))
+		{
+			f(m);
+			if (start_pixels != NULL)
+			{
+				start_pixels->push_back(pixels[0]);
+				start_pixels->push_back(pixels[1]);
+			}
+		}
+		else if (!is_blank(line, last))
+			break;
+	}
+}
+
+void read_movement_field(const char *file_name, std::vector <movement> &mvn, std::vector <int> *start_pixels)
+{
+	for_each_movement(file_name, [&mvn](const movement &m) { mvn.push_back(m); }, start_pixels);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ------------------------------- DTField class -----------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+DTField::DTField(std::shared_ptr <const FieldStore> store, const point &origin) : 
+	geo_origin(origin), field(store) {}
+
+int DTField::load(const char *file_name, const point &origin, std::shared_ptr <const DTField> &handle)
+{
+	if (!file_exists(file_name))
+	{
+		std::cerr << "Error: field file " << file_name << " is not found\n";
+		return EC_CORE_FIELD;
+	}
+
+	if (is_field_file(file_name))
+	{
+		std::shared_ptr <FieldFile> ff = std::make_shared <FieldFile>();
+		if (ff->open(file_name) != EC_FF_SUCCESS)
+			return EC_CORE_FIELD;
+		handle = std::make_shared <DTField>(std::make_shared <FieldStore>(ff, origin), origin);
+		return EC_CORE_SUCCESS;
+	}
+
+	std::vector <movement> mvn;
+	read_movement_field(file_name, mvn);
+	if (mvn.size() == 0)
+	{
+		std::cerr << "Error: no vectors in " << file_name << "\n";
+		return EC_CORE_FIELD;
+	}
+	handle = from_movements(mvn, origin);
+	return EC_CORE_SUCCESS;
+}
+
+std::shared_ptr <const DTField> DTField::from_movements(std::vector <movement> &mvn, const point &origin)
+{
+	// как to_cartesian_cs
+	to_dec_cs(mvn, origin);
+	return std::make_shared <DTField>(std::make_shared <FieldStore>(mvn), origin);
+}
+
+size_t DTField::size() const
+{
+	return field->size();
+}
+
+const point &DTField::origin() const
+{
+	return geo_origin;
+}
+
+const FieldStore &DTField::store() const
+{
+	return *field;
+}
+
+int DTField::compute(const scut &geo_cut, const dt_options &options, dt_result &res) const
+{
+	scut cut = geo_cut;
+	cut.start.to_dec_cs(geo_origin);
+	cut.end.to_dec_cs(geo_origin);
+	cut.curvature_center.to_dec_cs(geo_origin);
+
+	// без писателя диагностики DynamicTopography не создаёт файлов
+	DynamicTopography dyn_tpg(*field);
+	dyn_tpg.set_options(options);
+	dyn_tpg.set_cut(cut);
+	dyn_tpg.set_dcs_origin(geo_origin);
+	return dyn_tpg.take(res);
+}
+
+void DTField::sweep(const scut &geo_cut, const sweep_grid &grid, const dt_options &options, 
+					std::vector <sweep_result> &res) const
+{
+	scut cut = geo_cut;
+	cut.start.to_dec_cs(geo_origin);
+	cut.end.to_dec_cs(geo_origin);
+	cut.curvature_center.to_dec_cs(geo_origin);
+
+	DynamicTopography dyn_tpg(*field);
+	dyn_tpg.set_options(options);
+	dyn_tpg.set_cut(cut);
+	dyn_tpg.set_dcs_origin(geo_origin);
+	dyn_tpg.sweep(grid, res);
+}
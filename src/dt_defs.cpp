@@ -1,22 +1,23 @@
 #include "dt_defs.h"
+#include "geo_transform.h"
 
 
 ////////////////////////////////////////////////////////////////////////////////
 // ----------------------------- scut struct ---------------------------------//
 ////////////////////////////////////////////////////////////////////////////////
 
-scut::scut(vec v, double w, double id, double wc) : 
+scut::scut(const vec &v, double w, double id, double wc) : 
 	scut(v, w, id, wc, point(0., 0.), false) {}
 
-scut::scut(vec v, double w, double id, double wc, point cc, bool correction) :
+scut::scut(const vec &v, double w, double id, double wc, const point &cc, bool correction) :
 	start(v.start), end(v.end), width(w), itp_diameter(id), weight_coef(wc / 1000),
 	 curvature_center(cc), curvature_correction(correction) {}
 
-vec scut::v(){
+vec scut::v() const {
 	return vec(start, end);
 }
 
-std::string scut::toString(std::string name)
+std::string scut::toString(std::string name) const
 {
 	char str[200];
 	sprintf(str, "%s(%2f, %2f) with %s", name.c_str(), width, weight_coef * 1000, 
@@ -53,15 +54,12 @@ point dec2geo(const point &dp, const point &origin)
 // origin - центр декартовой СК в географических координатах
 void point::to_dec_cs(const point &origin) 
 {
-	float latitude = this->y;
+	double latitude = this->y;
 
 	this->to_related_cs(origin);
 
-	// радиус Земли (от её центра к точке на поверхности заданной географической широты)
-	double earth_radius_at_latitude = EQUATOR_RADIUS * (1. - EARTH_FLATTENING * sqr(sin(latitude * M_PI / 180)));
-
 	// радиус сечения Земли на заданной географической широте
-	double little_radius_at_latitude = earth_radius_at_latitude * cos(latitude * M_PI / 180);
+	double little_radius_at_latitude = parallel_radius(latitude);
 
 	this->x *= little_radius_at_latitude * M_PI / 180;
 	this->y *= METERS_IN_ONE_DEG;
@@ -77,14 +75,10 @@ void point::to_geo_cs(const point &origin)
 
 	this->y = this->y / MERIDIAN_LENGTH * 360.;	
 
-	float latitude = this->y + origin.y;
-
-	// радиус Земли (от её центра к точке на поверхности заданной географической широты)
-	double earth_radius_at_latitude = EQUATOR_RADIUS * 
-								(1. - EARTH_FLATTENING * sqr(sin(latitude * M_PI / 180)));
+	double latitude = this->y + origin.y;
 
 	// радиус сечения Земли на заданной географической широте
-	double little_radius_at_latitude = earth_radius_at_latitude * cos(latitude * M_PI / 180);
+	double little_radius_at_latitude = parallel_radius(latitude);
 
 	this->x *= 180. / M_PI / little_radius_at_latitude;
 
@@ -92,15 +86,11 @@ void point::to_geo_cs(const point &origin)
 }
 
 
-void to_cartesian_cs(std::vector <movement> &mvn, std::vector <scut> &station)
+void to_cartesian_cs(std::vector <movement> &mvn, std::vector <scut> &station, int thread_count)
 {
 	point dcs_geo_origin = station[0].v().middle();
 
-	for (size_t j = 0; j < mvn.size(); ++j)
-	{
-		mvn[j].mv.start.to_dec_cs(dcs_geo_origin);
-		mvn[j].mv.end.to_dec_cs(dcs_geo_origin);
-	}
+	to_dec_cs(mvn, dcs_geo_origin, thread_count);
 
 	for (size_t j = 0; j < station.size(); ++j)
 	{
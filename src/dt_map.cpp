@@ -0,0 +1,297 @@
+#include "dt_map.h"
+#include "field_file.h"
+#include "text_io.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static bool little_endian()
+{
+	uint32_t v = 1;
+	return *(const char *)&v == 1;
+}
+
+int read_map_spec(const char *file_name, map_spec &spec)
+{
+	TextReader fspec(file_name);
+	if (!fspec.is_open())
+	{
+		std::cerr << "Error: map description " << file_name << " is not found\n";
+		return EC_MAP_SPEC;
+	}
+
+	// первая непустая строка
+	const char *p, *last;
+	while (fspec.next_line(p, last))
+	{
+		if (is_blank(p, last)) continue;
+
+		if (!(parse_number(p, last, spec.geo_min.x) && parse_number(p, last, spec.geo_min.y) &&
+			  parse_number(p, last, spec.geo_max.x) && parse_number(p, last, spec.geo_max.y) &&
+			  parse_number(p, last, spec.spacing) && parse_number(p, last, spec.geo_ref.x) &&
+			  parse_number(p, last, spec.geo_ref.y)))
+			break;
+
+		double opt[3] = {-1.0, -1.0, -1.0};
+		for (int k = 0; k < 3 && parse_number(p, last, opt[k]); ++k) ;
+		spec.width = opt[0], spec.itp_diameter = opt[1], spec.weight_coef = opt[2];
+		return EC_MAP_SUCCESS;
+	}
+
+	std::cerr << "Error: map description " << file_name << " can not be read\n";
+	return EC_MAP_SPEC;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// --------------------------------- DTMap class -----------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+DTMap::DTMap() : ix0(0), iy0(0), nx(0), ny(0), row_code(EC_DT_SUCCESS) {}
+
+int DTMap::set_spec(const map_spec &s)
+{
+	if (!(s.spacing > 0.0))
+	{
+		std::cerr << "Error: map grid spacing must be positive\n";
+		return EC_MAP_SPEC;
+	}
+
+	// область в локальной СК: |x| при неизменной долготе растёт к экватору, крайние x - в углах,
+	// а у области, пересекающей экватор, - и на экваторе
+	int corners = (s.geo_min.y < 0.0 && 0.0 < s.geo_max.y) ? 6 : 4;
+	double xmin = 0.0, xmax = 0.0, ymin = 0.0, ymax = 0.0;
+	for (int c = 0; c < corners; ++c)
+	{
+		point pt((c & 1) ? s.geo_max.x : s.geo_min.x, (c & 2) ? s.geo_max.y : s.geo_min.y);
+		if (c >= 4) pt.y = 0.0;
+		pt.to_dec_cs(s.geo_ref);
+		xmin = std::min(xmin, pt.x), xmax = std::max(xmax, pt.x);
+		ymin = std::min(ymin, pt.y), ymax = std::max(ymax, pt.y);
+	}
+
+	double x0 = floor(xmin / s.spacing), x1 = ceil(xmax / s.spacing);
+	double y0 = floor(ymin / s.spacing), y1 = ceil(ymax / s.spacing);
+	if ((x1 - x0 + 1) * (y1 - y0 + 1) > MAP_MAX_NODES)
+	{
+		std::cerr << "Error: map grid has more than " << MAP_MAX_NODES << " nodes\n";
+		return EC_MAP_SPEC;
+	}
+
+	spec = s;
+	ix0 = (int)x0, iy0 = (int)y0;
+	nx = (int)(x1 - x0) + 1, ny = (int)(y1 - y0) + 1;
+	value.assign((size_t)nx * ny, MAP_NODATA);
+	return EC_MAP_SUCCESS;
+}
+
+int DTMap::width() const
+{
+	return nx;
+}
+
+int DTMap::height() const
+{
+	return ny;
+}
+
+point DTMap::node(int i, int j) const
+{
+	return point((ix0 + i) * spec.spacing, (iy0 + j) * spec.spacing);
+}
+
+double DTMap::at(int i, int j) const
+{
+	return value[(size_t)j * nx + i];
+}
+
+const point &DTMap::origin() const
+{
+	return spec.geo_ref;
+}
+
+// ДТ вдоль пути из count отрезков сетки от a до b, dt[k] - от a до k-го узла пути; узлы first..last -
+// в пределах крайних проекций векторов коридора пути
+static int take_path(DynamicTopography &dyn_tpg, const map_spec &spec, const point &a, const point &b,
+					 int count, std::vector <double> &dt, int &first, int &last)
+{
+	if (count == 0)
+	{
+		dt.assign(1, 0.0);
+		first = last = 0;
+		return EC_DT_SUCCESS;
+	}
+	dyn_tpg.set_cut(scut(vec(a, b), spec.width, spec.itp_diameter, spec.weight_coef));
+	return dyn_tpg.take_profile(count, dt, first, last);
+}
+
+static bool in_range(int k, int first, int last)
+{
+	return first <= k && k <= last;
+}
+
+size_t DTMap::compute(const FieldStore &field, const dt_options &options, int thread_count)
+{
+	int ref_i = -ix0, ref_j = -iy0;
+
+	// опорная строка с запада на восток, столбцы с юга на север
+	std::vector <double> row;
+	std::vector <std::vector <double> > column(nx);
+	column_code.assign(nx, EC_DT_SUCCESS);
+	int row_first = 0, row_last = -1;
+	std::vector <int> column_first(nx, 0), column_last(nx, -1);
+
+	ThreadPool pool(thread_count);
+	pool.submit([&](int)
+	{
+		DynamicTopography dyn_tpg(field);
+		dyn_tpg.set_options(options);
+		dyn_tpg.set_dcs_origin(spec.geo_ref);
+		row_code = take_path(dyn_tpg, spec, node(0, ref_j), node(nx - 1, ref_j), nx - 1, row, row_first, row_last);
+	});
+	for (int t = 0; t < nx; t += MAP_TILE_COLUMNS)
+		pool.submit([&, t](int)
+		{
+			DynamicTopography dyn_tpg(field);
+			dyn_tpg.set_options(options);
+			dyn_tpg.set_dcs_origin(spec.geo_ref);
+			for (int i = t; i < std::min(nx, t + MAP_TILE_COLUMNS); ++i)
+				column_code[i] = take_path(dyn_tpg, spec, node(i, 0), node(i, ny - 1), ny - 1, column[i], 
+										   column_first[i], column_last[i]);
+		});
+	pool.wait();
+
+	if (row_code != EC_DT_SUCCESS)
+		std::cerr << "Error: DT taking (map reference row): " << row_code << std::endl;
+	for (int i = 0; i < nx; ++i)
+		if (column_code[i] != EC_DT_SUCCESS)
+			std::cerr << "Error: DT taking (map column " << i + 1 << "): " << column_code[i] << std::endl;
+
+	// узел (i, j): по строке от опорной точки до столбца i, затем по столбцу i; оба конца каждого
+	// участка пути - в пределах крайних проекций его коридора (без экстраполяции)
+	size_t valid = 0;
+	for (int j = 0; j < ny; ++j)
+		for (int i = 0; i < nx; ++i)
+		{
+			bool on_row = (i == ref_i || (row_code == EC_DT_SUCCESS && 
+						   in_range(i, row_first, row_last) && in_range(ref_i, row_first, row_last)));
+			bool on_column = (j == ref_j || (column_code[i] == EC_DT_SUCCESS && 
+							  in_range(j, column_first[i], column_last[i]) && 
+							  in_range(ref_j, column_first[i], column_last[i])));
+			double &v = value[(size_t)j * nx + i];
+			if (!(on_row && on_column))
+			{
+				v = MAP_NODATA;
+				continue;
+			}
+			v = 0.0;
+			if (i != ref_i) v += row[i] - row[ref_i];
+			if (j != ref_j) v += column[i][j] - column[i][ref_j];
+			++valid;
+		}
+	return valid;
+}
+
+int DTMap::failed_paths() const
+{
+	int failed = (row_code != EC_DT_SUCCESS) ? 1 : 0;
+	for (size_t i = 0; i < column_code.size(); ++i)
+		if (column_code[i] != EC_DT_SUCCESS) ++failed;
+	return failed;
+}
+
+int DTMap::write(const char *file_name) const
+{
+	if (!little_endian())
+	{
+		std::cerr << "Error: binary map files are little-endian only\n";
+		return EC_MAP_FORMAT;
+	}
+
+	std::ofstream out(file_name, std::ios::binary);
+	if (!out)
+	{
+		std::cerr << "Error: can not create " << file_name << "\n";
+		return EC_MAP_OPEN;
+	}
+
+	map_file_header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, MAP_MAGIC, sizeof(MAP_MAGIC));
+	h.version = MAP_VERSION;
+	h.byte_order = FF_BYTE_ORDER;
+	h.nx = nx, h.ny = ny;
+	h.ref_x = spec.geo_ref.x, h.ref_y = spec.geo_ref.y;
+	point p0 = node(0, 0);
+	h.x0 = p0.x, h.y0 = p0.y;
+	h.spacing = spec.spacing;
+	h.nodata = MAP_NODATA;
+
+	out.write((const char *)&h, sizeof(h));
+	out.write((const char *)value.data(), value.size() * sizeof(double));
+	if (!out)
+	{
+		std::cerr << "Error: can not write " << file_name << "\n";
+		return EC_MAP_OPEN;
+	}
+	return EC_MAP_SUCCESS;
+}
+
+int DTMap::read(const char *file_name)
+{
+	std::ifstream in(file_name, std::ios::binary);
+	if (!in)
+	{
+		std::cerr << "Error: can not open " << file_name << "\n";
+		return EC_MAP_OPEN;
+	}
+
+	map_file_header h;
+	in.read((char *)&h, sizeof(h));
+	if (!in || memcmp(h.magic, MAP_MAGIC, sizeof(MAP_MAGIC)) != 0 || h.version != MAP_VERSION ||
+		h.byte_order != FF_BYTE_ORDER || !(h.spacing > 0.0) || (uint64_t)h.nx * h.ny > MAP_MAX_NODES)
+	{
+		std::cerr << "Error: " << file_name << " is not a DT map file\n";
+		return EC_MAP_FORMAT;
+	}
+
+	std::vector <double> v((size_t)h.nx * h.ny);
+	in.read((char *)v.data(), v.size() * sizeof(double));
+	if (!in)
+	{
+		std::cerr << "Error: " << file_name << " is truncated\n";
+		return EC_MAP_FORMAT;
+	}
+
+	spec = map_spec();
+	spec.geo_ref = point(h.ref_x, h.ref_y);
+	spec.spacing = h.spacing;
+	ix0 = (int)lround(h.x0 / h.spacing), iy0 = (int)lround(h.y0 / h.spacing);
+	nx = h.nx, ny = h.ny;
+	value.swap(v);
+	row_code = EC_DT_SUCCESS;
+	column_code.clear();
+	return EC_MAP_SUCCESS;
+}
+
+int DTMap::write_ascii(const char *file_name) const
+{
+	TextWriter out;
+	if (!out.open(file_name))
+	{
+		std::cerr << "Error: can not create " << file_name << "\n";
+		return EC_MAP_OPEN;
+	}
+
+	point p0 = node(0, 0);
+	out << "ncols " << nx << "\nnrows " << ny << "\nxllcenter " << p0.x << "\nyllcenter " << p0.y
+		<< "\ncellsize " << spec.spacing << "\nNODATA_value " << MAP_NODATA << '\n';
+	for (int j = ny - 1; j >= 0; --j)
+		for (int i = 0; i < nx; ++i)
+			out << at(i, j) << ((i + 1 < nx) ? ' ' : '\n');
+	out.close();
+	return EC_MAP_SUCCESS;
+}
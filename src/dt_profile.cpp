@@ -0,0 +1,130 @@
+#include "dt_profile.h"
+
+#include "text_io.h"
+
+#include <iostream>
+
+const char *profile_phase_name(E_PROFILE_PHASE phase)
+{
+	switch (phase)
+	{
+		case EPP_READ: return "read";
+		case EPP_TRANSFORM: return "transform";
+		case EPP_CORRIDOR: return "corridor";
+		case EPP_SETUP: return "interpolation_setup";
+		case EPP_FIRST_PASS: return "first_pass";
+		case EPP_ACCURACY: return "loo_accuracy";
+		case EPP_SECOND_PASS: return "second_pass";
+		case EPP_OUTPUT: return "output";
+		default: return "unknown";
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ---------------------------- cut_profile struct ---------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+cut_profile::cut_profile() : code(0), corridor(0), steps(0), neighbours(0), active(EPP_COUNT)
+{
+	for (int i = 0; i < EPP_COUNT; ++i)
+		seconds[i] = 0.0;
+}
+
+void cut_profile::charge(std::chrono::steady_clock::time_point now)
+{
+	if (active != EPP_COUNT)
+		seconds[active] += std::chrono::duration <double>(now - since).count();
+	since = now;
+}
+
+E_PROFILE_PHASE cut_profile::enter(E_PROFILE_PHASE phase)
+{
+	charge(std::chrono::steady_clock::now());
+	E_PROFILE_PHASE outer = active;
+	active = phase;
+	return outer;
+}
+
+void cut_profile::leave(E_PROFILE_PHASE outer)
+{
+	charge(std::chrono::steady_clock::now());
+	active = outer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ------------------------------ Profiler class -----------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+Profiler::Profiler() : started(std::chrono::steady_clock::now())
+{
+
+}
+
+void Profiler::set_cut_count(size_t count)
+{
+	cuts.assign(count, cut_profile());
+}
+
+cut_profile *Profiler::run()
+{
+	return &run_profile;
+}
+
+cut_profile *Profiler::cut(size_t i)
+{
+	return &cuts[i];
+}
+
+static void write_phases(TextWriter &out, const double *seconds)
+{
+	out << '{';
+	for (int i = 0; i < EPP_COUNT; ++i)
+		out << (i > 0 ? ", \"" : "\"") << profile_phase_name((E_PROFILE_PHASE)i) << "\": " << seconds[i];
+	out << '}';
+}
+
+static void write_counters(TextWriter &out, const cut_profile &p)
+{
+	out << "\"corridor\": " << p.corridor << ", \"steps\": " << p.steps << ", \"neighbours\": " << p.neighbours;
+}
+
+bool Profiler::write(const char *file_name, int thread_count)
+{
+	double wall = std::chrono::duration <double>(std::chrono::steady_clock::now() - started).count();
+
+	// итоги: этапы запуска плюс суммы по разрезам (при нескольких потоках сумма больше wall)
+	cut_profile total = run_profile;
+	for (size_t i = 0; i < cuts.size(); ++i)
+	{
+		for (int k = 0; k < EPP_COUNT; ++k)
+			total.seconds[k] += cuts[i].seconds[k];
+		total.corridor += cuts[i].corridor;
+		total.steps += cuts[i].steps;
+		total.neighbours += cuts[i].neighbours;
+	}
+
+	TextWriter out;
+	if (!out.open(file_name))
+	{
+		std::cerr << "Error: can not create " << file_name << "\n";
+		return false;
+	}
+
+	out << "{\n  \"wall_seconds\": " << wall << ",\n  \"threads\": " << thread_count
+		<< ",\n  \"cuts\": " << cuts.size() << ",\n  \"total\": {\"seconds\": ";
+	write_phases(out, total.seconds);
+	out << ", ";
+	write_counters(out, total);
+	out << "},\n  \"per_cut\": [\n";
+	for (size_t i = 0; i < cuts.size(); ++i)
+	{
+		out << "    {\"cut\": " << i + 1 << ", \"code\": " << cuts[i].code << ", ";
+		write_counters(out, cuts[i]);
+		out << ", \"seconds\": ";
+		write_phases(out, cuts[i].seconds);
+		out << '}' << (i + 1 < cuts.size() ? ",\n" : "\n");
+	}
+	out << "  ]\n}\n";
+	out.close();
+	return true;
+}
@@ -0,0 +1,362 @@
+#include "dt_server.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+DTServer::DTServer(const point &orn, const dt_options &opt, int thread_count) :
+	origin(orn), options(opt), pool(thread_count), stopping(false)
+{
+	wake_fd[0] = wake_fd[1] = -1;
+}
+
+DTServer::~DTServer()
+{
+	pool.wait();
+}
+
+int DTServer::load(const char *file_name)
+{
+	std::shared_ptr <const DTField> f;
+	int ce = DTField::load(file_name, origin, f);
+	if (ce != EC_CORE_SUCCESS)
+		return ce;
+
+	std::lock_guard <std::mutex> lock(field_mtx);
+	field = f;
+	return EC_SRV_SUCCESS;
+}
+
+std::shared_ptr <const DTField> DTServer::current_field()
+{
+	std::lock_guard <std::mutex> lock(field_mtx);
+	return field;
+}
+
+static bool is_command(const char *&p, const char *last, const char *cmd)
+{
+	size_t len = strlen(cmd);
+	while (p < last && (*p == ' ' || *p == '\t')) ++p;
+	if ((size_t)(last - p) < len || memcmp(p, cmd, len) != 0 || (p + len < last && p[len] != ' ' && p[len] != '\t'))
+		return false;
+	p += len;
+	return true;
+}
+
+bool DTServer::answer(const char *first, const char *last, TextWriter &reply)
+{
+	const char *p = first;
+	while (last > p && (*(last - 1) == '\r' || *(last - 1) == ' ')) --last;
+
+	if (is_command(p, last, "CUT"))
+	{
+		scut cut;
+		if (!parse_cut(p, last, cut))
+		{
+			reply << "ERR " << EC_SRV_REQUEST << '\n';
+			return true;
+		}
+		std::shared_ptr <const DTField> f = current_field();
+		if (!f)
+		{
+			reply << "ERR " << EC_SRV_FIELD << '\n';
+			return true;
+		}
+
+		dt_result dt_res;
+		int ce = f->compute(cut, options, dt_res);
+		if (ce == EC_DT_SUCCESS)
+		{
+			reply << "OK ";
+			dt_res.print_to(reply);
+		}
+		else
+			reply << "ERR " << ce << '\n';
+		return true;
+	}
+	if (is_command(p, last, "RELOAD"))
+	{
+		while (p < last && (*p == ' ' || *p == '\t')) ++p;
+		std::string file_name(p, last);
+		int ce = file_name.empty() ? EC_SRV_REQUEST : load(file_name.c_str());
+		if (ce == EC_SRV_SUCCESS)
+			reply << "OK " << current_field()->size() << '\n';
+		else
+			reply << "ERR " << ce << '\n';
+		return true;
+	}
+	if (is_command(p, last, "QUIT"))
+		return false;
+	if (is_command(p, last, "STOP"))
+	{
+		stopping = true;
+		reply << "OK\n";
+		return false;
+	}
+
+	if (!is_blank(first, last))
+		reply << "ERR " << EC_SRV_REQUEST << '\n';
+	return true;
+}
+
+#ifdef _WIN32
+
+int DTServer::run(const char *socket_path)
+{
+	std::cerr << "Error: the server mode is not supported on this system\n";
+	return EC_SRV_SOCKET;
+}
+
+#else
+
+static void set_nonblocking(int fd, bool on)
+{
+	int flags = fcntl(fd, F_GETFL, 0);
+	fcntl(fd, F_SETFL, on ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+}
+
+// один recv на событие опроса
+void DTServer::receive(connection &c)
+{
+	if (c.used == c.in.size())
+	{
+		// все полные строки разобраны: буфер занят одной строкой
+		if (c.in.size() >= SRV_MAX_LINE)
+		{
+			c.broken = true;
+			return;
+		}
+		c.in.resize(c.in.size() * 2);
+	}
+	ssize_t n = recv(c.fd, c.in.data() + c.used, c.in.size() - c.used, 0);
+	if (n > 0)
+		c.used += n;
+	else if (n == 0)
+		c.eof = true;
+	else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+		c.broken = true;
+}
+
+// Строки разбираются по порядку: CUT и RELOAD считаются пулом потоков, остальные - сразу.
+// После RELOAD разбор ждёт его завершения, чтобы следующие разрезы считались по новому полю.
+// После конца передачи незавершённый остаток - последняя строка запроса
+void DTServer::parse_lines(connection &c)
+{
+	size_t begin = 0;
+	while (c.reading && !c.reload && c.replies.size() < SRV_MAX_PENDING && begin < c.used)
+	{
+		const char *first = c.in.data() + begin, *p = first;
+		const char *nl = (const char *)memchr(first, '\n', c.used - begin);
+		if (nl == NULL && !c.eof) break;
+		if (nl == NULL)
+			nl = c.in.data() + c.used, begin = c.used;
+		else
+			begin = nl + 1 - c.in.data();
+
+		std::shared_ptr <reply_slot> slot = std::make_shared <reply_slot>();
+		c.replies.push_back(slot);
+		bool reload = is_command(p, nl, "RELOAD");
+		p = first;
+		if (reload || is_command(p, nl, "CUT"))
+		{
+			if (reload) c.reload = slot;
+			std::string line(first, nl);
+			pool.submit([this, slot, line](int)
+			{
+				TextWriter reply;
+				reply.open_memory();
+				answer(line.data(), line.data() + line.size(), reply);
+				reply.release(slot->text);
+				slot->done = true;
+
+				// канал полон - цикл опроса уже разбужен
+				char b = 1;
+				if (write(wake_fd[1], &b, 1) < 0) {}
+			});
+			continue;
+		}
+
+		TextWriter reply;
+		reply.open_memory();
+		c.reading = answer(first, nl, reply);
+		reply.release(slot->text);
+		slot->done = true;
+	}
+	memmove(c.in.data(), c.in.data() + begin, c.used - begin);
+	c.used -= begin;
+}
+
+// готовые ответы с начала очереди - в буфер отправки
+void DTServer::collect_replies(connection &c)
+{
+	if (c.reload && c.reload->done)
+		c.reload.reset();
+	while (!c.replies.empty() && c.replies.front()->done)
+	{
+		const std::vector <char> &text = c.replies.front()->text;
+		c.out.insert(c.out.end(), text.begin(), text.end());
+		c.replies.pop_front();
+	}
+}
+
+// отправка без блокировки; false, если клиент отключился
+bool DTServer::flush(connection &c)
+{
+	while (c.sent < c.out.size())
+	{
+		ssize_t n = send(c.fd, c.out.data() + c.sent, c.out.size() - c.sent, MSG_NOSIGNAL);
+		if (n > 0)
+		{
+			c.sent += n;
+			continue;
+		}
+		if (n < 0 && errno == EINTR) continue;
+		return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+	}
+	c.out.clear();
+	c.sent = 0;
+	return true;
+}
+
+int DTServer::run(const char *socket_path)
+{
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(socket_path) >= sizeof(addr.sun_path))
+	{
+		std::cerr << "Error: socket path " << socket_path << " is too long\n";
+		return EC_SRV_SOCKET;
+	}
+	strcpy(addr.sun_path, socket_path);
+
+	int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(socket_path);
+	if (listen_fd < 0 || bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, SOMAXCONN) != 0 ||
+		pipe(wake_fd) != 0)
+	{
+		std::cerr << "Error: can not listen on " << socket_path << "\n";
+		if (listen_fd >= 0) close(listen_fd);
+		return EC_SRV_SOCKET;
+	}
+	set_nonblocking(listen_fd, true);
+	set_nonblocking(wake_fd[0], true);
+	set_nonblocking(wake_fd[1], true);
+
+	std::vector <std::unique_ptr <connection> > conn;
+	std::vector <pollfd> fds;
+	while (!stopping)
+	{
+		// приём соединений, канал пробуждения и соединения: чтение, пока не ждут RELOAD и очередь
+		// ответов не заполнена, запись - при неотправленных ответах
+		fds.clear();
+		fds.push_back({listen_fd, POLLIN, 0});
+		fds.push_back({wake_fd[0], POLLIN, 0});
+		for (size_t k = 0; k < conn.size(); ++k)
+		{
+			const connection &c = *conn[k];
+			short events = 0;
+			if (c.reading && !c.eof && !c.reload && c.replies.size() < SRV_MAX_PENDING) events |= POLLIN;
+			if (c.sent < c.out.size()) events |= POLLOUT;
+			fds.push_back({c.fd, events, 0});
+		}
+		if (poll(fds.data(), fds.size(), -1) < 0)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		if (fds[1].revents & POLLIN)
+		{
+			char buffer[256];
+			while (read(wake_fd[0], buffer, sizeof(buffer)) > 0) ;
+		}
+
+		// новые соединения опрашиваются со следующего прохода
+		size_t polled = conn.size();
+		if (fds[0].revents & POLLIN)
+		{
+			int fd;
+			while ((fd = accept(listen_fd, NULL, NULL)) >= 0)
+			{
+				set_nonblocking(fd, true);
+				conn.push_back(std::unique_ptr <connection>(new connection(fd)));
+			}
+		}
+
+		for (size_t k = 0; k < polled; ++k)
+		{
+			connection &c = *conn[k];
+			short revents = fds[k + 2].revents;
+			if (revents & POLLIN)
+				receive(c);
+			else if (revents & (POLLERR | POLLHUP))
+				c.broken = true;
+
+			// готовые ответы освобождают очередь и ожидание RELOAD до разбора следующих строк
+			if (!c.broken)
+			{
+				collect_replies(c);
+				parse_lines(c);
+				collect_replies(c);
+				if (!flush(c)) c.broken = true;
+			}
+		}
+
+		// закрываются оборванные соединения, а после QUIT или конца передачи - когда все строки
+		// разобраны (очередь ответов пуста) и ответы отправлены
+		size_t kept = 0;
+		for (size_t k = 0; k < conn.size(); ++k)
+		{
+			connection &c = *conn[k];
+			if (c.broken || ((!c.reading || c.eof) && c.replies.empty() && c.sent == c.out.size()))
+				close(c.fd);
+			else
+				conn[kept++].swap(conn[k]);
+		}
+		conn.resize(kept);
+	}
+
+	// STOP: новые запросы не читаются, идущие расчёты дорабатывают и их ответы отправляются
+	// без блокировки не дольше SRV_STOP_TIMEOUT - клиент, не читающий ответы, не держит остановку
+	pool.wait();
+	std::chrono::steady_clock::time_point deadline = 
+		std::chrono::steady_clock::now() + std::chrono::milliseconds(SRV_STOP_TIMEOUT);
+	while (true)
+	{
+		fds.clear();
+		for (size_t k = 0; k < conn.size(); ++k)
+		{
+			connection &c = *conn[k];
+			collect_replies(c);
+			if (!c.broken && !flush(c)) c.broken = true;
+			if (!c.broken && c.sent < c.out.size()) fds.push_back({c.fd, POLLOUT, 0});
+		}
+		long long left = std::chrono::duration_cast <std::chrono::milliseconds>(
+			deadline - std::chrono::steady_clock::now()).count();
+		if (fds.empty() || left <= 0) break;
+		if (poll(fds.data(), fds.size(), (int)left) < 0 && errno != EINTR) break;
+	}
+	for (size_t k = 0; k < conn.size(); ++k)
+		close(conn[k]->fd);
+
+	close(listen_fd);
+	close(wake_fd[0]);
+	close(wake_fd[1]);
+	wake_fd[0] = wake_fd[1] = -1;
+	unlink(socket_path);
+	return EC_SRV_SUCCESS;
+}
+
+#endif
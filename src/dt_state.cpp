@@ -0,0 +1,237 @@
+#include "dt_state.h"
+#include "field_store.h"
+#include "geo_transform.h"
+#include "text_io.h"
+#include "thread_pool.h"
+
+#include <charconv>
+#include <fstream>
+#include <iostream>
+
+#define FNV_OFFSET 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+
+uint64_t file_hash(const char *file_name)
+{
+	std::ifstream in(file_name, std::ios::binary);
+	if (!in) return 0;
+
+	uint64_t hash = FNV_OFFSET;
+	std::vector <char> buffer(TIO_BLOCK_SIZE);
+	while (in)
+	{
+		in.read(buffer.data(), buffer.size());
+		for (std::streamsize i = 0; i < in.gcount(); ++i)
+			hash = (hash ^ (unsigned char)buffer[i]) * FNV_PRIME;
+	}
+	return hash;
+}
+
+std::string run_options(const dt_options &options, size_t memory_budget)
+{
+	// кратчайшая запись, читаемая в тот же double
+	char tol[32];
+	*std::to_chars(tol, tol + sizeof(tol) - 1, options.itg_tolerance).ptr = '\0';
+
+	std::string s = std::string("a=") + tol;
+	s += (options.precision == EPR_FAST) ? " p=fast" : " p=exact";
+	s += options.coriolis_table ? " o=table" : " o=direct";
+	s += options.curvature_table ? " k=table" : " k=direct";
+	s += " m=" + std::to_string(memory_budget);
+	return s;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ------------------------------- RunState class ----------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+RunState::RunState() : cuts_hash(0), field_count(0) {}
+
+void RunState::reset(uint64_t hash, const std::string &opts, size_t cut_count)
+{
+	cuts_hash = hash;
+	options = opts;
+	code.assign(cut_count, EC_DT_FVF_EMPTY);
+	line.assign(cut_count, std::string());
+}
+
+uint64_t RunState::cut_list_hash() const
+{
+	return cuts_hash;
+}
+
+const std::string &RunState::run_options() const
+{
+	return options;
+}
+
+size_t RunState::cut_count() const
+{
+	return code.size();
+}
+
+size_t RunState::field_size() const
+{
+	return field_count;
+}
+
+void RunState::set_field_size(size_t count)
+{
+	field_count = count;
+}
+
+void RunState::set(size_t i, int ce, dt_result &res)
+{
+	code[i] = ce;
+	line[i].clear();
+	if (ce != EC_DT_SUCCESS) return;
+
+	TextWriter out;
+	out.open_memory();
+	res.print_to(out);
+	std::vector <char> text;
+	out.release(text);
+	line[i].assign(text.begin(), text.end());
+}
+
+int RunState::result_code(size_t i) const
+{
+	return code[i];
+}
+
+const std::string &RunState::result(size_t i) const
+{
+	return line[i];
+}
+
+int RunState::read(const char *file_name)
+{
+	TextReader in(file_name);
+	if (!in.is_open())
+	{
+		std::cerr << "Error: can not open " << file_name << "\n";
+		return EC_DS_OPEN;
+	}
+
+	const char *p, *last;
+	double hash_hi, hash_lo;
+	int version, cut_count;
+	double vector_count;
+	size_t magic_length = sizeof(DS_MAGIC) - 1;
+	bool header = in.next_line(p, last) && (size_t)(last - p) >= magic_length && 
+				  std::string(p, magic_length) == DS_MAGIC;
+	if (header)
+	{
+		p += magic_length;
+		header = parse_number(p, last, version) && version == DS_VERSION && parse_number(p, last, hash_hi) && 
+				 parse_number(p, last, hash_lo) && parse_number(p, last, cut_count) && cut_count >= 0 &&
+				 parse_number(p, last, vector_count);
+	}
+	if (!header)
+	{
+		std::cerr << "Error: " << file_name << " is not a run state file\n";
+		return EC_DS_FORMAT;
+	}
+
+	// остаток строки - параметры расчёта
+	while (p < last && *p == ' ') ++p;
+	while (last > p && (*(last - 1) == ' ' || *(last - 1) == '\r')) --last;
+
+	// хэш - две 32-битные половины, точно представимые double
+	reset(((uint64_t)hash_hi << 32) | (uint64_t)hash_lo, std::string(p, last), cut_count);
+	field_count = (size_t)vector_count;
+	for (int i = 0; i < cut_count; ++i)
+	{
+		if (!in.next_line(p, last) || !parse_number(p, last, code[i]))
+		{
+			std::cerr << "Error: " << file_name << " is truncated\n";
+			return EC_DS_FORMAT;
+		}
+		if (code[i] == EC_DT_SUCCESS)
+		{
+			if (p < last && *p == ' ') ++p;
+			line[i].assign(p, last);
+			line[i] += '\n';
+		}
+	}
+	return EC_DS_SUCCESS;
+}
+
+int RunState::write(const char *file_name) const
+{
+	TextWriter out;
+	if (!out.open(file_name))
+	{
+		std::cerr << "Error: can not create " << file_name << "\n";
+		return EC_DS_OPEN;
+	}
+
+	out << DS_MAGIC << ' ' << DS_VERSION << ' ' << (size_t)(cuts_hash >> 32) << ' '
+		<< (size_t)(cuts_hash & 0xffffffffu) << ' ' << (int)code.size() << ' ' << field_count << ' ' 
+		<< options.c_str() << '\n';
+	for (size_t i = 0; i < code.size(); ++i)
+	{
+		out << code[i];
+		if (code[i] == EC_DT_SUCCESS)
+			out << ' ' << line[i].c_str();
+		else
+			out << '\n';
+	}
+	out.close();
+	return EC_DS_SUCCESS;
+}
+
+void count_affected(const std::vector <scut> &cut, std::vector <movement> &delta, std::vector <int> &count)
+{
+	count.assign(cut.size(), 0);
+	if (delta.size() == 0) return;
+
+	FieldStore changed(delta);
+	std::vector <int> idx;
+	for (size_t i = 0; i < cut.size(); ++i)
+	{
+		// ширина по умолчанию - как в DynamicTopography::set_cut
+		scut c = cut[i];
+		if (c.width == -1) c.width = CUT_WIDTH;
+		count[i] = changed.select(c, idx);
+	}
+}
+
+size_t update_results(const DTField &field, const std::vector <scut> &cut, const std::vector <movement> &added,
+					  const std::vector <movement> &removed, const dt_options &options, int thread_count, 
+					  bool all, RunState &state)
+{
+	std::vector <int> affected(cut.size(), 1);
+	if (!all)
+	{
+		// изменение и разрезы - в локальной СК поля, как в to_cartesian_cs
+		const point &origin = field.origin();
+		std::vector <movement> delta(added);
+		delta.insert(delta.end(), removed.begin(), removed.end());
+		to_dec_cs(delta, origin);
+		std::vector <scut> local(cut);
+		for (size_t i = 0; i < local.size(); ++i)
+		{
+			local[i].start.to_dec_cs(origin);
+			local[i].end.to_dec_cs(origin);
+		}
+		count_affected(local, delta, affected);
+	}
+
+	size_t computed = 0;
+	ThreadPool pool(thread_count);
+	for (size_t i = 0; i < cut.size(); ++i)
+	{
+		if (affected[i] == 0) continue;
+		++computed;
+		pool.submit([&, i](int)
+		{
+			dt_result res;
+			int ce = field.compute(cut[i], options, res);
+			state.set(i, ce, res);
+		});
+	}
+	pool.wait();
+	state.set_field_size(field.size());
+	return computed;
+}
@@ -1,13 +1,14 @@
 #include "dynamic_topography.h"
+#include "corridor_filter.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // --------------------------- dt_result struct ------------------------------//
 ////////////////////////////////////////////////////////////////////////////////
 
-dt_result::dt_result() : dt_error(-1.0), a_priori_error(-1.0)
+dt_result::dt_result() : dt_error(-1.0), a_priori_error(-1.0), cr_coef(0.0)
 {}
 
-void dt_result::set(scut _cut, int vc) 
+void dt_result::set(const scut &_cut, int vc) 
 {
 	cut = _cut;
 	vector_count = vc;
@@ -21,13 +22,16 @@ void dt_result::calc_dt(double latitude)
 	dt = (itg_res.sqr_value + itg_res.lin_value) / G;
 }
 
-void dt_result::print_to(std::ofstream &file)
+void dt_result::print_to(TextWriter &file)
 {
-	file << cut.start.x << " " << cut.start.y << " " << cut.end.x << " " << cut.end.y << " " << dt << " " 
-		 << cut.width << " " << itg_res.itp_diameter << " " << itg_res.weight_coef * 1000 << " " << 
-		dt_error << " " << itg_res.interpolation_accuracy << " " << itg_res.integration_error << " " 
-		<< itg_res.ms_deviation << " " << a_priori_error << " " << cut_length << " " << cr_coef << " " 
-		<< KM2M(itg_res.step_size) << " " << itg_res.step_count << " " << vector_count << std::endl;
+	file << cut.start.x << ' ' << cut.start.y << ' ' << cut.end.x << ' ' << cut.end.y << ' ' << dt << ' ' 
+		 << cut.width << ' ' << itg_res.itp_diameter << ' ' << itg_res.weight_coef * 1000 << ' ' << 
+		dt_error << ' ' << itg_res.interpolation_accuracy << ' ' << itg_res.integration_error << ' ' 
+		<< itg_res.ms_deviation << ' ' << a_priori_error << ' ' << cut_length << ' ' << cr_coef << ' ' 
+		<< KM2M(itg_res.step_size) << ' ' << itg_res.step_count << ' ' << vector_count;
+	if (itg_res.refinement_level >= 0)
+		file << ' ' << itg_res.refinement_level;
+	file << '\n';
 }
 
 std::string get_NV_filename(int ind)
@@ -44,21 +48,60 @@ std::string get_AV_filename(int ind)
 	return std::string(str);
 }
 
+// Перевод допуска адаптивного интегрирования (в единицах dt_error) в допуск по lin_value: 
+// наибольший |f| / G из начала СК (по нему считается dt_error) и концов разреза (вдоль прямой
+// разреза широта линейна, |f| растёт с |широтой|). 0 - f = 0 и в начале СК, и на всём разрезе
+static double tolerance_coef(const scut &c, const point &origin)
+{
+	double f = std::max(fabs(coriolis_koef(origin.y)), std::max(fabs(coriolis_koef(latitude_at(c.start, origin))), 
+																 fabs(coriolis_koef(latitude_at(c.end, origin)))));
+	return f / G;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // ----------------------- DynamicTopography class ---------------------------//
 ////////////////////////////////////////////////////////////////////////////////
 
-DynamicTopography::DynamicTopography(std::vector <movement> &m) : mvn(m)
+DynamicTopography::DynamicTopography(const FieldStore &f) : field(f), diag(NULL), file_index(0), cut_log(true), 
+	profile(NULL)
 {
 
 }
 
+void DynamicTopography::set_options(const dt_options &opt)
+{
+	options = opt;
+}
+
+void DynamicTopography::set_diag_writer(DiagWriter *dw)
+{
+	diag = dw;
+}
+
+void DynamicTopography::submit_logs(Integral *integral)
+{
+	if (fNV.is_open()) 
+		diag->submit(get_NV_filename(file_index), fNV);
+	if (integral != NULL && integral->print_log().is_open()) 
+		diag->submit(get_AV_filename(file_index), integral->print_log());
+	if (fNVdec.is_open())
+	{
+		diag->submit("NVdec.txt", fNVdec);
+		diag->submit("NVgeo.txt", fNVgeo);
+	}
+}
+
 void DynamicTopography::set_file_index(int index)
 {
 	file_index = index;
 }
 
-void DynamicTopography::set_cut(scut c)
+void DynamicTopography::set_cut_log(bool on)
+{
+	cut_log = on;
+}
+
+void DynamicTopography::set_cut(const scut &c)
 {
 	cut = c;
 	if (cut.width == -1) cut.width = CUT_WIDTH;
@@ -69,9 +112,35 @@ void DynamicTopography::set_dcs_origin(const point &dcs_orn)
 	dcs_origin = dcs_orn;
 }
 
+void DynamicTopography::set_profile(cut_profile *p)
+{
+	profile = p;
+}
+
 int DynamicTopography::take(struct dt_result &dt_res)
 {
-	fNV.open(get_NV_filename(file_index).c_str());
+	// уровень full - файлы NV и AV каждого разреза, summary - только NVdec и NVgeo
+	bool nv_log = (diag != NULL && options.diag_level == EDL_FULL);
+	bool dec_log = (diag != NULL && options.diag_level != EDL_NONE && cut_log);
+
+	// коридор разреза по сетке поля; разрезы с малым числом векторов отбрасываются сразу, если
+	// их диагностика не пишется, иначе - после записи векторов коридора в NV, NVdec и NVgeo
+	ProfileTimer corridor_timer(profile, EPP_CORRIDOR);
+	std::vector <int> crd;
+	int crd_count = field.select(cut, crd);
+
+	if (crd_count == 0 && !nv_log && !dec_log)
+	{
+		std::cerr << "Desired flow velocity vectors near the cut are not found\n";
+		return EC_DT_FVF_EMPTY;
+	}
+	if (crd_count < MIN_POINT_COUNT && !nv_log && !dec_log)
+	{
+		std::cerr << "Error: not enough data to calculate the integral\n";
+		return EC_ITG_NOT_ENOUGH_DATA;
+	}
+
+	if (nv_log) fNV.open_memory();
 	std::vector <wvector> wv;
 
 	Line cut_line(cut.v());
@@ -82,98 +151,346 @@ int DynamicTopography::take(struct dt_result &dt_res)
 	double apr_err = 0.0;
 	int apr_err_count = 0;
 
-	std::ofstream fNVdec;
-	fNVdec.open("NVdec.txt");
+	if (dec_log)
+	{
+		fNVdec.open_memory();
+		fNVgeo.open_memory();
+	}
 
-	std::ofstream fNVgeo;
-	fNVgeo.open("NVgeo.txt");
+	for (size_t i = 0; i < crd.size(); ++i)
+	{
+		movement m = field.at(crd[i]);
 
-	for (size_t j = 0; j < mvn.size(); ++j)
-	{						
-		double dist_to_vec = cut_line.distance_to(mvn[j].mv.start);
+		// проекция начала вектора скорости на разрез
+		point prj = cut_line.projection_of(m.mv.start);
 
-		if (fabs(dist_to_vec) < cut.width && mvn[j].velocity > 0)
-		{
-			// проекция начала вектора скорости на разрез
-			point prj = cut_line.projection_of(mvn[j].mv.start);
-			
-			if (cut_line.contains(prj))
-			{
-				// прямая, параллельная разрезу и проходящая через конечную точку вектора скорости
-				Line prl = cut_line.parallel(mvn[j].mv.end);
-				// проекция начала вектора скорости на прямую prl (!) 
-				point norm = prl.projection_of(mvn[j].mv.start);
+		// прямая, параллельная разрезу и проходящая через конечную точку вектора скорости
+		Line prl = cut_line.parallel(m.mv.end);
+		// проекция начала вектора скорости на прямую prl (!) 
+		point norm = prl.projection_of(m.mv.start);
 
-				wv.push_back(wvector(mvn[j], norm, prj));
+		wv.push_back(wvector(crd[i], norm, prj));
 
-				if (prj.distance_to(cut.start) < to_start)
-				{
-					to_start = prj.distance_to(cut.start);
-					start = prj;
-				}
-				if (prj.distance_to(cut.end) < to_end)
-				{
-					to_end = prj.distance_to(cut.end);
-					end = prj;
-				}
+		if (prj.distance_to(cut.start) < to_start)
+		{
+			to_start = prj.distance_to(cut.start);
+			start = prj;
+		}
+		if (prj.distance_to(cut.end) < to_end)
+		{
+			to_end = prj.distance_to(cut.end);
+			end = prj;
+		}
 
-				apr_err += mvn[j].error;
-				++apr_err_count;
+		apr_err += m.error;
+		++apr_err_count;
 
-				fNV << vec(mvn[j].mv.start, norm).at_geo_cs(dcs_origin).toGlanceFormat();
+		if (nv_log)
+			write_glance(fNV, vec(m.mv.start, norm).at_geo_cs(dcs_origin));
 
-				fNVdec << mvn[j].mv.start.x << " " << mvn[j].mv.start.y << " " << 
-								norm.x << " " << norm.y << "\n";
+		if (dec_log)
+		{
+			fNVdec << m.mv.start.x << ' ' << m.mv.start.y << ' ' << 
+							norm.x << ' ' << norm.y << '\n';
 
-				vec v = vec(mvn[j].mv.start, norm).at_geo_cs(dcs_origin);
-				fNVgeo << v.start.x << " " << v.start.y << " " << 
-								v.end.x << " " << v.end.y << "\n";
-			}
+			vec v = vec(m.mv.start, norm).at_geo_cs(dcs_origin);
+			fNVgeo << v.start.x << ' ' << v.start.y << ' ' << 
+							v.end.x << ' ' << v.end.y << '\n';
 		}
 	}
 	cut.start = start, cut.end = end;
+	corridor_timer.stop();
+	if (profile != NULL) profile->corridor = wv.size();
 
-	if (wv.empty())
+	if (wv.size() < MIN_POINT_COUNT)
 	{
-		std::cerr << "Desired flow velocity vectors near the cut are not found\n";
-		return EC_DT_FVF_EMPTY;
+		if (wv.empty())
+			std::cerr << "Desired flow velocity vectors near the cut are not found\n";
+		else
+			std::cerr << "Error: not enough data to calculate the integral\n";
+		submit_logs(NULL);
+		return wv.empty() ? EC_DT_FVF_EMPTY : EC_ITG_NOT_ENOUGH_DATA;
 	}
 
-	Integral integral(cut, wv);
-	integral.set_filename(get_AV_filename(file_index));
+	ProfileTimer setup_timer(profile, EPP_SETUP);
+	Integral integral(cut, wv, field);
+	setup_timer.stop();
+	integral.set_profile(profile);
+	if (nv_log) integral.print_log().open_memory();
 	integral.set_dcs_origin(dcs_origin);
+	integral.set_precision_mode(options.precision);
+	integral.set_coriolis_table(options.coriolis_table);
+	integral.set_curvature_table(options.curvature_table);
 
-	// расчёт интеграла
-	integral.set_partitioning_count(wv.size() * 5);	
-	int itg_code_error = integral.take(dt_res.itg_res);
-	if (itg_code_error != EC_ITG_SUCCESS) 
-		return itg_code_error;
+	double tolerance = (cut.itg_tolerance > 0) ? cut.itg_tolerance : options.itg_tolerance;
+	if (tolerance > 0)
+	{
+		// адаптивное интегрирование: допуск задан в единицах dt_error = K|I(n) - I(2n)|
+		double dt_coef = tolerance_coef(cut, dcs_origin);
+		if (dt_coef == 0.0)
+		{
+			std::cerr << "Error: the integration tolerance is undefined on the equator\n";
+			submit_logs(&integral);
+			return EC_DT_ZERO_CORIOLIS;
+		}
+		struct itg_result itg_res_coarse;
+		ProfileTimer pass_timer(profile, EPP_FIRST_PASS);
+		int itg_code_error = integral.take_adaptive(dt_res.itg_res, itg_res_coarse, tolerance / dt_coef);
+		pass_timer.stop();
+		if (itg_code_error != EC_ITG_SUCCESS) 
+		{
+			submit_logs(&integral);
+			return itg_code_error;
+		}
 
-	// расчет перепада ДТ по результатам интегрирования
-	dt_res.set(cut, wv.size());
-	dt_res.calc_dt(dcs_origin.y);	
-	dt_res.a_priori_error = apr_err / apr_err_count;
-	// расчет ошибки интегрирования
-	integral.set_partitioning_count(wv.size() * 10);
-	struct itg_result itg_res_2;
-	itg_code_error = integral.take(itg_res_2);
-	dt_res.dt_error = fabs(dt_res.itg_res.lin_value - itg_res_2.lin_value) * dt_res.dt_coef;
+		dt_res.set(cut, wv.size());
+		dt_res.calc_dt(dcs_origin.y);	
+		dt_res.a_priori_error = apr_err / apr_err_count;
+		dt_res.dt_error = fabs(dt_res.itg_res.lin_value - itg_res_coarse.lin_value) * dt_res.dt_coef;
+	}
+	else
+	{
+		// расчёт интеграла
+		integral.set_partitioning_count(wv.size() * 5);	
+		ProfileTimer pass_timer(profile, EPP_FIRST_PASS);
+		int itg_code_error = integral.take(dt_res.itg_res);
+		pass_timer.stop();
+		if (itg_code_error != EC_ITG_SUCCESS) 
+		{
+			submit_logs(&integral);
+			return itg_code_error;
+		}
 
-	fNVdec << " " << dt_res.cut.start.x << " " << dt_res.cut.start.y << " " << 
-				dt_res.cut.end.x << " " << dt_res.cut.end.y << "\n";
-	fNVdec.close();
+		// расчет перепада ДТ по результатам интегрирования
+		dt_res.set(cut, wv.size());
+		dt_res.calc_dt(dcs_origin.y);	
+		dt_res.a_priori_error = apr_err / apr_err_count;
+		// расчет ошибки интегрирования
+		integral.set_partitioning_count(wv.size() * 10);
+		struct itg_result itg_res_2;
+		ProfileTimer second_timer(profile, EPP_SECOND_PASS);
+		itg_code_error = integral.take(itg_res_2);
+		second_timer.stop();
+		dt_res.dt_error = fabs(dt_res.itg_res.lin_value - itg_res_2.lin_value) * dt_res.dt_coef;
+	}
+
+	ProfileTimer output_timer(profile, EPP_OUTPUT);
+	fNVdec << ' ' << dt_res.cut.start.x << ' ' << dt_res.cut.start.y << ' ' << 
+				dt_res.cut.end.x << ' ' << dt_res.cut.end.y << '\n';
 
 	dt_res.cut.start.to_geo_cs(dcs_origin);
 	dt_res.cut.end.to_geo_cs(dcs_origin);
 
-	fNVgeo << " " << dt_res.cut.start.x << " " << dt_res.cut.start.y << " " << 
-				dt_res.cut.end.x << " " << dt_res.cut.end.y << "\n";
-	fNVgeo.close();
+	fNVgeo << ' ' << dt_res.cut.start.x << ' ' << dt_res.cut.start.y << ' ' << 
+				dt_res.cut.end.x << ' ' << dt_res.cut.end.y << '\n';
+
+	if (nv_log)
+		write_glance(fNV, dt_res.cut.v()); // рисуем разрез вектором
 
-	fNV << dt_res.cut.v().toGlanceFormat(); // рисуем разрез вектором
-	fNV.close();
+	if (diag != NULL)
+		submit_logs(&integral);
 
 
+	return EC_DT_SUCCESS;
+}
+
+void DynamicTopography::sweep(const sweep_grid &grid, std::vector <sweep_result> &res)
+{
+	res.assign(grid.size(), sweep_result(EC_DT_FVF_EMPTY, dt_result()));
+	if (grid.size() == 0) return;
+
+	// ширины как в set_cut; коридор - по наибольшей
+	std::vector <double> width(grid.width.size());
+	scut wide = cut;
+	for (size_t iw = 0; iw < width.size(); ++iw)
+	{
+		width[iw] = (grid.width[iw] == -1) ? CUT_WIDTH : grid.width[iw];
+		wide.width = (iw == 0) ? width[iw] : std::max(wide.width, width[iw]);
+	}
+	std::vector <int> crd;
+	field.select(wide, crd);
+
+	// проекции на разрез, нормали и расстояния до его прямой от ширины не зависят
+	Line cut_line(cut.v());
+	corridor_kernel_args ck(wide);
+	std::vector <wvector> wide_wv;
+	std::vector <double> dist, error;
+	for (size_t i = 0; i < crd.size(); ++i)
+	{
+		movement m = field.at(crd[i]);
+		point prj = cut_line.projection_of(m.mv.start);
+		Line prl = cut_line.parallel(m.mv.end);
+		wide_wv.push_back(wvector(crd[i], prl.projection_of(m.mv.start), prj));
+		dist.push_back(fabs(corridor_distance(ck, m.mv.start.x, m.mv.start.y)));
+		error.push_back(m.error);
+	}
+
+	double tolerance = (cut.itg_tolerance > 0) ? cut.itg_tolerance : options.itg_tolerance;
+	size_t nd = grid.itp_diameter.size(), nk = grid.weight_coef.size();
+
+	for (size_t iw = 0; iw < width.size(); ++iw)
+	{
+		// коридор ширины и укороченный по крайним проекциям разрез - как в take
+		std::vector <wvector> wv;
+		double to_start = cut.v().length(), to_end = cut.v().length();
+		point start = cut.end, end = cut.start;
+		double apr_err = 0.0;
+		int apr_err_count = 0;
+		for (size_t i = 0; i < wide_wv.size(); ++i)
+		{
+			if (!(dist[i] < width[iw])) continue;
+			const point &prj = wide_wv[i].proj;
+			wv.push_back(wide_wv[i]);
+			if (prj.distance_to(cut.start) < to_start)
+			{
+				to_start = prj.distance_to(cut.start);
+				start = prj;
+			}
+			if (prj.distance_to(cut.end) < to_end)
+			{
+				to_end = prj.distance_to(cut.end);
+				end = prj;
+			}
+			apr_err += error[i];
+			++apr_err_count;
+		}
+
+		int code = (wv.size() == 0) ? EC_DT_FVF_EMPTY : 
+				   (wv.size() < MIN_POINT_COUNT) ? EC_ITG_NOT_ENOUGH_DATA : EC_DT_SUCCESS;
+		if (code != EC_DT_SUCCESS)
+		{
+			for (size_t j = grid.index(iw, 0, 0); j < grid.index(iw + 1, 0, 0); ++j)
+				res[j].first = code;
+			continue;
+		}
+
+		scut wcut = cut;
+		wcut.width = width[iw];
+		wcut.start = start, wcut.end = end;
+
+		Integral integral(wcut, wv, field);
+		integral.set_profile(profile);
+		integral.set_dcs_origin(dcs_origin);
+		integral.set_precision_mode(options.precision);
+		integral.set_coriolis_table(options.coriolis_table);
+		integral.set_curvature_table(options.curvature_table);
+
+		// коэффициенты в единицах scut::weight_coef, -1 - по умолчанию
+		std::vector <double> coefs(nk);
+		for (size_t ik = 0; ik < nk; ++ik)
+		{
+			coefs[ik] = grid.weight_coef[ik] / 1000;
+			if (coefs[ik] < 0.0) coefs[ik] = Interpolation::default_weight_coef();
+		}
+
+		for (size_t id = 0; id < nd; ++id)
+		{
+			std::vector <itg_result> first(nk), second(nk);
+			// код каждого коэффициента: адаптивные проходы независимы, общий проход - один код на все
+			std::vector <int> codes(nk);
+			if (tolerance > 0)
+			{
+				double dt_coef = tolerance_coef(wcut, dcs_origin);
+				for (size_t ik = 0; ik < nk; ++ik)
+				{
+					if (dt_coef == 0.0)
+					{
+						codes[ik] = EC_DT_ZERO_CORIOLIS;
+						continue;
+					}
+					integral.set_parameters(grid.itp_diameter[id], coefs[ik]);
+					codes[ik] = integral.take_adaptive(first[ik], second[ik], tolerance / dt_coef);
+				}
+			}
+			else
+			{
+				integral.set_parameters(grid.itp_diameter[id], coefs[0]);
+				integral.set_partitioning_count(wv.size() * 5);
+				code = integral.take(coefs, first);
+				integral.set_partitioning_count(wv.size() * 10);
+				if (code == EC_ITG_SUCCESS)
+					code = integral.take(coefs, second);
+				codes.assign(nk, code);
+			}
+
+			for (size_t ik = 0; ik < nk; ++ik)
+			{
+				sweep_result &r = res[grid.index(iw, id, ik)];
+				r.first = (codes[ik] == EC_ITG_SUCCESS) ? EC_DT_SUCCESS : codes[ik];
+				if (codes[ik] != EC_ITG_SUCCESS) continue;
+
+				dt_result &dt_res = r.second;
+				dt_res.itg_res = first[ik];
+				dt_res.set(wcut, wv.size());
+				dt_res.calc_dt(dcs_origin.y);
+				dt_res.a_priori_error = apr_err / apr_err_count;
+				dt_res.dt_error = fabs(dt_res.itg_res.lin_value - second[ik].lin_value) * dt_res.dt_coef;
+
+				dt_res.cut.start.to_geo_cs(dcs_origin);
+				dt_res.cut.end.to_geo_cs(dcs_origin);
+			}
+		}
+	}
+}
+
+int DynamicTopography::take_profile(int count, std::vector <double> &dt, int &first, int &last)
+{
+	first = 0, last = -1;
+
+	ProfileTimer corridor_timer(profile, EPP_CORRIDOR);
+	std::vector <int> crd;
+	int crd_count = field.select(cut, crd);
+
+	if (crd_count == 0)
+		return EC_DT_FVF_EMPTY;
+	if (crd_count < MIN_POINT_COUNT)
+		return EC_ITG_NOT_ENOUGH_DATA;
+
+	// расстояния крайних проекций от начала разреза
+	double dx = cut.end.x - cut.start.x, dy = cut.end.y - cut.start.y;
+	double length = sqrt(dx * dx + dy * dy);
+	double min_along = HUGE_VAL, max_along = -HUGE_VAL;
+
+	Line cut_line(cut.v());
+	std::vector <wvector> wv;
+	for (size_t i = 0; i < crd.size(); ++i)
+	{
+		movement m = field.at(crd[i]);
+		point prj = cut_line.projection_of(m.mv.start);
+		Line prl = cut_line.parallel(m.mv.end);
+		wv.push_back(wvector(crd[i], prl.projection_of(m.mv.start), prj));
+
+		double along = ((prj.x - cut.start.x) * dx + (prj.y - cut.start.y) * dy) / length;
+		min_along = std::min(min_along, along), max_along = std::max(max_along, along);
+	}
+	corridor_timer.stop();
+
+	// точки разреза с шагом length / count; допуск - на погрешность проекции начала, лежащего в точке
+	first = std::max(0, (int)ceil(min_along / length * count - PROFILE_EPS));
+	last = std::min(count, (int)floor(max_along / length * count + PROFILE_EPS));
+	if (profile != NULL) profile->corridor = wv.size();
+
+	ProfileTimer setup_timer(profile, EPP_SETUP);
+	Integral integral(cut, wv, field);
+	setup_timer.stop();
+	integral.set_profile(profile);
+	integral.set_dcs_origin(dcs_origin);
+	integral.set_precision_mode(options.precision);
+	integral.set_coriolis_table(options.coriolis_table);
+	integral.set_curvature_table(options.curvature_table);
+
+	int per_segment = std::max(1, (int)((wv.size() * 5 + count - 1) / count));
+	std::vector <double> value;
+	ProfileTimer pass_timer(profile, EPP_FIRST_PASS);
+	int itg_code_error = integral.take_profile(count, per_segment, value);
+	pass_timer.stop();
+	if (itg_code_error != EC_ITG_SUCCESS)
+		return itg_code_error;
+
+	// как dt_result::calc_dt
+	dt.resize(value.size());
+	for (size_t k = 0; k < value.size(); ++k)
+		dt[k] = value[k] / G;
 
 	return EC_DT_SUCCESS;
 }
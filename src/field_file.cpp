@@ -0,0 +1,233 @@
+#include "field_file.h"
+#include "field_store.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static bool little_endian()
+{
+	uint32_t v = 1;
+	return *(const char *)&v == 1;
+}
+
+bool is_field_file(const char *file_name)
+{
+	std::ifstream f(file_name, std::ios::binary);
+	char magic[8] = {0};
+	f.read(magic, sizeof(magic));
+	return f && memcmp(magic, FF_MAGIC, sizeof(magic)) == 0;
+}
+
+int write_field_file(const char *file_name, const std::vector <movement> &mvn,
+					 const FieldStore *frame, const point &frame_origin)
+{
+	if (!little_endian())
+	{
+		std::cerr << "Error: binary field files are little-endian only\n";
+		return EC_FF_BYTE_ORDER;
+	}
+
+	std::ofstream out(file_name, std::ios::binary);
+	if (!out)
+	{
+		std::cerr << "Error: can not create " << file_name << "\n";
+		return EC_FF_OPEN;
+	}
+
+	size_t n = mvn.size();
+
+	field_file_header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, FF_MAGIC, sizeof(h.magic));
+	h.version = FF_VERSION;
+	h.byte_order = FF_BYTE_ORDER;
+	h.count = n;
+	h.file_size = sizeof(h) + EFC_COUNT * n * sizeof(double);
+	if (frame != NULL)
+	{
+		h.flags |= FFF_FRAME;
+		h.frame_x = frame_origin.x, h.frame_y = frame_origin.y;
+		h.frame_offset = h.file_size;
+		h.file_size += frame->frame_size();
+	}
+	out.write((const char *)&h, sizeof(h));
+
+	std::vector <double> col(n);
+	for (int c = 0; c < EFC_COUNT; ++c)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			const movement &m = mvn[i];
+			switch (c)
+			{
+				case EFC_X0: col[i] = m.mv.start.x; break;
+				case EFC_Y0: col[i] = m.mv.start.y; break;
+				case EFC_X1: col[i] = m.mv.end.x; break;
+				case EFC_Y1: col[i] = m.mv.end.y; break;
+				case EFC_VELOCITY: col[i] = m.velocity; break;
+				default: col[i] = m.error; break;
+			}
+		}
+		out.write((const char *)col.data(), n * sizeof(double));
+	}
+
+	if (frame != NULL)
+		frame->write_frame(out);
+
+	if (!out)
+	{
+		std::cerr << "Error: writing " << file_name << " failed\n";
+		return EC_FF_OPEN;
+	}
+	return EC_FF_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ----------------------------- FieldFile class -----------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+FieldFile::FieldFile() : data(NULL), size(0)
+{
+	memset(&header, 0, sizeof(header));
+}
+
+FieldFile::~FieldFile()
+{
+	close();
+}
+
+void FieldFile::close()
+{
+#ifdef _WIN32
+	std::vector <char>().swap(buffer);
+#else
+	if (data != NULL) munmap((void *)data, size);
+#endif
+	data = NULL, size = 0;
+}
+
+int FieldFile::open(const char *file_name)
+{
+	close();
+
+#ifdef _WIN32
+	std::ifstream f(file_name, std::ios::binary | std::ios::ate);
+	if (!f)
+	{
+		std::cerr << "Error: can not open " << file_name << "\n";
+		return EC_FF_OPEN;
+	}
+	buffer.resize((size_t)f.tellg());
+	f.seekg(0);
+	f.read(buffer.data(), buffer.size());
+	data = buffer.data(), size = buffer.size();
+#else
+	int fd = ::open(file_name, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		if (fd >= 0) ::close(fd);
+		std::cerr << "Error: can not open " << file_name << "\n";
+		return EC_FF_OPEN;
+	}
+	size = st.st_size;
+	void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED)
+	{
+		size = 0;
+		std::cerr << "Error: can not map " << file_name << "\n";
+		return EC_FF_OPEN;
+	}
+	data = (const char *)p;
+#endif
+
+	if (size < sizeof(header) || memcmp(data, FF_MAGIC, sizeof(header.magic)) != 0)
+	{
+		close();
+		std::cerr << "Error: " << file_name << " is not a binary field file\n";
+		return EC_FF_FORMAT;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	if (header.version < FF_MIN_VERSION || header.version > FF_VERSION)
+	{
+		close();
+		std::cerr << "Error: " << file_name << " has unsupported version " << header.version << "\n";
+		return EC_FF_VERSION;
+	}
+	if (header.byte_order != FF_BYTE_ORDER)
+	{
+		close();
+		std::cerr << "Error: " << file_name << " has a different byte order\n";
+		return EC_FF_BYTE_ORDER;
+	}
+
+	// границы сравниваются делением: произведения с count из повреждённого заголовка переполняются
+	bool columns_ok = header.count <= (size - sizeof(header)) / (EFC_COUNT * sizeof(double));
+	size_t columns_end = columns_ok ? sizeof(header) + EFC_COUNT * header.count * sizeof(double) : size;
+	bool frame_ok = !has_frame() ||
+		(header.frame_offset >= columns_end && header.frame_offset % 8 == 0 && header.frame_offset <= size &&
+		 header.count <= (size - header.frame_offset) / (4 * sizeof(double)));
+	if (header.file_size != size || !columns_ok || !frame_ok)
+	{
+		close();
+		std::cerr << "Error: " << file_name << " is truncated or damaged\n";
+		return EC_FF_FORMAT;
+	}
+
+	return EC_FF_SUCCESS;
+}
+
+size_t FieldFile::count() const
+{
+	return header.count;
+}
+
+const double *FieldFile::column(E_FIELD_COLUMN c) const
+{
+	return (const double *)(data + sizeof(header)) + c * header.count;
+}
+
+bool FieldFile::has_frame() const
+{
+	return (header.flags & FFF_FRAME) != 0 && header.version >= FF_FRAME_VERSION;
+}
+
+point FieldFile::frame_origin() const
+{
+	return point(header.frame_x, header.frame_y);
+}
+
+const double *FieldFile::frame_column(E_FIELD_COLUMN c) const
+{
+	return (const double *)(data + header.frame_offset) + c * header.count;
+}
+
+const char *FieldFile::index_data() const
+{
+	return data + header.frame_offset + 4 * header.count * sizeof(double);
+}
+
+size_t FieldFile::index_size() const
+{
+	return size - (header.frame_offset + 4 * header.count * sizeof(double));
+}
+
+void FieldFile::to_movements(std::vector <movement> &mvn) const
+{
+	const double *x0 = column(EFC_X0), *y0 = column(EFC_Y0), *x1 = column(EFC_X1), *y1 = column(EFC_Y1);
+	const double *velocity = column(EFC_VELOCITY), *error = column(EFC_ERROR);
+
+	mvn.reserve(mvn.size() + count());
+	for (size_t i = 0; i < count(); ++i)
+		mvn.push_back(movement(vec(point(x0[i], y0[i]), point(x1[i], y1[i])), velocity[i], error[i]));
+}
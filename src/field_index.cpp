@@ -0,0 +1,213 @@
+#include "field_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+bool in_cut_corridor(const Line &cut_line, const movement &m, double width)
+{
+	double dist_to_vec = cut_line.distance_to(m.mv.start);
+	if (fabs(dist_to_vec) < width && m.velocity > 0)
+		// проекция начала вектора скорости на разрез
+		return cut_line.contains(cut_line.projection_of(m.mv.start));
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ---------------------------- FieldIndex class -----------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+// заголовок сохранённой сетки
+struct field_index_header
+{
+	double origin_x, origin_y;
+	double cell_size;
+	int32_t nx, ny;
+	uint64_t item_count;
+};
+
+static size_t align8(size_t size)
+{
+	return (size + 7) & ~(size_t)7;
+}
+
+FieldIndex::FieldIndex() : cell_size(1.), nx(0), ny(0), cell_start_data(1, 0), 
+	cell_start(cell_start_data.data()), items(NULL), item_count(0) {}
+
+int FieldIndex::cell_x(double x) const
+{
+	int c = (int)floor((x - origin.x) / cell_size);
+	return std::min(std::max(c, 0), nx - 1);
+}
+
+int FieldIndex::cell_y(double y) const
+{
+	int c = (int)floor((y - origin.y) / cell_size);
+	return std::min(std::max(c, 0), ny - 1);
+}
+
+void FieldIndex::build(const double *x, const double *y, size_t n)
+{
+	double inf = std::numeric_limits <double>::infinity();
+	double xmin = inf, ymin = inf, xmax = -inf, ymax = -inf;
+	size_t valid_count = 0;
+
+	for (size_t j = 0; j < n; ++j)
+	{
+		// векторы с нечисловыми координатами не попадают ни в один коридор
+		if (!std::isfinite(x[j]) || !std::isfinite(y[j])) continue;
+		xmin = std::min(xmin, x[j]), xmax = std::max(xmax, x[j]);
+		ymin = std::min(ymin, y[j]), ymax = std::max(ymax, y[j]);
+		++valid_count;
+	}
+
+	items_data.clear();
+	if (valid_count == 0)
+	{
+		nx = ny = 0;
+		cell_start_data.assign(1, 0);
+		cell_start = cell_start_data.data(), items = NULL, item_count = 0;
+		return;
+	}
+
+	double w = xmax - xmin, h = ymax - ymin;
+	cell_size = sqrt(w * h * FI_POINTS_PER_CELL / valid_count);
+	cell_size = std::max(cell_size, std::max(w, h) / FI_MAX_CELLS_PER_SIDE);
+	if (cell_size <= 0.0) cell_size = 1.;
+
+	origin = point(xmin, ymin);
+	nx = (int)(w / cell_size) + 1;
+	ny = (int)(h / cell_size) + 1;
+
+	// сортировка подсчётом: порядок векторов внутри ячейки сохраняется
+	std::vector <int> cell_of(n, -1);
+	cell_start_data.assign(nx * ny + 1, 0);
+	for (size_t j = 0; j < n; ++j)
+	{
+		if (!std::isfinite(x[j]) || !std::isfinite(y[j])) continue;
+		cell_of[j] = cell_y(y[j]) * nx + cell_x(x[j]);
+		++cell_start_data[cell_of[j] + 1];
+	}
+	for (int c = 0; c < nx * ny; ++c)
+		cell_start_data[c + 1] += cell_start_data[c];
+
+	items_data.resize(valid_count);
+	std::vector <int> fill(cell_start_data.begin(), cell_start_data.end() - 1);
+	for (size_t j = 0; j < n; ++j)
+		if (cell_of[j] >= 0)
+			items_data[fill[cell_of[j]]++] = j;
+
+	cell_start = cell_start_data.data();
+	items = items_data.data();
+	item_count = items_data.size();
+}
+
+size_t FieldIndex::serialized_size() const
+{
+	return sizeof(field_index_header) + align8(((size_t)nx * ny + 1 + item_count) * sizeof(int32_t));
+}
+
+void FieldIndex::write(std::ostream &out) const
+{
+	field_index_header h;
+	h.origin_x = origin.x, h.origin_y = origin.y;
+	h.cell_size = cell_size;
+	h.nx = nx, h.ny = ny;
+	h.item_count = item_count;
+	out.write((const char *)&h, sizeof(h));
+
+	size_t cells_size = ((size_t)nx * ny + 1) * sizeof(int32_t), items_size = item_count * sizeof(int32_t);
+	out.write((const char *)cell_start, cells_size);
+	if (item_count > 0)
+		out.write((const char *)items, items_size);
+
+	static const char pad[8] = {0};
+	out.write(pad, align8(cells_size + items_size) - (cells_size + items_size));
+}
+
+bool FieldIndex::attach(const char *data, size_t size, size_t n)
+{
+	if (size < sizeof(field_index_header)) return false;
+	field_index_header h;
+	memcpy(&h, data, sizeof(h));
+
+	if (h.nx < 0 || h.ny < 0 || h.item_count > n || !(h.cell_size > 0.0)) return false;
+	size_t cells = (size_t)h.nx * h.ny + 1;
+	if (size < sizeof(h) + (cells + h.item_count) * sizeof(int32_t)) return false;
+
+	const int *cs = (const int *)(data + sizeof(h));
+	if (cs[0] != 0 || (size_t)cs[cells - 1] != h.item_count) return false;
+
+	// повреждённая сетка не должна приводить к чтению за границами столбцов и самой сетки
+	for (size_t c = 1; c < cells; ++c)
+		if (cs[c] < cs[c - 1]) return false;
+	const int *it = cs + cells;
+	for (size_t j = 0; j < h.item_count; ++j)
+		if (it[j] < 0 || (size_t)it[j] >= n) return false;
+
+	origin = point(h.origin_x, h.origin_y);
+	cell_size = h.cell_size;
+	nx = h.nx, ny = h.ny;
+	cell_start_data.clear(), items_data.clear();
+	cell_start = cs;
+	items = cs + cells;
+	item_count = h.item_count;
+	return true;
+}
+
+void FieldIndex::candidates(const scut &cut, std::vector <int> &idx) const
+{
+	double len = cut.start.distance_to(cut.end);
+	if (nx == 0 || len == 0.0 || !std::isfinite(len)) return;
+
+	// полоса разреза - прямоугольник, расширенный на запас по ширине и длине
+	double ux = (cut.end.x - cut.start.x) / len, uy = (cut.end.y - cut.start.y) / len;
+	double wd = cut.width + FI_BAND_MARGIN;
+	point band[4] = {
+		point(cut.start.x - ux * FI_BAND_MARGIN - uy * wd, cut.start.y - uy * FI_BAND_MARGIN + ux * wd),
+		point(cut.end.x + ux * FI_BAND_MARGIN - uy * wd, cut.end.y + uy * FI_BAND_MARGIN + ux * wd),
+		point(cut.end.x + ux * FI_BAND_MARGIN + uy * wd, cut.end.y + uy * FI_BAND_MARGIN - ux * wd),
+		point(cut.start.x - ux * FI_BAND_MARGIN + uy * wd, cut.start.y - uy * FI_BAND_MARGIN - ux * wd)
+	};
+
+	double ylo = band[0].y, yhi = band[0].y;
+	for (int k = 1; k < 4; ++k)
+		ylo = std::min(ylo, band[k].y), yhi = std::max(yhi, band[k].y);
+	if (yhi < origin.y || ylo > origin.y + ny * cell_size) return;
+
+	int row_lo = cell_y(ylo), row_hi = cell_y(yhi);
+	for (int r = row_lo; r <= row_hi; ++r)
+	{
+		// x-диапазон выпуклого четырёхугольника внутри горизонтальной полосы строки
+		double ya = origin.y + r * cell_size, yb = ya + cell_size;
+		if (r == 0) ya = -std::numeric_limits <double>::infinity();
+		if (r == ny - 1) yb = std::numeric_limits <double>::infinity();
+
+		double xlo = std::numeric_limits <double>::infinity(), xhi = -xlo;
+		for (int k = 0; k < 4; ++k)
+		{
+			const point &p = band[k], &q = band[(k + 1) % 4];
+			if (p.y >= ya && p.y <= yb)
+				xlo = std::min(xlo, p.x), xhi = std::max(xhi, p.x);
+
+			double yc[2] = {ya, yb};
+			for (int s = 0; s < 2; ++s)
+				if (p.y != q.y && std::min(p.y, q.y) <= yc[s] && yc[s] <= std::max(p.y, q.y))
+				{
+					double x = p.x + (yc[s] - p.y) * (q.x - p.x) / (q.y - p.y);
+					xlo = std::min(xlo, x), xhi = std::max(xhi, x);
+				}
+		}
+		if (xlo > xhi || xhi < origin.x || xlo > origin.x + nx * cell_size) continue;
+
+		for (int c = r * nx + cell_x(xlo); c <= r * nx + cell_x(xhi); ++c)
+			idx.insert(idx.end(), items + cell_start[c], items + cell_start[c + 1]);
+	}
+}
+
+int FieldIndex::cell_count() const
+{
+	return nx * ny;
+}
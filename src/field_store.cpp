@@ -0,0 +1,115 @@
+#include "field_store.h"
+#include "corridor_filter.h"
+#include "geo_transform.h"
+
+#include <algorithm>
+
+void FieldStore::copy_columns(std::vector <movement> &m, bool starts)
+{
+	size_t n = count;
+	storage.resize((starts ? EFC_COUNT : EFC_COUNT - 2) * n);
+	double *col = storage.data();
+	double *sx = col, *sy = col + n;
+	if (starts)
+	{
+		x0 = sx, y0 = sy;
+		col += 2 * n;
+	}
+	double *ex = col, *ey = col + n, *v = col + 2 * n, *e = col + 3 * n;
+	x1 = ex, y1 = ey, velocity = v, error = e;
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (starts)
+			sx[i] = m[i].mv.start.x, sy[i] = m[i].mv.start.y;
+		ex[i] = m[i].mv.end.x, ey[i] = m[i].mv.end.y;
+		v[i] = m[i].velocity, e[i] = m[i].error;
+	}
+	std::vector <movement>().swap(m);
+}
+
+FieldStore::FieldStore(std::vector <movement> &m) : count(m.size()), grid(&index)
+{
+	copy_columns(m, true);
+	index.build(x0, y0, count);
+}
+
+FieldStore::FieldStore(std::vector <movement> &m, std::shared_ptr <const FieldStore> g) : 
+	base(g), count(m.size()), grid(g->grid)
+{
+	x0 = g->x0, y0 = g->y0;
+	copy_columns(m, false);
+}
+
+FieldStore::FieldStore(std::shared_ptr <const FieldFile> f, const point &origin) : file(f), count(f->count()), grid(&index)
+{
+	velocity = file->column(EFC_VELOCITY);
+	error = file->column(EFC_ERROR);
+
+	point frame = file->has_frame() ? file->frame_origin() : point(0., 0.);
+	if (file->has_frame() && frame.x == origin.x && frame.y == origin.y &&
+		index.attach(file->index_data(), file->index_size(), count))
+	{
+		x0 = file->frame_column(EFC_X0), y0 = file->frame_column(EFC_Y0);
+		x1 = file->frame_column(EFC_X1), y1 = file->frame_column(EFC_Y1);
+		return;
+	}
+
+	// те же преобразования, что to_cartesian_cs для текстового поля
+	size_t n = count;
+	storage.resize(4 * n);
+	double *col = storage.data();
+	const double *gx0 = file->column(EFC_X0), *gy0 = file->column(EFC_Y0);
+	const double *gx1 = file->column(EFC_X1), *gy1 = file->column(EFC_Y1);
+	to_dec_cs(gx0, gy0, col + EFC_X0 * n, col + EFC_Y0 * n, n, origin);
+	to_dec_cs(gx1, gy1, col + EFC_X1 * n, col + EFC_Y1 * n, n, origin);
+	x0 = col, y0 = col + n, x1 = col + 2 * n, y1 = col + 3 * n;
+
+	index.build(x0, y0, n);
+}
+
+size_t FieldStore::size() const
+{
+	return count;
+}
+
+bool FieldStore::shares_grid() const
+{
+	return grid != &index;
+}
+
+movement FieldStore::at(size_t i) const
+{
+	return movement(vec(point(x0[i], y0[i]), point(x1[i], y1[i])), velocity[i], error[i]);
+}
+
+int FieldStore::select(const scut &cut, std::vector <int> &idx) const
+{
+	std::vector <int> cnd;
+	grid->candidates(cut, cnd);
+
+	size_t first = idx.size();
+	idx.resize(first + cnd.size());
+	size_t count = corridor_filter(corridor_kernel_args(cut), x0, y0, velocity, 
+								   cnd.data(), cnd.size(), idx.data() + first);
+	idx.resize(first + count);
+
+	// порядок полного перебора поля: от него зависят суммы и первый вектор коридора
+	std::sort(idx.begin() + first, idx.end());
+
+	return count;
+}
+
+size_t FieldStore::frame_size() const
+{
+	return 4 * count * sizeof(double) + grid->serialized_size();
+}
+
+void FieldStore::write_frame(std::ostream &out) const
+{
+	out.write((const char *)x0, count * sizeof(double));
+	out.write((const char *)y0, count * sizeof(double));
+	out.write((const char *)x1, count * sizeof(double));
+	out.write((const char *)y1, count * sizeof(double));
+	grid->write(out);
+}
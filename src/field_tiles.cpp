@@ -0,0 +1,218 @@
+#include "field_tiles.h"
+#include "field_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+TiledField::TiledField(const std::string &fname, size_t memory_budget, double tsize) :
+	file_name(fname), file_size(0), tile_size(tsize), budget(memory_budget), pending_bytes(0),
+	cached_bytes(0), vector_count(0), load_count(0), peak_bytes(0), over_budget(false)
+{
+	file.open(file_name.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file)
+		std::cerr << "Error: can not create tile file " << file_name << "\n";
+}
+
+TiledField::~TiledField()
+{
+	file.close();
+	remove(file_name.c_str());
+}
+
+bool TiledField::is_open() const
+{
+	return file.is_open();
+}
+
+tile_key TiledField::tile_of(const point &pt) const
+{
+	return tile_key((int)floor(pt.x / tile_size), (int)floor(pt.y / tile_size));
+}
+
+void TiledField::add(const movement &m)
+{
+	// векторы с нечисловыми началами не попадают ни в один коридор
+	if (!std::isfinite(m.mv.start.x) || !std::isfinite(m.mv.start.y))
+	{
+		++vector_count;
+		return;
+	}
+
+	tile_record r;
+	r.index = vector_count++;
+	r.x0 = m.mv.start.x, r.y0 = m.mv.start.y;
+	r.x1 = m.mv.end.x, r.y1 = m.mv.end.y;
+	r.velocity = m.velocity, r.error = m.error;
+
+	tile_entry &t = tiles[tile_of(m.mv.start)];
+	t.pending.push_back(r);
+	++t.count;
+
+	pending_bytes += sizeof(tile_record);
+	peak_bytes = std::max(peak_bytes, pending_bytes);
+	if (pending_bytes > budget)
+		flush_pending();
+}
+
+void TiledField::flush_pending()
+{
+	file.seekp(file_size);
+	for (std::map <tile_key, tile_entry>::iterator it = tiles.begin(); it != tiles.end(); ++it)
+	{
+		tile_entry &t = it->second;
+		if (t.pending.empty()) continue;
+
+		t.chunks.push_back(std::make_pair(file_size, (uint32_t)t.pending.size()));
+		size_t bytes = t.pending.size() * sizeof(tile_record);
+		file.write((const char *)t.pending.data(), bytes);
+		file_size += bytes;
+		std::vector <tile_record>().swap(t.pending);
+	}
+	pending_bytes = 0;
+}
+
+void TiledField::finish()
+{
+	flush_pending();
+	file.flush();
+}
+
+void TiledField::tiles_of(const scut &cut, std::vector <tile_key> &keys) const
+{
+	keys.clear();
+	if (tiles.empty()) return;
+
+	double wd = cut.width + FI_BAND_MARGIN;
+	double xmin = std::min(cut.start.x, cut.end.x) - wd, xmax = std::max(cut.start.x, cut.end.x) + wd;
+	double ymin = std::min(cut.start.y, cut.end.y) - wd, ymax = std::max(cut.start.y, cut.end.y) + wd;
+	if (!std::isfinite(xmin) || !std::isfinite(xmax) || !std::isfinite(ymin) || !std::isfinite(ymax))
+		return;
+
+	tile_key lo = tile_of(point(xmin, ymin)), hi = tile_of(point(xmax, ymax));
+
+	// тайл берётся, если расстояние от его центра до отрезка разреза не больше
+	// ширины полосы плюс половины диагонали тайла
+	double reach = wd + tile_size * M_SQRT1_2;
+	double dx = cut.end.x - cut.start.x, dy = cut.end.y - cut.start.y;
+	double len2 = dx * dx + dy * dy;
+
+	for (int ty = lo.second; ty <= hi.second; ++ty)
+		for (int tx = lo.first; tx <= hi.first; ++tx)
+		{
+			std::map <tile_key, tile_entry>::const_iterator it = tiles.find(tile_key(tx, ty));
+			if (it == tiles.end()) continue;
+
+			point c((tx + 0.5) * tile_size, (ty + 0.5) * tile_size);
+			double t = (len2 > 0.0) ? ((c.x - cut.start.x) * dx + (c.y - cut.start.y) * dy) / len2 : 0.0;
+			t = std::min(std::max(t, 0.0), 1.0);
+			point nearest(cut.start.x + t * dx, cut.start.y + t * dy);
+			if (c.distance_to(nearest) <= reach)
+				keys.push_back(it->first);
+		}
+}
+
+void TiledField::evict(const std::vector <tile_key> &pinned, size_t need)
+{
+	// вытеснение с конца списка; тайлы текущего разреза не вытесняются
+	std::list <tile_key>::iterator it = lru.end();
+	while (cached_bytes + need > budget && it != lru.begin())
+	{
+		--it;
+		if (std::find(pinned.begin(), pinned.end(), *it) != pinned.end()) continue;
+
+		tile_entry &t = tiles[*it];
+		cached_bytes -= t.records.size() * sizeof(tile_record);
+		std::vector <tile_record>().swap(t.records);
+		t.loaded = false;
+		it = lru.erase(it);
+	}
+}
+
+void TiledField::load(tile_key key, tile_entry &t)
+{
+	size_t bytes = t.count * sizeof(tile_record);
+	t.records.resize(t.count);
+	size_t pos = 0;
+	for (size_t c = 0; c < t.chunks.size(); ++c)
+	{
+		file.seekg(t.chunks[c].first);
+		file.read((char *)(t.records.data() + pos), t.chunks[c].second * sizeof(tile_record));
+		pos += t.chunks[c].second;
+	}
+	if (!file)
+	{
+		std::cerr << "Error: reading tile file " << file_name << " failed\n";
+		file.clear();
+	}
+
+	t.loaded = true;
+	lru.push_front(key);
+	t.lru_pos = lru.begin();
+	cached_bytes += bytes;
+	peak_bytes = std::max(peak_bytes, cached_bytes);
+	++load_count;
+}
+
+void TiledField::gather(const scut &cut, std::vector <movement> &mvn)
+{
+	std::vector <tile_key> keys;
+	tiles_of(cut, keys);
+
+	// загруженные тайлы разреза поднимаются в начало списка, чтобы не быть вытесненными
+	size_t need = 0;
+	for (size_t k = 0; k < keys.size(); ++k)
+	{
+		tile_entry &t = tiles[keys[k]];
+		if (t.loaded)
+			lru.splice(lru.begin(), lru, t.lru_pos);
+		else
+			need += t.count * sizeof(tile_record);
+	}
+	evict(keys, need);
+	if (cached_bytes + need > budget && !over_budget)
+	{
+		std::cerr << "Warning: tiles of a cut do not fit in the memory budget\n";
+		over_budget = true;
+	}
+
+	std::vector <const tile_record *> rec;
+	for (size_t k = 0; k < keys.size(); ++k)
+	{
+		tile_entry &t = tiles[keys[k]];
+		if (!t.loaded)
+			load(keys[k], t);
+		for (size_t j = 0; j < t.records.size(); ++j)
+			rec.push_back(&t.records[j]);
+	}
+
+	// порядок входного файла: от него зависят суммы и первый вектор коридора
+	std::sort(rec.begin(), rec.end(), [](const tile_record *a, const tile_record *b) { return a->index < b->index; });
+
+	mvn.clear();
+	mvn.reserve(rec.size());
+	for (size_t j = 0; j < rec.size(); ++j)
+		mvn.push_back(movement(vec(point(rec[j]->x0, rec[j]->y0), point(rec[j]->x1, rec[j]->y1)),
+							   rec[j]->velocity, rec[j]->error));
+}
+
+size_t TiledField::size() const
+{
+	return vector_count;
+}
+
+size_t TiledField::tile_count() const
+{
+	return tiles.size();
+}
+
+size_t TiledField::loads() const
+{
+	return load_count;
+}
+
+size_t TiledField::peak_memory() const
+{
+	return peak_bytes;
+}
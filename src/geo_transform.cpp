@@ -0,0 +1,292 @@
+#include "geo_transform.h"
+
+#include "corridor_filter.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DT_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#define GT_DEG2RAD (M_PI / 180)
+
+// многочлены sin и cos на [-pi/4, pi/4] (cephes): sin d = d + d z S(z), cos d = 1 - z/2 + z^2 C(z),
+// z = d^2; коэффициенты от старшего к младшему
+static const double gt_sin[] = {
+	1.58962301576546568060e-10, -2.50507477628578072866e-8, 2.75573136213857245213e-6,
+	-1.98412698295895385996e-4, 8.33333333332211858878e-3, -1.66666666666666307295e-1
+};
+static const double gt_cos[] = {
+	-1.13585365213876817300e-11, 2.08757008419747316778e-9, -2.75573141792967388112e-7,
+	2.48015872888517045348e-5, -1.38888888888730564116e-3, 4.16666666666665929218e-2
+};
+static const int gt_poly_size = sizeof(gt_sin) / sizeof(gt_sin[0]);
+
+////////////////////////////////////////////////////////////////////////////////
+// ------------------------------- scalar path -------------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+double parallel_radius(double latitude)
+{
+	// latitude = 90 q + d: приведение в градусах точное, в радианы переводится только остаток
+	double q = nearbyint(latitude / 90.);
+	double d = (latitude - q * 90.) * GT_DEG2RAD;
+	double z = d * d;
+
+	double sp = gt_sin[0], cp = gt_cos[0];
+	for (int i = 1; i < gt_poly_size; ++i)
+	{
+		sp = sp * z + gt_sin[i];
+		cp = cp * z + gt_cos[i];
+	}
+	double s = d + d * z * sp;
+	double c = (1. - 0.5 * z) + z * z * cp;
+
+	// четверть q mod 4: sin^2 и cos широты через sin и cos остатка
+	double k = q - 4. * floor(q / 4.);
+	bool odd = (k == 1. || k == 3.), neg = (k == 1. || k == 2.);
+	double sin2 = odd ? c * c : s * s;
+	double cos_lat = odd ? s : c;
+	if (neg) cos_lat = - cos_lat;
+
+	return EQUATOR_RADIUS * (1. - EARTH_FLATTENING * sin2) * cos_lat;
+}
+
+static void parallel_radius_scalar(const double *lat, double *r, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		r[i] = parallel_radius(lat[i]);
+}
+
+#ifdef DT_SIMD_X86
+
+__attribute__((target("avx2")))
+static void parallel_radius_avx2(const double *lat, double *r, size_t n)
+{
+	const __m256d one = _mm256_set1_pd(1.), two = _mm256_set1_pd(2.), three = _mm256_set1_pd(3.);
+	const __m256d four = _mm256_set1_pd(4.), ninety = _mm256_set1_pd(90.);
+	const __m256d sign_bit = _mm256_set1_pd(-0.);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m256d la = _mm256_loadu_pd(lat + i);
+		__m256d q = _mm256_round_pd(_mm256_div_pd(la, ninety), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m256d d = _mm256_mul_pd(_mm256_sub_pd(la, _mm256_mul_pd(q, ninety)), _mm256_set1_pd(GT_DEG2RAD));
+		__m256d z = _mm256_mul_pd(d, d);
+
+		__m256d sp = _mm256_set1_pd(gt_sin[0]), cp = _mm256_set1_pd(gt_cos[0]);
+		for (int k = 1; k < gt_poly_size; ++k)
+		{
+			sp = _mm256_add_pd(_mm256_mul_pd(sp, z), _mm256_set1_pd(gt_sin[k]));
+			cp = _mm256_add_pd(_mm256_mul_pd(cp, z), _mm256_set1_pd(gt_cos[k]));
+		}
+		__m256d s = _mm256_add_pd(d, _mm256_mul_pd(_mm256_mul_pd(d, z), sp));
+		__m256d c = _mm256_add_pd(_mm256_sub_pd(one, _mm256_mul_pd(_mm256_set1_pd(0.5), z)),
+								  _mm256_mul_pd(_mm256_mul_pd(z, z), cp));
+
+		__m256d k = _mm256_sub_pd(q, _mm256_mul_pd(four, _mm256_floor_pd(_mm256_div_pd(q, four))));
+		__m256d odd = _mm256_or_pd(_mm256_cmp_pd(k, one, _CMP_EQ_OQ), _mm256_cmp_pd(k, three, _CMP_EQ_OQ));
+		__m256d neg = _mm256_or_pd(_mm256_cmp_pd(k, one, _CMP_EQ_OQ), _mm256_cmp_pd(k, two, _CMP_EQ_OQ));
+		__m256d sin2 = _mm256_blendv_pd(_mm256_mul_pd(s, s), _mm256_mul_pd(c, c), odd);
+		__m256d cos_lat = _mm256_xor_pd(_mm256_blendv_pd(c, s, odd), _mm256_and_pd(neg, sign_bit));
+
+		__m256d res = _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(EQUATOR_RADIUS),
+			_mm256_sub_pd(one, _mm256_mul_pd(_mm256_set1_pd(EARTH_FLATTENING), sin2))), cos_lat);
+		_mm256_storeu_pd(r + i, res);
+	}
+
+	// без очистки верхних половин регистров последующий SSE-код (в том числе libm)
+	// замедляется; компилятор вставляет vzeroupper только при оптимизации
+	_mm256_zeroupper();
+
+	parallel_radius_scalar(lat + i, r + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static void parallel_radius_avx512(const double *lat, double *r, size_t n)
+{
+	const __m512d one = _mm512_set1_pd(1.), two = _mm512_set1_pd(2.), three = _mm512_set1_pd(3.);
+	const __m512d four = _mm512_set1_pd(4.), ninety = _mm512_set1_pd(90.);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		// maskz с полной маской: у немаскированного округления источник не определён
+		__m512d la = _mm512_loadu_pd(lat + i);
+		__m512d q = _mm512_maskz_roundscale_pd(0xFF, _mm512_div_pd(la, ninety), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m512d d = _mm512_mul_pd(_mm512_sub_pd(la, _mm512_mul_pd(q, ninety)), _mm512_set1_pd(GT_DEG2RAD));
+		__m512d z = _mm512_mul_pd(d, d);
+
+		__m512d sp = _mm512_set1_pd(gt_sin[0]), cp = _mm512_set1_pd(gt_cos[0]);
+		for (int k = 1; k < gt_poly_size; ++k)
+		{
+			sp = _mm512_add_pd(_mm512_mul_pd(sp, z), _mm512_set1_pd(gt_sin[k]));
+			cp = _mm512_add_pd(_mm512_mul_pd(cp, z), _mm512_set1_pd(gt_cos[k]));
+		}
+		__m512d s = _mm512_add_pd(d, _mm512_mul_pd(_mm512_mul_pd(d, z), sp));
+		__m512d c = _mm512_add_pd(_mm512_sub_pd(one, _mm512_mul_pd(_mm512_set1_pd(0.5), z)),
+								  _mm512_mul_pd(_mm512_mul_pd(z, z), cp));
+
+		__m512d k = _mm512_sub_pd(q, _mm512_mul_pd(four, _mm512_maskz_roundscale_pd(0xFF, _mm512_div_pd(q, four),
+												   _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)));
+		__mmask8 odd = _mm512_cmp_pd_mask(k, one, _CMP_EQ_OQ) | _mm512_cmp_pd_mask(k, three, _CMP_EQ_OQ);
+		__mmask8 neg = _mm512_cmp_pd_mask(k, one, _CMP_EQ_OQ) | _mm512_cmp_pd_mask(k, two, _CMP_EQ_OQ);
+		__m512d sin2 = _mm512_mask_blend_pd(odd, _mm512_mul_pd(s, s), _mm512_mul_pd(c, c));
+		__m512d cos_lat = _mm512_mask_blend_pd(odd, c, s);
+		__m512i bits = _mm512_castpd_si512(cos_lat);
+		cos_lat = _mm512_castsi512_pd(_mm512_mask_xor_epi64(bits, neg, bits, _mm512_set1_epi64(INT64_MIN)));
+
+		__m512d res = _mm512_mul_pd(_mm512_mul_pd(_mm512_set1_pd(EQUATOR_RADIUS),
+			_mm512_sub_pd(one, _mm512_mul_pd(_mm512_set1_pd(EARTH_FLATTENING), sin2))), cos_lat);
+		_mm512_storeu_pd(r + i, res);
+	}
+
+	// без очистки верхних половин регистров последующий SSE-код (в том числе libm)
+	// замедляется; компилятор вставляет vzeroupper только при оптимизации
+	_mm256_zeroupper();
+
+	parallel_radius_scalar(lat + i, r + i, n - i);
+}
+
+#endif // DT_SIMD_X86
+
+void parallel_radius(const double *lat, double *r, size_t n)
+{
+#ifdef DT_SIMD_X86
+	switch (simd_level())
+	{
+		case ESL_AVX512: parallel_radius_avx512(lat, r, n); return;
+		case ESL_AVX2: parallel_radius_avx2(lat, r, n); return;
+		default: break;
+	}
+#endif
+	parallel_radius_scalar(lat, r, n);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ----------------------------- пакетный пересчёт ---------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+// Операции те же, что в point::to_dec_cs и point::to_geo_cs
+static void dec_range(const double *lon, const double *lat, double *x, double *y, size_t n,
+					  const point &origin)
+{
+	double r[GT_BLOCK];
+	for (size_t b = 0; b < n; b += GT_BLOCK)
+	{
+		size_t m = std::min((size_t)GT_BLOCK, n - b);
+		parallel_radius(lat + b, r, m);
+
+		for (size_t i = 0; i < m; ++i)
+		{
+			size_t j = b + i;
+			double px = lon[j] - origin.x, py = lat[j] - origin.y;
+			px *= r[i] * M_PI / 180;
+			py *= METERS_IN_ONE_DEG;
+			x[j] = M2KM(px);
+			y[j] = M2KM(py);
+		}
+	}
+}
+
+static void geo_range(const double *x, const double *y, double *lon, double *lat, size_t n,
+					  const point &origin)
+{
+	double px[GT_BLOCK], la[GT_BLOCK], r[GT_BLOCK];
+	for (size_t b = 0; b < n; b += GT_BLOCK)
+	{
+		size_t m = std::min((size_t)GT_BLOCK, n - b);
+		for (size_t i = 0; i < m; ++i)
+		{
+			size_t j = b + i;
+			px[i] = KM2M(x[j]);
+			double py = KM2M(y[j]);
+			py = py / MERIDIAN_LENGTH * 360.;
+			la[i] = py + origin.y;
+		}
+		parallel_radius(la, r, m);
+
+		for (size_t i = 0; i < m; ++i)
+		{
+			size_t j = b + i;
+			px[i] *= 180. / M_PI / r[i];
+			lon[j] = px[i] + origin.x;
+			lat[j] = la[i];
+		}
+	}
+}
+
+// [0, n) частями по потокам; малые массивы - в вызывающем потоке
+static void for_each_range(size_t n, int thread_count, const std::function <void (size_t, size_t)> &f)
+{
+	if (thread_count <= 1 || n < GT_PARALLEL_MIN)
+	{
+		f(0, n);
+		return;
+	}
+
+	size_t part = (n + thread_count - 1) / thread_count;
+	part = (part + GT_BLOCK - 1) / GT_BLOCK * GT_BLOCK;
+
+	ThreadPool pool(thread_count);
+	for (size_t first = 0; first < n; first += part)
+	{
+		size_t last = std::min(n, first + part);
+		pool.submit([&f, first, last](int) { f(first, last); });
+	}
+	pool.wait();
+}
+
+void to_dec_cs(const double *lon, const double *lat, double *x, double *y, size_t n,
+			   const point &origin, int thread_count)
+{
+	for_each_range(n, thread_count, [&](size_t first, size_t last)
+	{
+		dec_range(lon + first, lat + first, x + first, y + first, last - first, origin);
+	});
+}
+
+void to_geo_cs(const double *x, const double *y, double *lon, double *lat, size_t n,
+			   const point &origin, int thread_count)
+{
+	for_each_range(n, thread_count, [&](size_t first, size_t last)
+	{
+		geo_range(x + first, y + first, lon + first, lat + first, last - first, origin);
+	});
+}
+
+// Концы векторов переписываются блоками в столбцы и обратно: разные объекты movement
+// не образуют одного массива, и проход по ним с шагом был бы неопределённым поведением
+void to_dec_cs(std::vector <movement> &mvn, const point &origin, int thread_count)
+{
+	if (mvn.empty()) return;
+
+	for_each_range(mvn.size(), thread_count, [&](size_t first, size_t last)
+	{
+		double sx[GT_BLOCK], sy[GT_BLOCK], ex[GT_BLOCK], ey[GT_BLOCK];
+		for (size_t b = first; b < last; b += GT_BLOCK)
+		{
+			size_t m = std::min((size_t)GT_BLOCK, last - b);
+			for (size_t i = 0; i < m; ++i)
+			{
+				const vec &v = mvn[b + i].mv;
+				sx[i] = v.start.x, sy[i] = v.start.y;
+				ex[i] = v.end.x, ey[i] = v.end.y;
+			}
+			dec_range(sx, sy, sx, sy, m, origin);
+			dec_range(ex, ey, ex, ey, m, origin);
+			for (size_t i = 0; i < m; ++i)
+			{
+				vec &v = mvn[b + i].mv;
+				v.start.x = sx[i], v.start.y = sy[i];
+				v.end.x = ex[i], v.end.y = ey[i];
+			}
+		}
+	});
+}
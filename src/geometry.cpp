@@ -4,17 +4,17 @@
 // ----------------------------- point struct --------------------------------//
 ////////////////////////////////////////////////////////////////////////////////
 
-bool point::equal(const point &p)
+bool point::equal(const point &p) const
 {
 	return (x == p.x && y == p.y);
 }
 
-bool point::equal_eps(const point &p)
+bool point::equal_eps(const point &p) const
 {
 	return (fabs(x - p.x) < EPS && fabs(y - p.y) < EPS);
 }
 
-double point::distance_to(point p) const
+double point::distance_to(const point &p) const
 {
 	return sqrt((x - p.x) * (x - p.x) + (y - p.y) * (y - p.y));
 }
@@ -54,12 +54,12 @@ std::string point::toString(std::string name) const
 // ------------------------------ vec struct ---------------------------------//
 ////////////////////////////////////////////////////////////////////////////////
 
-bool vec::contains(point p)
+bool vec::contains(const point &p) const
 {
 	return sign(p.x - start.x) * sign(p.x - end.x) < 0;
 }
 
-double vec::length()
+double vec::length() const
 {
 	return sqrt((start.x - end.x) * (start.x - end.x) + (start.y - end.y) * (start.y - end.y));
 }
@@ -77,24 +77,24 @@ void vec::shorten(double len/*, double dl = 0.0*/)
 	return;
 }
 
-point vec::middle()
+point vec::middle() const
 {
 	return point((start.x + end.x) / 2, (start.y + end.y) / 2);
 }
 
-std::string vec::toString(std::string name)
+std::string vec::toString(std::string name) const
 {
 	char str[100];
 	sprintf(str, "%s[%s -> %s]", name.c_str(), start.toString().c_str(), end.toString().c_str());
 	return std::string(str);
 }
 
-vec vec::at_geo_cs(const point &origin)
+vec vec::at_geo_cs(const point &origin) const
 {
 	return vec(this->start.at_geo_cs(origin), this->end.at_geo_cs(origin));
 }
 
-std::string vec::toGlanceFormat()
+std::string vec::toGlanceFormat() const
 {
 	char str[200];
 	sprintf(str, "TYPE = VECTOR\tCOLOR = 14\tWIDTH = 1\tSCALE = 1.00\tGEO = (%2f,%2f %2f,%2f)\n",
@@ -108,14 +108,14 @@ std::string vec::toGlanceFormat()
 
 Line::Line() : a(0), b(0), c(0), p1(point(0, 0)), p2(point(0, 0)) {}
 
-Line::Line(vec v) : p1(v.start), p2(v.end)
+Line::Line(const vec &v) : p1(v.start), p2(v.end)
 {
 	a = p2.y - p1.y;
 	b = p1.x - p2.x;
 	c = - p1.y * b - p1.x * a;
 }
 
-Line::Line(point _p1, point _p2) : p1(_p1), p2(_p2)
+Line::Line(const point &_p1, const point &_p2) : p1(_p1), p2(_p2)
 {
 	a = p2.y - p1.y;
 	b = p1.x - p2.x;
@@ -127,42 +127,42 @@ Line::Line(double _a, double _b, double _c) : a(_a), b(_b), c(_c), p1(point(0, 0
 	// p1 and p2 are NOT INITIALIZED
 }
 
-double Line::f(point p)
+double Line::f(const point &p) const
 {
 	return a * p.x + b * p.y + c;
 }
 
-double Line::get_a()
+double Line::get_a() const
 {
 	return a;
 }
 
-double Line::get_b()
+double Line::get_b() const
 {
 	return b;
 }
 
-double Line::get_c()
+double Line::get_c() const
 {
 	return c;
 }
 
-point Line::start()
+point Line::start() const
 {
 	return p1;
 }
 
-point Line::end()
+point Line::end() const
 {
 	return p2;
 }
 
-vec Line::interval()
+vec Line::interval() const
 {
 	return vec(p1, p2);
 }
 
-void Line::set_interval(point _p1, point _p2)
+void Line::set_interval(const point &_p1, const point &_p2)
 {
 	// Line(_p1, _p2);
 	p1 = _p1; p2 = _p2;
@@ -177,7 +177,7 @@ bool is_t(double numerator, double denominator)
 		   (denominator != 0 && numerator / denominator >= 0 && numerator / denominator <= 1);
 }
 
-bool Line::contains(point p)
+bool Line::contains(const point &p) const
 {
 	// if (f(p) > EPS)
 		// cout << p.toString("for pt") << " f(pt) > EPS;\t f(pt) = " << f(p) << endl;
@@ -185,38 +185,38 @@ bool Line::contains(point p)
 }
 
 
-double Line::distance_to(point p)
+double Line::distance_to(const point &p) const
 {
 	return f(p) / sqrt(a * a + b * b);
 }
 
-double Line::angle(vec v)
+double Line::angle(const vec &v) const
 {
 	Line l(v);
 	return atan2(a * l.get_b() - l.get_a() * b, a * l.get_a() + b * l.get_b()) * 180 / M_PI;
 }
 
 
-point Line::intersection(Line l)
+point Line::intersection(const Line &l) const
 {
 	double y = (a * l.get_c() - l.get_a() * c) / (l.get_a() * b - a * l.get_b());
 	double x = (b * l.get_c() - l.get_b() * c) / (a * l.get_b() - l.get_a() * b);
 	return point(x, y);
 }
 
-point Line::projection_of(point p)
+point Line::projection_of(const point &p) const
 {
 	Line l = this->perpendicular(p);
 	// cout << l.as_string("vel vec prnd cut line") << endl;
 	return intersection(l);
 }
 
-vec Line::perpendicular(point p)
+vec Line::perpendicular(const point &p) const
 {
 	return vec(p, point(p.x + a, p.y + b));
 }
 
-Line Line::parallel(point p)
+Line Line::parallel(const point &p) const
 {
 	return Line(get_a(), get_b(), -(get_a() * p.x + get_b() * p.y));
 }
@@ -0,0 +1,70 @@
+#include "grid_cache.h"
+#include "geo_transform.h"
+
+#include <cstring>
+
+GridCache::GridCache() : reused_count(0) {}
+
+std::shared_ptr <const FieldStore> GridCache::make_store(std::vector <movement> &mvn, 
+	const std::vector <int> &pixels, const point &origin)
+{
+	size_t n = mvn.size();
+
+	// сетка снимка ищется и при отсутствии регистрируется под одной блокировкой
+	std::shared_future <std::shared_ptr <const FieldStore> > found;
+	std::promise <std::shared_ptr <const FieldStore> > built;
+	bool builder = false;
+	if (!pixels.empty())
+	{
+		std::lock_guard <std::mutex> lock(mtx);
+		for (size_t g = grids.size(); g-- > 0 && !found.valid(); )
+		{
+			const grid_entry &e = grids[g];
+			if (e.pixels != pixels) continue;
+
+			bool same = true;
+			for (size_t i = 0; same && i < n; ++i)
+				same = memcmp(&mvn[i].mv.start.x, &e.gx[i], sizeof(double)) == 0 && 
+					   memcmp(&mvn[i].mv.start.y, &e.gy[i], sizeof(double)) == 0;
+			if (same)
+				found = e.store;
+		}
+
+		if (!found.valid())
+		{
+			grid_entry e;
+			e.pixels = pixels;
+			e.gx.resize(n), e.gy.resize(n);
+			for (size_t i = 0; i < n; ++i)
+				e.gx[i] = mvn[i].mv.start.x, e.gy[i] = mvn[i].mv.start.y;
+			e.store = built.get_future().share();
+			builder = true;
+
+			if (grids.size() == GC_MAX_GRIDS)
+				grids.erase(grids.begin());
+			grids.push_back(std::move(e));
+		}
+		else
+			++reused_count;
+	}
+
+	if (found.valid())
+	{
+		// начала и сетка - хранилища снимка, построившего сетку; в локальную СК переводятся только концы
+		std::shared_ptr <const FieldStore> base = found.get();
+		for (size_t i = 0; i < n; ++i)
+			mvn[i].mv.end.to_dec_cs(origin);
+		return std::make_shared <FieldStore>(mvn, base);
+	}
+
+	to_dec_cs(mvn, origin);
+	std::shared_ptr <const FieldStore> store = std::make_shared <FieldStore>(mvn);
+	if (builder)
+		built.set_value(store);
+	return store;
+}
+
+size_t GridCache::reused() const
+{
+	return reused_count;
+}
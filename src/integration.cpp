@@ -1,19 +1,34 @@
 #include "integration.h"
 
 
-Integral::Integral(scut c, std::vector <wvector> &_wv) : cut(c), wv(_wv)
+Integral::Integral(const scut &c, const std::vector <wvector> &_wv, const FieldStore &f) : 
+	cut(c), wv(_wv), field(f), itp(c.v(), _wv, f), coriolis_table(false), 
+	curvature_table(false), coefs_ready(false), profile(NULL)
 {
 
 }
 
-void Integral::set_cut(scut c)
+void Integral::set_cut(const scut &c)
 {
 	cut = c;
+	itp.set_interval(cut.v());
+	coefs_ready = false;
+}
+
+void Integral::set_parameters(double itp_diameter, double weight_coef)
+{
+	cut.itp_diameter = itp_diameter;
+	cut.weight_coef = weight_coef;
+	// состояние нового Integral: радиус - длина разреза, коэффициент по умолчанию
+	itp.set_radius(cut.v().length());
+	if (weight_coef < 0.0)
+		itp.set_weight_coef(Interpolation::default_weight_coef());
 }
 
 void Integral::set_dcs_origin(const point &dcs_orn)
 {
 	dcs_origin = dcs_orn;
+	coefs_ready = false;
 }
 
 void Integral::set_partitioning_count(int _n)
@@ -26,6 +41,86 @@ void Integral::set_filename(std::string filename)
 	fitp.open(filename.c_str());
 }
 
+TextWriter &Integral::print_log()
+{
+	return fitp;
+}
+
+void Integral::set_precision_mode(E_PRECISION_MODE mode)
+{
+	itp.set_precision_mode(mode);
+}
+
+void Integral::set_coriolis_table(bool on)
+{
+	coriolis_table = on;
+	coefs_ready = false;
+}
+
+void Integral::set_curvature_table(bool on)
+{
+	curvature_table = on;
+	coefs_ready = false;
+}
+
+void Integral::set_profile(cut_profile *p)
+{
+	profile = p;
+	itp.set_profile(p);
+}
+
+void Integral::setup_interpolation()
+{
+	if (cut.itp_diameter == -1)
+		itp.calc_radius();
+	if (cut.itp_diameter >= 0.0) 
+		itp.set_radius(cut.itp_diameter / 2);
+	if (cut.weight_coef >= 0.0) itp.set_weight_coef(cut.weight_coef);
+}
+
+void Integral::setup_coefs()
+{
+	if (coefs_ready) return;
+	coefs.set(cut, dcs_origin, coriolis_table, curvature_table);
+	coefs_ready = true;
+}
+
+void Integral::calc_accuracy(struct itg_result &itg_res)
+{
+	std::vector <double> itp_acr;	// точность интерполяции
+
+	ProfileTimer timer(profile, EPP_ACCURACY);
+	itp.calc_accuracy(itp_acr);
+	timer.stop();
+
+	accuracy_stats(itp_acr, itg_res);
+	itg_res.weight_coef = itp.get_weight_coef();	
+}
+
+void Integral::accuracy_stats(const std::vector <double> &itp_acr, struct itg_result &itg_res)
+{
+	int count = itp_acr.size();
+
+	double acr_sum = 0.0;
+	double acr2_sum = 0.0;
+	for (int i = 0; i < count; ++i)
+	{
+		acr_sum += itp_acr[i];
+		acr2_sum += itp_acr[i] * itp_acr[i];
+
+	}
+	// cout << "sum of sq is" << acr2_sum << "\t" << count <<  endl;
+	itg_res.interpolation_accuracy = acr_sum / count;
+	itg_res.integration_error = sqrt(acr2_sum / count) /** interval.length() * GR*/;
+
+	double msd_sum = 0.0;
+	for (int i = 0; i < count; ++i)
+		msd_sum += (itg_res.interpolation_accuracy - itp_acr[i]) * (itg_res.interpolation_accuracy - itp_acr[i]);
+	itg_res.ms_deviation = sqrt(msd_sum / count );
+
+	itg_res.itp_diameter = itp.get_radius() * 2;
+}
+
 int Integral::take(struct itg_result &itg_res, E_PRINT_MODE pm)
 {
 	if (wv.size() < MIN_POINT_COUNT)
@@ -36,7 +131,8 @@ int Integral::take(struct itg_result &itg_res, E_PRINT_MODE pm)
 
 	// refresh_cut();
 
-	double len_K = wv[0].mvn.mv.length() / wv[0].mvn.velocity;
+	movement first = field.at(wv[0].idx);
+	double len_K = first.mv.length() / first.velocity;
 
 	double h = KM2M(cut.v().length()) / n; // шаг в метрах
 	
@@ -47,28 +143,30 @@ int Integral::take(struct itg_result &itg_res, E_PRINT_MODE pm)
 
 	// fitg << "dist(interval) = " << interval.length() << "\tdist_metr(interval) = " << dist_metr(interval) << endl;
 
-	Interpolation itp(cut.v(), wv);
-
-	if (cut.itp_diameter == -1)
-		itp.calc_radius();
-	if (cut.itp_diameter >= 0.0) 
-		itp.set_radius(cut.itp_diameter / 2);
-	if (cut.weight_coef >= 0.0) itp.set_weight_coef(cut.weight_coef);
+	setup_interpolation();
+	setup_coefs();
 
 	double lin_sum = 0.0;
 	double sqr_sum = 0.0;
 
 	int step_count = 0;
 
-	// fitg << cut.v().toString("station") << endl;
-	// fitg << "Point count (for n = " << n << "\th = " << h << "\th_m = " << h_m << "\tdx = " << dx << "\tdy = " << dy << ")\n\n";
+	nodes.clear();
 	for (int i = 0; i < n; ++i)
 	{
 		point gr1(cut.start.x + i * dx, cut.start.y + i * dy);
 		point gr2(cut.start.x + (i + 1) * dx, cut.start.y + (i + 1) * dy);
-		point gr_avr = vec(gr1, gr2).middle();
+		nodes.push_back(vec(gr1, gr2).middle());
+	}
+	itp.take_for(nodes, node_vel);
+	if (profile != NULL) profile->steps += nodes.size();
 
-		double velocity = itp.take_for(gr_avr);
+	// fitg << cut.v().toString("station") << endl;
+	// fitg << "Point count (for n = " << n << "\th = " << h << "\th_m = " << h_m << "\tdx = " << dx << "\tdy = " << dy << ")\n\n";
+	for (int i = 0; i < n; ++i)
+	{
+		const point &gr_avr = nodes[i];
+		double velocity = node_vel[i];
 
 		++step_count;
 
@@ -76,56 +174,264 @@ int Integral::take(struct itg_result &itg_res, E_PRINT_MODE pm)
 		prnd.shorten(velocity * len_K);
 
 		if (pm == EPM_ON)
-			fitp << prnd.at_geo_cs(dcs_origin).toGlanceFormat();
+			write_glance(fitp, prnd.at_geo_cs(dcs_origin));
 
 		// fitg << "\t\t" << prnd.toString("avr vec") << endl;
 
-		double coriolis = coriolis_koef(gr_avr.at_geo_cs(dcs_origin).y);
-
-		double curv_K = 0.;
+		double coriolis = coefs.coriolis(gr_avr);
 		// учёт кривизны потока
-		if (cut.curvature_correction == true)
-			curv_K = 1 / KM2M(cut.curvature_center.distance_to(gr_avr)); 
+		double curv_K = coefs.curvature_koef(gr_avr, (i + 0.5) / n);
 
 		lin_sum += coriolis * velocity * h;
 		sqr_sum += curv_K * velocity * velocity * h * sign(velocity);
 	}
 	// fitg << endl;
 
-	std::vector <double> itp_acr;	// точность интерполяции
+	calc_accuracy(itg_res);
 
-	itp.calc_accuracy(itp_acr);
+	itg_res.step_size = h;
+	itg_res.step_count = step_count;
 
-	int count = itp_acr.size();
+	itg_res.lin_value = lin_sum;
+	itg_res.sqr_value = sqr_sum;
 
-	double acr_sum = 0.0;
-	double acr2_sum = 0.0;
-	for (int i = 0; i < count; ++i)
+	if (pm == EPM_ON)
 	{
-		acr_sum += itp_acr[i];
-		acr2_sum += itp_acr[i] * itp_acr[i];
+		write_glance(fitp, cut.v().at_geo_cs(dcs_origin));
+		fitp.close();
+	}
+
+	return EC_ITG_SUCCESS;
+}
 
+int Integral::take(const std::vector <double> &weight_coefs, std::vector <itg_result> &res)
+{
+	if (wv.size() < MIN_POINT_COUNT)
+	{
+		std::cerr << "Error: not enough data to calculate the integral\n";
+		return EC_ITG_NOT_ENOUGH_DATA;
 	}
-	// cout << "sum of sq is" << acr2_sum << "\t" << count <<  endl;
-	itg_res.interpolation_accuracy = acr_sum / count;
-	itg_res.integration_error = sqrt(acr2_sum / count) /** interval.length() * GR*/;
 
-	double msd_sum = 0.0;
-	for (int i = 0; i < count; ++i)
-		msd_sum += (itg_res.interpolation_accuracy - itp_acr[i]) * (itg_res.interpolation_accuracy - itp_acr[i]);
-	itg_res.ms_deviation = sqrt(msd_sum / count );
+	// узлы и суммы - как в take для одного коэффициента
+	double h = KM2M(cut.v().length()) / n;
+	double dx = (cut.end.x - cut.start.x) / n;
+	double dy = (cut.end.y - cut.start.y) / n;
 
-	itg_res.step_size = h;
-	itg_res.step_count = step_count;
-	itg_res.itp_diameter = itp.get_radius() * 2;
-	itg_res.weight_coef = itp.get_weight_coef();	
+	setup_interpolation();
+	setup_coefs();
 
-	itg_res.lin_value = lin_sum;
-	itg_res.sqr_value = sqr_sum;
+	nodes.clear();
+	for (int i = 0; i < n; ++i)
+	{
+		point gr1(cut.start.x + i * dx, cut.start.y + i * dy);
+		point gr2(cut.start.x + (i + 1) * dx, cut.start.y + (i + 1) * dy);
+		nodes.push_back(vec(gr1, gr2).middle());
+	}
+	itp.take_for(nodes, weight_coefs, node_vel);
+	if (profile != NULL) profile->steps += nodes.size();
+
+	size_t m = weight_coefs.size();
+	std::vector <double> lin_sum(m, 0.0), sqr_sum(m, 0.0);
+	for (int i = 0; i < n; ++i)
+	{
+		double coriolis = coefs.coriolis(nodes[i]);
+		double curv_K = coefs.curvature_koef(nodes[i], (i + 0.5) / n);
+		for (size_t c = 0; c < m; ++c)
+		{
+			double velocity = node_vel[i * m + c];
+			lin_sum[c] += coriolis * velocity * h;
+			sqr_sum[c] += curv_K * velocity * velocity * h * sign(velocity);
+		}
+	}
+
+	ProfileTimer timer(profile, EPP_ACCURACY);
+	itp.calc_accuracy(weight_coefs, coef_acr);
+	timer.stop();
+
+	res.assign(m, itg_result());
+	for (size_t c = 0; c < m; ++c)
+	{
+		accuracy_stats(coef_acr[c], res[c]);
+		res[c].weight_coef = weight_coefs[c];
+		res[c].step_size = h;
+		res[c].step_count = n;
+		res[c].lin_value = lin_sum[c];
+		res[c].sqr_value = sqr_sum[c];
+	}
+
+	return EC_ITG_SUCCESS;
+}
+
+int Integral::take_profile(int count, int per_segment, std::vector <double> &value)
+{
+	if (wv.size() < MIN_POINT_COUNT)
+	{
+		std::cerr << "Error: not enough data to calculate the integral\n";
+		return EC_ITG_NOT_ENOUGH_DATA;
+	}
+
+	n = count * per_segment;
+	double h = KM2M(cut.v().length()) / n; // шаг в метрах
+
+	double dx = (cut.end.x - cut.start.x) / n;
+	double dy = (cut.end.y - cut.start.y) / n;
+
+	setup_interpolation();
+	setup_coefs();
+
+	// узлы - как в take
+	nodes.clear();
+	for (int i = 0; i < n; ++i)
+	{
+		point gr1(cut.start.x + i * dx, cut.start.y + i * dy);
+		point gr2(cut.start.x + (i + 1) * dx, cut.start.y + (i + 1) * dy);
+		nodes.push_back(vec(gr1, gr2).middle());
+	}
+	itp.take_for(nodes, node_vel);
+	if (profile != NULL) profile->steps += nodes.size();
+
+	value.assign(count + 1, 0.0);
+	double lin_sum = 0.0;
+	double sqr_sum = 0.0;
+	for (int i = 0; i < n; ++i)
+	{
+		double coriolis = coefs.coriolis(nodes[i]);
+		double curv_K = coefs.curvature_koef(nodes[i], (i + 0.5) / n);
+		double velocity = node_vel[i];
+
+		lin_sum += coriolis * velocity * h;
+		sqr_sum += curv_K * velocity * velocity * h * sign(velocity);
+
+		if ((i + 1) % per_segment == 0)
+			value[(i + 1) / per_segment] = lin_sum + sqr_sum;
+	}
+
+	return EC_ITG_SUCCESS;
+}
+
+point Integral::node(int j, int count)
+{
+	return point(cut.start.x + j * (cut.end.x - cut.start.x) / count, 
+				 cut.start.y + j * (cut.end.y - cut.start.y) / count);
+}
+
+void Integral::integrand(const point &pt, double t, double velocity, double &lin, double &sqr)
+{
+	double coriolis = coefs.coriolis(pt);
+	// учёт кривизны потока
+	double curv_K = coefs.curvature_koef(pt, t);
+
+	lin = coriolis * velocity;
+	sqr = curv_K * velocity * velocity * sign(velocity);
+}
+
+void Integral::print_node(const point &pt, double velocity, double len_K)
+{
+	vec prnd = Line(cut.v()).perpendicular(pt);
+	prnd.shorten(velocity * len_K);
+	write_glance(fitp, prnd.at_geo_cs(dcs_origin));
+}
+
+int Integral::take_adaptive(struct itg_result &itg_res, struct itg_result &coarse, double lin_tolerance, 
+							E_PRINT_MODE pm)
+{
+	if (wv.size() < MIN_POINT_COUNT)
+	{
+		std::cerr << "Error: not enough data to calculate the integral\n";
+		return EC_ITG_NOT_ENOUGH_DATA;
+	}
+
+	setup_interpolation();
+	setup_coefs();
+
+	double length = KM2M(cut.v().length()); // длина разреза в метрах
+	int count = ITG_START_FACTOR * wv.size(); // количество интервалов
+
+	// суммы значений подынтегральных функций в концах разреза и во внутренних узлах
+	double lin_ends = 0.0, sqr_ends = 0.0, lin_inner = 0.0, sqr_inner = 0.0;
+	std::vector <double> grid_vel; // скорости в узлах сетки (только для вывода)
+
+	nodes.clear();
+	for (int j = 0; j <= count; ++j)
+		nodes.push_back(node(j, count));
+	itp.take_for(nodes, node_vel);
+	if (profile != NULL) profile->steps += nodes.size();
+
+	for (int j = 0; j <= count; ++j)
+	{
+		double lin, sqr;
+		integrand(nodes[j], (double)j / count, node_vel[j], lin, sqr);
+		if (j == 0 || j == count)
+			lin_ends += lin, sqr_ends += sqr;
+		else
+			lin_inner += lin, sqr_inner += sqr;
+	}
+	if (pm == EPM_ON) grid_vel = node_vel;
+
+	double h = length / count;
+	double lin_value = h * (lin_ends / 2 + lin_inner), sqr_value = h * (sqr_ends / 2 + sqr_inner);
+	int level = 0;
+
+	ProfileTimer refinement_timer(profile, EPP_SECOND_PASS);
+	do
+	{
+		// новые узлы - середины интервалов текущей сетки, прежние узлы сохраняются
+		coarse.lin_value = lin_value, coarse.sqr_value = sqr_value;
+		coarse.step_size = h, coarse.step_count = count;
+		coarse.refinement_level = level;
+
+		nodes.clear();
+		for (int i = 0; i < count; ++i)
+			nodes.push_back(node(2 * i + 1, 2 * count));
+		itp.take_for(nodes, node_vel);
+		if (profile != NULL) profile->steps += nodes.size();
+
+		std::vector <double> refined_vel;
+		for (int i = 0; i < count; ++i)
+		{
+			double lin, sqr;
+			integrand(nodes[i], (2. * i + 1) / (2 * count), node_vel[i], lin, sqr);
+			lin_inner += lin, sqr_inner += sqr;
+			if (pm == EPM_ON)
+			{
+				refined_vel.push_back(grid_vel[i]);
+				refined_vel.push_back(node_vel[i]);
+			}
+		}
+		if (pm == EPM_ON)
+		{
+			refined_vel.push_back(grid_vel[count]);
+			grid_vel.swap(refined_vel);
+		}
+
+		count *= 2;
+		h = length / count;
+		lin_value = h * (lin_ends / 2 + lin_inner), sqr_value = h * (sqr_ends / 2 + sqr_inner);
+		++level;
+	}
+	while (fabs(lin_value - coarse.lin_value) >= lin_tolerance && level < ITG_MAX_LEVEL);
+	refinement_timer.stop();
+
+	calc_accuracy(itg_res);
+	coarse.interpolation_accuracy = itg_res.interpolation_accuracy;
+	coarse.integration_error = itg_res.integration_error;
+	coarse.ms_deviation = itg_res.ms_deviation;
+	coarse.itp_diameter = itg_res.itp_diameter;
+	coarse.weight_coef = itg_res.weight_coef;
+
+	itg_res.step_size = h;
+	itg_res.step_count = count;
+	itg_res.lin_value = lin_value;
+	itg_res.sqr_value = sqr_value;
+	itg_res.refinement_level = level;
 
 	if (pm == EPM_ON)
 	{
-		fitp << cut.v().at_geo_cs(dcs_origin).toGlanceFormat();
+		movement first = field.at(wv[0].idx);
+		double len_K = first.mv.length() / first.velocity;
+		for (int j = 0; j <= count; ++j)
+			print_node(node(j, count), grid_vel[j], len_K);
+		write_glance(fitp, cut.v().at_geo_cs(dcs_origin));
 		fitp.close();
 	}
 
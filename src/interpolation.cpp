@@ -1,26 +1,214 @@
 #include "interpolation.h"
 
+double Interpolation::along(const point &pt)
+{
+	return (pt.x - interval.start.x) * dir.x + (pt.y - interval.start.y) * dir.y;
+}
+
+void Interpolation::sort_projections()
+{
+	double len = interval.length();
+	dir = (len > 0.0) ? point((interval.end.x - interval.start.x) / len, 
+							  (interval.end.y - interval.start.y) / len) : point(0., 0.);
+
+	std::vector <double> t(wv.size());
+	order.resize(wv.size());
+	for (size_t j = 0; j < wv.size(); ++j)
+	{
+		t[j] = along(wv[j].proj);
+		order[j] = j;
+	}
+	std::stable_sort(order.begin(), order.end(), [&t](int a, int b) { return t[a] < t[b]; });
+
+	// нормальные компоненты и проекции считаются один раз на коридор
+	rank.resize(order.size());
+	pos.resize(order.size());
+	prj.resize(order.size());
+	nc.resize(order.size());
+	prj_x.resize(order.size());
+	prj_y.resize(order.size());
+	for (size_t k = 0; k < order.size(); ++k)
+	{
+		rank[order[k]] = k;
+		pos[k] = t[order[k]];
+		prj[k] = wv[order[k]].proj;
+		nc[k] = get_norm_comp(order[k]);
+		prj_x[k] = prj[k].x;
+		prj_y[k] = prj[k].y;
+	}
+}
+
+void Interpolation::calc_loo_errors()
+{
+	loo_err.assign(pos.size(), 0.0);
+	loo_R = R, loo_weight_coef = weight_coef, loo_precision = precision;
+
+	std::vector <int> act_p_ind;
+	double self_weight = weight_func(0.0);
+
+	// точки упорядочены вдоль разреза, поэтому окно соседей [lo, hi) только сдвигается вперёд
+	size_t lo = 0, hi = 0, visited = 0;
+	for (size_t k = 0; k < pos.size(); ++k)
+	{
+		while (pos[lo] < pos[k] - R - EPS) ++lo;
+		while (hi < pos.size() && pos[hi] <= pos[k] + R + EPS) ++hi;
+		visited += hi - lo;
+
+		// суммы по всей окрестности, включая саму точку
+		double S = 0.0, V = 0.0;
+		if (precision == EPR_FAST)
+			weight_window(kernel_args(prj[k]), &prj_x[lo], &prj_y[lo], &nc[lo], hi - lo, S, V);
+		else
+			for (size_t j = lo; j < hi; ++j)
+			{
+				double r = prj[k].distance_to(prj[j]);
+				if (r <= R)
+				{
+					double wf = weight_func(r);
+					S += wf;
+					V += nc[j] * wf;
+				}
+			}
+
+		// исключение своего веса; при малом остатке - прямой пересчёт без точки
+		S -= self_weight;
+		V -= nc[k] * self_weight;
+		if (S <= LOO_CANCEL_RATIO * (S + self_weight))
+		{
+			act_p_ind.clear();
+			S = calc_weight_sum(act_p_ind, prj[k], k);
+			loo_err[k] = get_interpolation_result(act_p_ind, prj[k], S) - nc[k];
+		}
+		else
+			loo_err[k] = V / S - nc[k];
+	}
+	if (profile != NULL)
+		profile->neighbours += visited;
+}
+
+void Interpolation::calc_loo_errors(const std::vector <double> &coefs)
+{
+	size_t count = pos.size(), m = coefs.size();
+	loo_multi_err.assign(m * count, 0.0);
+	loo_multi_coefs = coefs, loo_multi_R = R, loo_multi_precision = precision;
+
+	std::vector <double> k, cut, S(m), V(m);
+	coef_constants(coefs, k, cut);
+
+	std::vector <int> act_p_ind;
+	double own_coef = weight_coef, own_cutoff = cutoff;
+
+	// окно соседей - как в calc_loo_errors для одного коэффициента
+	size_t lo = 0, hi = 0, visited = 0;
+	for (size_t p = 0; p < count; ++p)
+	{
+		while (pos[lo] < pos[p] - R - EPS) ++lo;
+		while (hi < count && pos[hi] <= pos[p] + R + EPS) ++hi;
+		visited += hi - lo;
+
+		if (precision == EPR_FAST)
+			for (size_t c0 = 0; c0 < m; c0 += WK_MAX_COEFS)
+			{
+				weight_multi_args a;
+				a.px = prj[p].x, a.py = prj[p].y, a.R2 = R * R;
+				a.m = std::min(m - c0, (size_t)WK_MAX_COEFS);
+				for (int c = 0; c < a.m; ++c)
+					a.k[c] = k[c0 + c], a.cutoff[c] = cut[c0 + c];
+				weight_window_multi(a, &prj_x[lo], &prj_y[lo], &nc[lo], hi - lo, &S[c0], &V[c0]);
+			}
+		else
+		{
+			std::fill(S.begin(), S.end(), 0.0);
+			std::fill(V.begin(), V.end(), 0.0);
+			for (size_t j = lo; j < hi; ++j)
+			{
+				double r = prj[p].distance_to(prj[j]);
+				if (r <= R)
+					for (size_t c = 0; c < m; ++c)
+					{
+						double wf = exp(- k[c] * r * r) - cut[c];
+						S[c] += wf;
+						V[c] += nc[j] * wf;
+					}
+			}
+		}
+
+		for (size_t c = 0; c < m; ++c)
+		{
+			double self_weight = exp(- k[c] * 0.0 * 0.0) - cut[c];
+			double s = S[c] - self_weight, v = V[c] - nc[p] * self_weight;
+			if (s <= LOO_CANCEL_RATIO * (s + self_weight))
+			{
+				// прямой пересчёт без точки - с постоянными коэффициента c
+				weight_coef = k[c], cutoff = cut[c];
+				act_p_ind.clear();
+				s = calc_weight_sum(act_p_ind, prj[p], p);
+				loo_multi_err[c * count + p] = get_interpolation_result(act_p_ind, prj[p], s) - nc[p];
+				weight_coef = own_coef, cutoff = own_cutoff;
+			}
+			else
+				loo_multi_err[c * count + p] = v / s - nc[p];
+		}
+	}
+	if (profile != NULL)
+		profile->neighbours += visited;
+}
+
+void Interpolation::update_cutoff()
+{
+	cutoff = (precision == EPR_FAST) ? fast_exp(- weight_coef * R * R) : exp(- weight_coef * R * R);
+}
+
+weight_kernel_args Interpolation::kernel_args(const point &pt)
+{
+	weight_kernel_args a;
+	a.px = pt.x, a.py = pt.y;
+	a.k = weight_coef;
+	a.R2 = R * R;
+	a.cutoff = cutoff;
+	return a;
+}
+
+void Interpolation::coef_constants(const std::vector <double> &coefs, std::vector <double> &k, 
+								   std::vector <double> &cut)
+{
+	// те же операции, что в set_weight_coef и update_cutoff
+	k.resize(coefs.size());
+	cut.resize(coefs.size());
+	for (size_t c = 0; c < coefs.size(); ++c)
+	{
+		k[c] = coefs[c] * WEIGHT_COEF_TRANSFORM;
+		cut[c] = (precision == EPR_FAST) ? fast_exp(- k[c] * R * R) : exp(- k[c] * R * R);
+	}
+}
+
 double Interpolation::get_norm_comp(int idx)
 {
 	Line cut_line(interval);
-	double ang = cut_line.angle(wv[idx].mvn.mv);
-	return wv[idx].mvn.velocity * -sin(ang * M_PI / 180);
+	movement m = field.at(wv[idx].idx);
+	double ang = cut_line.angle(m.mv);
+	return m.velocity * -sin(ang * M_PI / 180);
 }
 
 double Interpolation::weight_func(double r)
 {
-	return exp(- weight_coef * r * r) - exp(- weight_coef * R * R);
+	return exp(- weight_coef * r * r) - cutoff;
 }
 
-double Interpolation::calc_weight_sum(std::vector <int> &idx, point pt, int omit_idx = -1)
+double Interpolation::calc_weight_sum(std::vector <int> &idx, const point &pt, int omit_pos = -1)
 {
 	double S = 0.0;
-	for (size_t j = 0; j < wv.size(); ++j)
+
+	// проекции лежат на разрезе, поэтому соседи в радиусе R образуют непрерывное окно 
+	// в отсортированном порядке; EPS - запас на ошибки округления координат
+	double t = along(pt);
+	int k = std::lower_bound(pos.begin(), pos.end(), t - R - EPS) - pos.begin();
+	for (; k < (int)pos.size() && pos[k] <= t + R + EPS; ++k)
 	{
-		double r = pt.distance_to(wv[j].proj);
-		if ((size_t)omit_idx != j && r <= R /*/ 2*/)
+		double r = pt.distance_to(prj[k]);
+		if (omit_pos != k && r <= R /*/ 2*/)
 		{
-			idx.push_back(j);
+			idx.push_back(k);
 			double wf = weight_func(r);
 			// cout << "for r = " << r << " weight func is " << wf << endl;
 			S += wf;
@@ -32,7 +220,7 @@ double Interpolation::calc_weight_sum(std::vector <int> &idx, point pt, int omit
 	return S;
 }
 
-double Interpolation::get_interpolation_result(std::vector <int> &idx, point pt, double sum)
+double Interpolation::get_interpolation_result(std::vector <int> &idx, const point &pt, double sum)
 {
 	if (sum == 0.0) return 0.0;
 
@@ -40,21 +228,31 @@ double Interpolation::get_interpolation_result(std::vector <int> &idx, point pt,
 	// flog << "sum elemnts\t";
 	for (size_t i = 0; i < idx.size(); ++i)
 	{
-		double r = pt.distance_to(wv[idx[i]].proj);
-		// double ang = cut_line.angle(wv[idx[i]].mvn.mv);
-		// cout << "get_norm_comp(idx[i]) = " << get_norm_comp(idx[i]) << endl;
-		val += get_norm_comp(idx[i]) * weight_func(r) / sum;
+		double r = pt.distance_to(prj[idx[i]]);
+		val += nc[idx[i]] * weight_func(r) / sum;
 		// flog << d << "," << r << ":" << func(r) << "," << func(r) / S << " ";
-		// flog << get_norm_comp(idx[i]) * weight_func(r) / sum << " ";
 	}
 	return val;
 }
 
-Interpolation::Interpolation(vec itv, std::vector <wvector> &_wv) : weight_coef(WEIGHT_COEF / WEIGHT_COEF_TRANSFORM), interval(itv), wv(_wv)
+Interpolation::Interpolation(const vec &itv, const std::vector <wvector> &_wv, const FieldStore &f) : 
+	weight_coef(WEIGHT_COEF / WEIGHT_COEF_TRANSFORM), interval(itv), wv(_wv), field(f), precision(EPR_EXACT), 
+	profile(NULL)
 {
 	R = itv.length();
+	loo_R = loo_weight_coef = loo_multi_R = -1.0;
+	loo_precision = loo_multi_precision = precision;
+	update_cutoff();
+	sort_projections();
 }
 
+void Interpolation::set_interval(const vec &itv)
+{
+	interval = itv;
+	sort_projections();
+	loo_err.clear();
+	loo_multi_err.clear();
+}
 void Interpolation::calc_radius()
 {
 	double res;
@@ -72,18 +270,31 @@ void Interpolation::calc_radius()
 		res = std::max(res, dist[i] - dist[i - 1]);
 	}
 	R = res * 1.5;
+	update_cutoff();
 }
 
 void Interpolation::set_radius(double _r)
 {
 	R = _r;
+	update_cutoff();
 }
 
 void Interpolation::set_weight_coef(double coef)
 {
 	weight_coef = coef * WEIGHT_COEF_TRANSFORM;
+	update_cutoff();
+}
+
+void Interpolation::set_precision_mode(E_PRECISION_MODE mode)
+{
+	precision = mode;
+	update_cutoff();
 }
 
+void Interpolation::set_profile(cut_profile *p)
+{
+	profile = p;
+}
 
 double Interpolation::get_radius()
 {
@@ -95,6 +306,11 @@ double Interpolation::get_weight_coef()
 	return weight_coef / WEIGHT_COEF_TRANSFORM;
 }
 
+double Interpolation::default_weight_coef()
+{
+	return WEIGHT_COEF / WEIGHT_COEF_TRANSFORM / WEIGHT_COEF_TRANSFORM;
+}
+
 double Interpolation::take_for(point pt)
 {
 
@@ -110,27 +326,171 @@ double Interpolation::take_for(point pt)
 	return val;
 }
 
-void Interpolation::calc_accuracy(std::vector <double> &err)
+double Interpolation::window_value(const point &pt, size_t lo, size_t hi)
 {
-	std::vector <int> act_p_ind;
+	if (precision == EPR_FAST)
+	{
+		double S, V;
+		weight_window(kernel_args(pt), &prj_x[lo], &prj_y[lo], &nc[lo], hi - lo, S, V);
+		return (S == 0.0) ? 0.0 : V / S;
+	}
+
+	// те же соседи и порядок суммирования, что в calc_weight_sum и get_interpolation_result
+	win_w.clear();
+	double S = 0.0;
+	for (size_t k = lo; k < hi; ++k)
+	{
+		double r = pt.distance_to(prj[k]);
+		if (r <= R)
+		{
+			double wf = weight_func(r);
+			win_w.push_back(wf);
+			S += wf;
+		}
+		else
+			win_w.push_back(-1.0); // не сосед (вес соседа не отрицателен)
+	}
+	if (S == 0.0) return 0.0;
+
+	double val = 0.0;
+	for (size_t k = lo; k < hi; ++k)
+		if (win_w[k - lo] >= 0.0)
+			val += nc[k] * win_w[k - lo] / S;
+	return val;
+}
+
+void Interpolation::take_for(const std::vector <point> &pts, std::vector <double> &vals)
+{
+	vals.resize(pts.size());
+
+	size_t lo = 0, hi = 0, visited = 0;
+	double t_prev = -std::numeric_limits <double>::infinity();
+	for (size_t i = 0; i < pts.size(); ++i)
+	{
+		double t = along(pts[i]);
+		// при обратном ходе окно ищется заново
+		if (t < t_prev)
+			lo = hi = std::lower_bound(pos.begin(), pos.end(), t - R - EPS) - pos.begin();
+		t_prev = t;
+
+		while (lo < pos.size() && pos[lo] < t - R - EPS) ++lo;
+		hi = std::max(hi, lo);
+		while (hi < pos.size() && pos[hi] <= t + R + EPS) ++hi;
+
+		vals[i] = window_value(pts[i], lo, hi);
+		visited += hi - lo;
+	}
+	if (profile != NULL)
+		profile->neighbours += visited;
+}
 
-	std::vector <double> vl;
-	std::vector <double> nc;
-	std::vector <double> sum;
+void Interpolation::calc_accuracy(std::vector <double> &err)
+{
+	if (loo_err.size() != wv.size() || loo_R != R || loo_weight_coef != weight_coef || 
+		loo_precision != precision)
+		calc_loo_errors();
 
 	for (size_t i = 0; i < wv.size(); ++i)
+		err.push_back(loo_err[rank[i]]);
+
+}
+
+void Interpolation::window_values(const point &pt, size_t lo, size_t hi, const double *k, const double *cut, 
+								  int m, double *vals)
+{
+	if (precision == EPR_FAST)
 	{
-		act_p_ind.clear();
+		for (int c0 = 0; c0 < m; c0 += WK_MAX_COEFS)
+		{
+			weight_multi_args a;
+			a.px = pt.x, a.py = pt.y, a.R2 = R * R;
+			a.m = std::min(m - c0, WK_MAX_COEFS);
+			for (int c = 0; c < a.m; ++c)
+				a.k[c] = k[c0 + c], a.cutoff[c] = cut[c0 + c];
 
-		double S = calc_weight_sum(act_p_ind, wv[i].proj, i);
-	
-		double val = get_interpolation_result(act_p_ind, wv[i].proj, S);
+			double S[WK_MAX_COEFS], V[WK_MAX_COEFS];
+			weight_window_multi(a, &prj_x[lo], &prj_y[lo], &nc[lo], hi - lo, S, V);
+			for (int c = 0; c < a.m; ++c)
+				vals[c0 + c] = (S[c] == 0.0) ? 0.0 : V[c] / S[c];
+		}
+		return;
+	}
 
-		err.push_back(val - get_norm_comp(i));
+	// расстояния - один раз на окно, суммы по каждому коэффициенту - как в window_value
+	win_r.clear();
+	for (size_t j = lo; j < hi; ++j)
+	{
+		double r = pt.distance_to(prj[j]);
+		win_r.push_back((r <= R) ? r : -1.0);
+	}
+	for (int c = 0; c < m; ++c)
+	{
+		win_w.clear();
+		double S = 0.0;
+		for (size_t j = lo; j < hi; ++j)
+		{
+			double r = win_r[j - lo];
+			if (r >= 0.0)
+			{
+				double wf = exp(- k[c] * r * r) - cut[c];
+				win_w.push_back(wf);
+				S += wf;
+			}
+			else
+				win_w.push_back(-1.0);
+		}
+		if (S == 0.0)
+		{
+			vals[c] = 0.0;
+			continue;
+		}
+
+		double val = 0.0;
+		for (size_t j = lo; j < hi; ++j)
+			if (win_w[j - lo] >= 0.0)
+				val += nc[j] * win_w[j - lo] / S;
+		vals[c] = val;
+	}
+}
+
+void Interpolation::take_for(const std::vector <point> &pts, const std::vector <double> &coefs, 
+							 std::vector <double> &vals)
+{
+	size_t m = coefs.size();
+	vals.resize(pts.size() * m);
+	std::vector <double> k, cut;
+	coef_constants(coefs, k, cut);
 
-		vl.push_back(val);
-		nc.push_back(get_norm_comp(i));
-		sum.push_back(S);
+	// окно соседей - как в take_for для одного коэффициента
+	size_t lo = 0, hi = 0, visited = 0;
+	double t_prev = -std::numeric_limits <double>::infinity();
+	for (size_t i = 0; i < pts.size(); ++i)
+	{
+		double t = along(pts[i]);
+		if (t < t_prev)
+			lo = hi = std::lower_bound(pos.begin(), pos.end(), t - R - EPS) - pos.begin();
+		t_prev = t;
+
+		while (lo < pos.size() && pos[lo] < t - R - EPS) ++lo;
+		hi = std::max(hi, lo);
+		while (hi < pos.size() && pos[hi] <= t + R + EPS) ++hi;
+
+		window_values(pts[i], lo, hi, k.data(), cut.data(), m, &vals[i * m]);
+		visited += hi - lo;
 	}
+	if (profile != NULL)
+		profile->neighbours += visited;
+}
 
-}
\ No newline at end of file
+void Interpolation::calc_accuracy(const std::vector <double> &coefs, std::vector <std::vector <double> > &err)
+{
+	if (loo_multi_err.size() != coefs.size() * wv.size() || loo_multi_coefs != coefs || loo_multi_R != R || 
+		loo_multi_precision != precision)
+		calc_loo_errors(coefs);
+
+	size_t count = wv.size();
+	err.assign(coefs.size(), std::vector <double>());
+	for (size_t c = 0; c < coefs.size(); ++c)
+		for (size_t i = 0; i < count; ++i)
+			err[c].push_back(loo_multi_err[c * count + rank[i]]);
+}
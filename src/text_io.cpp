@@ -0,0 +1,311 @@
+#include "text_io.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+////////////////////////////////////////////////////////////////////////////////
+// ---------------------------- TextReader class -----------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+TextReader::TextReader(const char *file_name) : buffer(TIO_BLOCK_SIZE), begin(0), end(0), eof(false)
+{
+	file = fopen(file_name, "rb");
+}
+
+TextReader::~TextReader()
+{
+	if (file != NULL) fclose(file);
+}
+
+bool TextReader::is_open() const
+{
+	return file != NULL;
+}
+
+bool TextReader::next_line(const char *&first, const char *&last)
+{
+	if (file == NULL) return false;
+
+	for (;;)
+	{
+		const char *p = buffer.data() + begin, *e = buffer.data() + end;
+		const char *nl = (const char *)memchr(p, '\n', e - p);
+		if (nl != NULL)
+		{
+			first = p, last = nl;
+			begin = nl + 1 - buffer.data();
+			return true;
+		}
+		if (eof)
+		{
+			if (begin == end) return false;
+			// последняя строка без перевода строки
+			first = p, last = e;
+			begin = end;
+			return true;
+		}
+
+		// незаконченная строка переносится в начало буфера, буфер растёт только под длинную строку
+		memmove(buffer.data(), p, end - begin);
+		end -= begin, begin = 0;
+		if (end == buffer.size())
+			buffer.resize(buffer.size() * 2);
+
+		size_t got = fread(buffer.data() + end, 1, buffer.size() - end, file);
+		end += got;
+		if (got == 0) eof = true;
+	}
+}
+
+static inline const char *skip_spaces(const char *p, const char *last)
+{
+	while (p < last && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\v' || *p == '\f')) ++p;
+	return p;
+}
+
+bool is_blank(const char *p, const char *last)
+{
+	return skip_spaces(p, last) == last;
+}
+
+bool parse_number(const char *&p, const char *last, double &v)
+{
+	const char *s = skip_spaces(p, last);
+	// from_chars не принимает знак '+', в отличие от потока
+	if (s < last && *s == '+' && s + 1 < last && *(s + 1) != '-') ++s;
+	std::from_chars_result r = std::from_chars(s, last, v);
+	if (r.ec != std::errc()) return false;
+	p = r.ptr;
+	return true;
+}
+
+bool parse_number(const char *&p, const char *last, int &v)
+{
+	const char *s = skip_spaces(p, last);
+	if (s < last && *s == '+' && s + 1 < last && *(s + 1) != '-') ++s;
+	std::from_chars_result r = std::from_chars(s, last, v);
+	if (r.ec != std::errc()) return false;
+	p = r.ptr;
+	return true;
+}
+
+// необязательные столбцы разреза после параметров: центр кривизны (2 числа) и/или допуск интегрирования
+static void parse_cut_tail(const char *&p, const char *last, const vec &v, double cut_width, double itp_diameter, 
+						   double weight_coef, scut &cut)
+{
+	double opt[3];
+	int opt_count = 0;
+	while (opt_count < 3 && parse_number(p, last, opt[opt_count]))
+		++opt_count;
+
+	if (opt_count >= 2)
+		cut = scut(v, cut_width, itp_diameter, weight_coef, point(opt[0], opt[1]));
+	else
+		cut = scut(v, cut_width, itp_diameter, weight_coef);
+	if (opt_count == 1 || opt_count == 3)
+		cut.itg_tolerance = opt[opt_count - 1];
+}
+
+bool parse_cut(const char *&p, const char *last, scut &cut)
+{
+	double gsx, gsy, gex, gey, cut_width, itp_diameter, weight_coef;
+	if (!(parse_number(p, last, gsx) && parse_number(p, last, gsy) && parse_number(p, last, gex) &&
+		  parse_number(p, last, gey) && parse_number(p, last, cut_width) && 
+		  parse_number(p, last, itp_diameter) && parse_number(p, last, weight_coef)))
+		return false;
+
+	vec v(point(gsx, gsy), point(gex, gey));
+
+	parse_cut_tail(p, last, v, cut_width, itp_diameter, weight_coef, cut);
+	return true;
+}
+
+bool parse_movement(const char *&p, const char *last, movement &m, int *pixels)
+{
+	double gsx, gsy, gex, gey, crl, vlc, err;
+	int psx, psy, pex, pey;
+	if (!(parse_number(p, last, gsx) && parse_number(p, last, gsy) && parse_number(p, last, gex) &&
+		  parse_number(p, last, gey) && parse_number(p, last, psx) && parse_number(p, last, psy) &&
+		  parse_number(p, last, pex) && parse_number(p, last, pey) && parse_number(p, last, crl) &&
+		  parse_number(p, last, vlc) && parse_number(p, last, err)))
+		return false;
+
+	m = movement(vec(point(gsx, gsy), point(gex, gey)), vlc, err);
+	if (pixels != NULL)
+		pixels[0] = psx, pixels[1] = psy;
+	return true;
+}
+
+// список чисел через запятую
+static bool parse_list(const char *&p, const char *last, std::vector <double> &list)
+{
+	list.clear();
+	double v;
+	if (!parse_number(p, last, v))
+		return false;
+	list.push_back(v);
+	while (p < last && *p == ',')
+	{
+		++p;
+		if (!parse_number(p, last, v))
+			return false;
+		list.push_back(v);
+	}
+	return true;
+}
+
+bool parse_sweep(const char *&p, const char *last, scut &cut, sweep_grid &grid)
+{
+	double gsx, gsy, gex, gey;
+	if (!(parse_number(p, last, gsx) && parse_number(p, last, gsy) && parse_number(p, last, gex) &&
+		  parse_number(p, last, gey) && parse_list(p, last, grid.width) && 
+		  parse_list(p, last, grid.itp_diameter) && parse_list(p, last, grid.weight_coef)))
+		return false;
+
+	// в разрезе - первые значения списков
+	parse_cut_tail(p, last, vec(point(gsx, gsy), point(gex, gey)), grid.width[0], grid.itp_diameter[0], 
+				   grid.weight_coef[0], cut);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ---------------------------- TextWriter class -----------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+TextWriter::TextWriter() : file(NULL), memory(false), used(0) {}
+
+TextWriter::TextWriter(const char *file_name) : file(NULL), memory(false), used(0)
+{
+	open(file_name);
+}
+
+TextWriter::TextWriter(TextWriter &&other) : file(other.file), memory(other.memory), 
+	buffer(std::move(other.buffer)), used(other.used)
+{
+	other.file = NULL, other.memory = false, other.used = 0;
+}
+
+TextWriter::~TextWriter()
+{
+	close();
+}
+
+bool TextWriter::open(const char *file_name)
+{
+	close();
+	memory = false, used = 0;
+	// текстовый режим, как у std::ofstream
+	file = fopen(file_name, "w");
+	return file != NULL;
+}
+
+void TextWriter::open_memory()
+{
+	close();
+	memory = true, used = 0;
+}
+
+bool TextWriter::is_open() const
+{
+	return file != NULL || memory;
+}
+
+void TextWriter::flush()
+{
+	if (file == NULL) return;
+	if (used > 0)
+		fwrite(buffer.data(), 1, used, file);
+	used = 0;
+}
+
+void TextWriter::close()
+{
+	if (file == NULL) return;
+	flush();
+	fclose(file);
+	file = NULL;
+}
+
+void TextWriter::release(std::vector <char> &out)
+{
+	buffer.resize(used);
+	out.swap(buffer);
+	std::vector <char>().swap(buffer);
+	used = 0;
+	memory = false;
+}
+
+char *TextWriter::reserve(size_t size)
+{
+	// буфер растёт по мере вывода до TIO_BLOCK_SIZE, дальше сбрасывается в файл
+	// (в режиме памяти растёт без ограничения)
+	if (used + size > buffer.size() && buffer.size() >= TIO_BLOCK_SIZE && !memory)
+		flush();
+	if (used + size > buffer.size())
+	{
+		size_t grown = memory ? 2 * buffer.size() + 256 : std::min(2 * buffer.size() + 256, (size_t)TIO_BLOCK_SIZE);
+		buffer.resize(std::max(grown, used + size));
+	}
+	return buffer.data() + used;
+}
+
+// запись без открытого файла игнорируется, как и для закрытого std::ofstream
+TextWriter &TextWriter::operator<<(double v)
+{
+	if (!is_open()) return *this;
+	char *p = reserve(32);
+	used = std::to_chars(p, p + 32, v, std::chars_format::general, 6).ptr - buffer.data();
+	return *this;
+}
+
+TextWriter &TextWriter::operator<<(int v)
+{
+	if (!is_open()) return *this;
+	char *p = reserve(16);
+	used = std::to_chars(p, p + 16, v).ptr - buffer.data();
+	return *this;
+}
+
+TextWriter &TextWriter::operator<<(size_t v)
+{
+	if (!is_open()) return *this;
+	char *p = reserve(24);
+	used = std::to_chars(p, p + 24, v).ptr - buffer.data();
+	return *this;
+}
+
+TextWriter &TextWriter::operator<<(char c)
+{
+	if (!is_open()) return *this;
+	*reserve(1) = c;
+	++used;
+	return *this;
+}
+
+TextWriter &TextWriter::operator<<(const char *s)
+{
+	if (!is_open()) return *this;
+	size_t len = strlen(s);
+	memcpy(reserve(len), s, len);
+	used += len;
+	return *this;
+}
+
+TextWriter &TextWriter::put_fixed(double v)
+{
+	if (!is_open()) return *this;
+	// %f очень больших чисел длиннее 32 символов: запас на 308 цифр порядка
+	char *p = reserve(330);
+	used = std::to_chars(p, p + 330, v, std::chars_format::fixed, 6).ptr - buffer.data();
+	return *this;
+}
+
+void write_glance(TextWriter &out, const vec &v)
+{
+	out << "TYPE = VECTOR\tCOLOR = 14\tWIDTH = 1\tSCALE = 1.00\tGEO = (";
+	out.put_fixed(v.start.x) << ',';
+	out.put_fixed(v.start.y) << ' ';
+	out.put_fixed(v.end.x) << ',';
+	out.put_fixed(v.end.y) << ")\n";
+}
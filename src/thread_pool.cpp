@@ -0,0 +1,110 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(int thread_count) : queued(0), pending(0), next_queue(0), stop(false)
+{
+	if (thread_count < 1) thread_count = 1;
+
+	for (int w = 0; w < thread_count; ++w)
+		queues.push_back(std::unique_ptr <worker_queue>(new worker_queue));
+
+	for (int w = 0; w < thread_count; ++w)
+		threads.push_back(std::thread(&ThreadPool::run, this, w));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard <std::mutex> lock(mtx);
+		stop = true;
+	}
+	task_cv.notify_all();
+
+	for (size_t w = 0; w < threads.size(); ++w)
+		threads[w].join();
+}
+
+int ThreadPool::size() const
+{
+	return threads.size();
+}
+
+int ThreadPool::resolve_thread_count(int requested)
+{
+	if (requested > 0) return requested;
+	int hc = std::thread::hardware_concurrency();
+	return hc > 0 ? hc : 1;
+}
+
+void ThreadPool::submit(task t)
+{
+	size_t q;
+	{
+		std::lock_guard <std::mutex> lock(mtx);
+		q = next_queue++ % queues.size();
+		++pending;
+	}
+	{
+		// счётчик увеличивается до освобождения очереди, чтобы задачу нельзя было забрать раньше
+		std::lock_guard <std::mutex> q_lock(queues[q]->mtx);
+		queues[q]->tasks.push_back(std::move(t));
+		std::lock_guard <std::mutex> lock(mtx);
+		++queued;
+	}
+	task_cv.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock <std::mutex> lock(mtx);
+	done_cv.wait(lock, [this] { return pending == 0; });
+}
+
+bool ThreadPool::pop(int w, task &t)
+{
+	for (size_t k = 0; k < queues.size(); ++k)
+	{
+		worker_queue &q = *queues[(w + k) % queues.size()];
+		std::lock_guard <std::mutex> lock(q.mtx);
+		if (q.tasks.empty()) continue;
+
+		// своя очередь - с начала, в порядке постановки (упорядоченный вывод через ReorderBuffer
+		// получает результаты по мере готовности), чужие - с конца, дальше всего от их владельцев
+		if (k == 0)
+		{
+			t = std::move(q.tasks.front());
+			q.tasks.pop_front();
+		}
+		else
+		{
+			t = std::move(q.tasks.back());
+			q.tasks.pop_back();
+		}
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::run(int w)
+{
+	while (true)
+	{
+		task t;
+		if (pop(w, t))
+		{
+			{
+				std::lock_guard <std::mutex> lock(mtx);
+				--queued;
+			}
+			t(w);
+
+			std::lock_guard <std::mutex> lock(mtx);
+			if (--pending == 0)
+				done_cv.notify_all();
+			continue;
+		}
+
+		std::unique_lock <std::mutex> lock(mtx);
+		task_cv.wait(lock, [this] { return stop || queued > 0; });
+		if (stop && queued == 0) return;
+	}
+}
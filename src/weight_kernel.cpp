@@ -0,0 +1,319 @@
+#include "weight_kernel.h"
+
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DT_SIMD_X86
+#include <immintrin.h>
+#endif
+
+// разложение ln2 на старшую часть (точно умножаемую на n) и поправку, как в cephes
+#define FE_LOG2E 1.4426950408889634074
+#define FE_LN2_HI 6.93145751953125e-1
+#define FE_LN2_LO 1.42860682030941723212e-6
+
+// коэффициенты 1 / k! многочлена exp(f), от старшего к младшему
+static const double fe_poly[] = {
+	1. / 479001600, 1. / 39916800, 1. / 3628800, 1. / 362880, 1. / 40320, 1. / 5040, 1. / 720,
+	1. / 120, 1. / 24, 1. / 6, 1. / 2, 1., 1.
+};
+static const int fe_poly_size = sizeof(fe_poly) / sizeof(fe_poly[0]);
+
+const char *precision_mode_name(E_PRECISION_MODE mode)
+{
+	return (mode == EPR_FAST) ? "fast" : "exact";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ------------------------------- scalar path -------------------------------//
+////////////////////////////////////////////////////////////////////////////////
+
+// векторные версии повторяют те же операции без FMA, поэтому экспонента совпадает поэлементно
+double fast_exp(double x)
+{
+	if (x < FE_MIN_ARG) x = FE_MIN_ARG;
+
+	double n = nearbyint(x * FE_LOG2E);
+	double f = (x - n * FE_LN2_HI) - n * FE_LN2_LO;
+
+	double p = fe_poly[0];
+	for (int i = 1; i < fe_poly_size; ++i)
+		p = p * f + fe_poly[i];
+
+	return ldexp(p, (int)n);
+}
+
+static void weight_window_scalar(const weight_kernel_args &a, const double *x, const double *y,
+								 const double *nc, size_t n, double &S, double &V)
+{
+	for (size_t j = 0; j < n; ++j)
+	{
+		double dx = x[j] - a.px, dy = y[j] - a.py;
+		double r2 = dx * dx + dy * dy;
+		if (r2 <= a.R2)
+		{
+			double w = fast_exp(- a.k * r2) - a.cutoff;
+			S += w;
+			V += nc[j] * w;
+		}
+	}
+}
+
+static void weight_window_multi_scalar(const weight_multi_args &a, const double *x, const double *y,
+									   const double *nc, size_t n, double *S, double *V)
+{
+	for (size_t j = 0; j < n; ++j)
+	{
+		double dx = x[j] - a.px, dy = y[j] - a.py;
+		double r2 = dx * dx + dy * dy;
+		if (r2 <= a.R2)
+			for (int c = 0; c < a.m; ++c)
+			{
+				double w = fast_exp(- a.k[c] * r2) - a.cutoff[c];
+				S[c] += w;
+				V[c] += nc[j] * w;
+			}
+	}
+}
+
+#ifdef DT_SIMD_X86
+
+__attribute__((target("avx2")))
+static inline __m256d fast_exp_avx2(__m256d x)
+{
+	x = _mm256_max_pd(x, _mm256_set1_pd(FE_MIN_ARG));
+
+	__m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(FE_LOG2E)),
+								_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m256d f = _mm256_sub_pd(_mm256_sub_pd(x, _mm256_mul_pd(n, _mm256_set1_pd(FE_LN2_HI))),
+							  _mm256_mul_pd(n, _mm256_set1_pd(FE_LN2_LO)));
+
+	__m256d p = _mm256_set1_pd(fe_poly[0]);
+	for (int i = 1; i < fe_poly_size; ++i)
+		p = _mm256_add_pd(_mm256_mul_pd(p, f), _mm256_set1_pd(fe_poly[i]));
+
+	// 2^n: показатель степени записывается прямо в биты числа (n >= -1021, число нормально)
+	__m256i e = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n));
+	e = _mm256_slli_epi64(_mm256_add_epi64(e, _mm256_set1_epi64x(1023)), 52);
+	return _mm256_mul_pd(p, _mm256_castsi256_pd(e));
+}
+
+__attribute__((target("avx2")))
+static void weight_window_avx2(const weight_kernel_args &a, const double *x, const double *y,
+							   const double *nc, size_t n, double &S, double &V)
+{
+	const __m256d px = _mm256_set1_pd(a.px), py = _mm256_set1_pd(a.py);
+	const __m256d neg_k = _mm256_set1_pd(- a.k), R2 = _mm256_set1_pd(a.R2);
+	const __m256d cutoff = _mm256_set1_pd(a.cutoff);
+
+	__m256d s = _mm256_setzero_pd(), v = _mm256_setzero_pd();
+	size_t j = 0;
+	for (; j + 4 <= n; j += 4)
+	{
+		__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + j), px);
+		__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + j), py);
+		__m256d r2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+		__m256d m = _mm256_cmp_pd(r2, R2, _CMP_LE_OQ);
+		if (_mm256_movemask_pd(m) == 0) continue;
+
+		__m256d w = _mm256_and_pd(m, _mm256_sub_pd(fast_exp_avx2(_mm256_mul_pd(neg_k, r2)), cutoff));
+		s = _mm256_add_pd(s, w);
+		v = _mm256_add_pd(v, _mm256_mul_pd(_mm256_loadu_pd(nc + j), w));
+	}
+
+	double sl[4], vl[4];
+	_mm256_storeu_pd(sl, s);
+	_mm256_storeu_pd(vl, v);
+
+	// без очистки верхних половин регистров последующий SSE-код (в том числе libm)
+	// замедляется; компилятор вставляет vzeroupper только при оптимизации
+	_mm256_zeroupper();
+
+	S += (sl[0] + sl[1]) + (sl[2] + sl[3]);
+	V += (vl[0] + vl[1]) + (vl[2] + vl[3]);
+	weight_window_scalar(a, x + j, y + j, nc + j, n - j, S, V);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d fast_exp_avx512(__m512d x)
+{
+	// формы maskz с полной маской: у немаскированных источник слияния не определён (-Wmaybe-uninitialized)
+	x = _mm512_maskz_max_pd(0xFF, x, _mm512_set1_pd(FE_MIN_ARG));
+
+	__m512d n = _mm512_maskz_roundscale_pd(0xFF, _mm512_mul_pd(x, _mm512_set1_pd(FE_LOG2E)),
+										   _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m512d f = _mm512_sub_pd(_mm512_sub_pd(x, _mm512_mul_pd(n, _mm512_set1_pd(FE_LN2_HI))),
+							  _mm512_mul_pd(n, _mm512_set1_pd(FE_LN2_LO)));
+
+	__m512d p = _mm512_set1_pd(fe_poly[0]);
+	for (int i = 1; i < fe_poly_size; ++i)
+		p = _mm512_add_pd(_mm512_mul_pd(p, f), _mm512_set1_pd(fe_poly[i]));
+
+	return _mm512_maskz_scalef_pd(0xFF, p, n);
+}
+
+// вес exp(-k r^2) - cutoff соседей из маски, нули вне радиуса; общий для одного и нескольких коэффициентов
+__attribute__((target("avx512f")))
+static inline __m512d masked_weight_avx512(__mmask8 m, __m512d neg_k, __m512d r2, __m512d cutoff)
+{
+	return _mm512_maskz_sub_pd(m, fast_exp_avx512(_mm512_mul_pd(neg_k, r2)), cutoff);
+}
+
+__attribute__((target("avx512f")))
+static void weight_window_avx512(const weight_kernel_args &a, const double *x, const double *y,
+								 const double *nc, size_t n, double &S, double &V)
+{
+	const __m512d px = _mm512_set1_pd(a.px), py = _mm512_set1_pd(a.py);
+	const __m512d neg_k = _mm512_set1_pd(- a.k), R2 = _mm512_set1_pd(a.R2);
+	const __m512d cutoff = _mm512_set1_pd(a.cutoff);
+
+	__m512d s = _mm512_setzero_pd(), v = _mm512_setzero_pd();
+	size_t j = 0;
+	for (; j + 8 <= n; j += 8)
+	{
+		__m512d dx = _mm512_sub_pd(_mm512_loadu_pd(x + j), px);
+		__m512d dy = _mm512_sub_pd(_mm512_loadu_pd(y + j), py);
+		__m512d r2 = _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy));
+		__mmask8 m = _mm512_cmp_pd_mask(r2, R2, _CMP_LE_OQ);
+		if (m == 0) continue;
+
+		__m512d w = masked_weight_avx512(m, neg_k, r2, cutoff);
+		s = _mm512_add_pd(s, w);
+		v = _mm512_add_pd(v, _mm512_mul_pd(_mm512_loadu_pd(nc + j), w));
+	}
+
+	double sl[8], vl[8];
+	_mm512_storeu_pd(sl, s);
+	_mm512_storeu_pd(vl, v);
+
+	// без очистки верхних половин регистров последующий SSE-код (в том числе libm)
+	// замедляется; компилятор вставляет vzeroupper только при оптимизации
+	_mm256_zeroupper();
+
+	S += ((sl[0] + sl[1]) + (sl[2] + sl[3])) + ((sl[4] + sl[5]) + (sl[6] + sl[7]));
+	V += ((vl[0] + vl[1]) + (vl[2] + vl[3])) + ((vl[4] + vl[5]) + (vl[6] + vl[7]));
+	weight_window_scalar(a, x + j, y + j, nc + j, n - j, S, V);
+}
+
+// четвёрки соседей - как в weight_window_avx2, экспоненты всех коэффициентов по общим r^2 и маске
+__attribute__((target("avx2")))
+static void weight_window_multi_avx2(const weight_multi_args &a, const double *x, const double *y,
+									 const double *nc, size_t n, double *S, double *V)
+{
+	const __m256d px = _mm256_set1_pd(a.px), py = _mm256_set1_pd(a.py), R2 = _mm256_set1_pd(a.R2);
+
+	__m256d s[WK_MAX_COEFS], v[WK_MAX_COEFS];
+	for (int c = 0; c < a.m; ++c)
+		s[c] = _mm256_setzero_pd(), v[c] = _mm256_setzero_pd();
+
+	size_t j = 0;
+	for (; j + 4 <= n; j += 4)
+	{
+		__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + j), px);
+		__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + j), py);
+		__m256d r2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+		__m256d m = _mm256_cmp_pd(r2, R2, _CMP_LE_OQ);
+		if (_mm256_movemask_pd(m) == 0) continue;
+
+		__m256d ncj = _mm256_loadu_pd(nc + j);
+		for (int c = 0; c < a.m; ++c)
+		{
+			__m256d e = fast_exp_avx2(_mm256_mul_pd(_mm256_set1_pd(- a.k[c]), r2));
+			__m256d w = _mm256_and_pd(m, _mm256_sub_pd(e, _mm256_set1_pd(a.cutoff[c])));
+			s[c] = _mm256_add_pd(s[c], w);
+			v[c] = _mm256_add_pd(v[c], _mm256_mul_pd(ncj, w));
+		}
+	}
+
+	for (int c = 0; c < a.m; ++c)
+	{
+		double sl[4], vl[4];
+		_mm256_storeu_pd(sl, s[c]);
+		_mm256_storeu_pd(vl, v[c]);
+		S[c] += (sl[0] + sl[1]) + (sl[2] + sl[3]);
+		V[c] += (vl[0] + vl[1]) + (vl[2] + vl[3]);
+	}
+
+	// без очистки верхних половин регистров последующий SSE-код (в том числе libm)
+	// замедляется; компилятор вставляет vzeroupper только при оптимизации
+	_mm256_zeroupper();
+
+	weight_window_multi_scalar(a, x + j, y + j, nc + j, n - j, S, V);
+}
+
+__attribute__((target("avx512f")))
+static void weight_window_multi_avx512(const weight_multi_args &a, const double *x, const double *y,
+									   const double *nc, size_t n, double *S, double *V)
+{
+	const __m512d px = _mm512_set1_pd(a.px), py = _mm512_set1_pd(a.py), R2 = _mm512_set1_pd(a.R2);
+
+	__m512d s[WK_MAX_COEFS], v[WK_MAX_COEFS];
+	for (int c = 0; c < a.m; ++c)
+		s[c] = _mm512_setzero_pd(), v[c] = _mm512_setzero_pd();
+
+	size_t j = 0;
+	for (; j + 8 <= n; j += 8)
+	{
+		__m512d dx = _mm512_sub_pd(_mm512_loadu_pd(x + j), px);
+		__m512d dy = _mm512_sub_pd(_mm512_loadu_pd(y + j), py);
+		__m512d r2 = _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy));
+		__mmask8 m = _mm512_cmp_pd_mask(r2, R2, _CMP_LE_OQ);
+		if (m == 0) continue;
+
+		__m512d ncj = _mm512_loadu_pd(nc + j);
+		for (int c = 0; c < a.m; ++c)
+		{
+			__m512d w = masked_weight_avx512(m, _mm512_set1_pd(- a.k[c]), r2, _mm512_set1_pd(a.cutoff[c]));
+			s[c] = _mm512_add_pd(s[c], w);
+			v[c] = _mm512_add_pd(v[c], _mm512_mul_pd(ncj, w));
+		}
+	}
+
+	for (int c = 0; c < a.m; ++c)
+	{
+		double sl[8], vl[8];
+		_mm512_storeu_pd(sl, s[c]);
+		_mm512_storeu_pd(vl, v[c]);
+		S[c] += ((sl[0] + sl[1]) + (sl[2] + sl[3])) + ((sl[4] + sl[5]) + (sl[6] + sl[7]));
+		V[c] += ((vl[0] + vl[1]) + (vl[2] + vl[3])) + ((vl[4] + vl[5]) + (vl[6] + vl[7]));
+	}
+
+	// без очистки верхних половин регистров последующий SSE-код (в том числе libm)
+	// замедляется; компилятор вставляет vzeroupper только при оптимизации
+	_mm256_zeroupper();
+
+	weight_window_multi_scalar(a, x + j, y + j, nc + j, n - j, S, V);
+}
+
+#endif // DT_SIMD_X86
+
+void weight_window(const weight_kernel_args &a, const double *x, const double *y, const double *nc,
+				   size_t n, double &S, double &V)
+{
+	S = 0.0, V = 0.0;
+#ifdef DT_SIMD_X86
+	switch (simd_level())
+	{
+		case ESL_AVX512: weight_window_avx512(a, x, y, nc, n, S, V); return;
+		case ESL_AVX2: weight_window_avx2(a, x, y, nc, n, S, V); return;
+		default: break;
+	}
+#endif
+	weight_window_scalar(a, x, y, nc, n, S, V);
+}
+
+void weight_window_multi(const weight_multi_args &a, const double *x, const double *y, const double *nc,
+						 size_t n, double *S, double *V)
+{
+	for (int c = 0; c < a.m; ++c)
+		S[c] = 0.0, V[c] = 0.0;
+#ifdef DT_SIMD_X86
+	switch (simd_level())
+	{
+		case ESL_AVX512: weight_window_multi_avx512(a, x, y, nc, n, S, V); return;
+		case ESL_AVX2: weight_window_multi_avx2(a, x, y, nc, n, S, V); return;
+		default: break;
+	}
+#endif
+	weight_window_multi_scalar(a, x, y, nc, n, S, V);
+}